@@ -15,6 +15,26 @@ describe("Purchases", () => {
     expect(isUTCDateStringFuture(dateAhead.toUTCString())).toEqual(true);
   });
 
+  it("getActiveEntitlements compares the expiration millis against a single now", () => {
+    const {getActiveEntitlements} = require("../index");
+    const nowMillis = Date.parse("2020-06-01T00:00:00Z");
+    const purchaserInfo = {
+      ...purchaserInfoStub,
+      entitlements: {
+        active: {},
+        all: {
+          lifetime: { identifier: "lifetime", expirationDate: null, expirationDateMillis: null },
+          expired: { identifier: "expired", expirationDate: "2020-05-01T00:00:00Z", expirationDateMillis: Date.parse("2020-05-01T00:00:00Z") },
+          monthly: { identifier: "monthly", expirationDate: "2020-07-01T00:00:00Z", expirationDateMillis: Date.parse("2020-07-01T00:00:00Z") },
+          unparsed: { identifier: "unparsed", expirationDate: "2020-07-01T00:00:00Z" },
+        },
+      },
+    };
+
+    expect(Object.keys(getActiveEntitlements(purchaserInfo, nowMillis))).toEqual(["lifetime", "monthly", "unparsed"]);
+    expect(Object.keys(getActiveEntitlements(purchaserInfo))).toEqual(["lifetime"]);
+  });
+
   it("addPurchaserInfoUpdateListener correctly saves listeners", () => {
     const listener = jest.fn();
     const Purchases = require("../index").default;
@@ -42,6 +62,45 @@ describe("Purchases", () => {
     expect(listener).toHaveBeenCalledTimes(0);
   });
 
+  it("addPurchaserInfoUpdateListener returns a subscription that removes the listener", () => {
+    const Purchases = require("../index").default;
+    const listener = jest.fn();
+    const subscription = Purchases.addPurchaserInfoUpdateListener(listener);
+
+    subscription.remove();
+    nativeEmitter.emit("Purchases-PurchaserInfoUpdated", purchaserInfoStub);
+
+    expect(listener).toHaveBeenCalledTimes(0);
+    expect(Purchases.removePurchaserInfoUpdateListener(listener)).toEqual(false);
+  });
+
+  it("debounced purchaser info listeners are only called with the latest update of a burst", () => {
+    jest.useFakeTimers();
+    const Purchases = require("../index").default;
+    const listener = jest.fn();
+    const subscription = Purchases.addPurchaserInfoUpdateListener(listener, { debounceMillis: 100 });
+    const latestPurchaserInfo = { ...purchaserInfoStub, originalAppUserId: "latest" };
+
+    nativeEmitter.emit("Purchases-PurchaserInfoUpdated", purchaserInfoStub);
+    jest.advanceTimersByTime(50);
+    nativeEmitter.emit("Purchases-PurchaserInfoUpdated", latestPurchaserInfo);
+    jest.advanceTimersByTime(50);
+
+    expect(listener).toHaveBeenCalledTimes(0);
+
+    jest.advanceTimersByTime(50);
+
+    expect(listener).toHaveBeenCalledTimes(1);
+    expect(listener).toHaveBeenCalledWith(latestPurchaserInfo);
+
+    nativeEmitter.emit("Purchases-PurchaserInfoUpdated", purchaserInfoStub);
+    subscription.remove();
+    jest.advanceTimersByTime(100);
+
+    expect(listener).toHaveBeenCalledTimes(1);
+    jest.useRealTimers();
+  });
+
   it("addShouldPurchasePromoProductListener correctly saves listeners", () => {
     const listener = jest.fn();
     const Purchases = require("../index").default;
@@ -54,7 +113,76 @@ describe("Purchases", () => {
     };
     nativeEmitter.emit("Purchases-ShouldPurchasePromoProduct", eventInfo);
 
-    expect(listener).toHaveBeenCalledWith(expect.any(Function));
+    expect(listener).toHaveBeenCalledTimes(1);
+    expect(listener.mock.calls[0][0]).toEqual(expect.any(Function));
+  });
+
+  it("shouldPurchasePromoProductListener is called with the callbackID", () => {
+    const listener = jest.fn();
+    const Purchases = require("../index").default;
+
+    Purchases.addShouldPurchasePromoProductListener(listener);
+    nativeEmitter.emit("Purchases-ShouldPurchasePromoProduct", {callbackID: 7});
+    Purchases.removeShouldPurchasePromoProductListener(listener);
+
+    expect(listener).toHaveBeenCalledWith(expect.any(Function), 7);
+  });
+
+  it("releaseDeferredPurchase releases the deferment block natively on iOS", () => {
+    const Purchases = require("../index").default;
+    Platform.OS = "ios";
+
+    let releasedCallbackID;
+    const listener = (deferredPurchase, callbackID) => {
+      releasedCallbackID = callbackID;
+      Purchases.releaseDeferredPurchase(callbackID);
+    };
+    Purchases.addShouldPurchasePromoProductListener(listener);
+
+    for (let callbackID = 1; callbackID <= 3; callbackID++) {
+      nativeEmitter.emit("Purchases-ShouldPurchasePromoProduct", {callbackID});
+    }
+    Purchases.removeShouldPurchasePromoProductListener(listener);
+
+    expect(releasedCallbackID).toEqual(3);
+    expect(NativeModules.RNPurchases.releaseDeferredPurchase).toBeCalledTimes(3);
+    expect(NativeModules.RNPurchases.releaseDeferredPurchase).toBeCalledWith(3);
+    expect(NativeModules.RNPurchases.makeDeferredPurchase).toBeCalledTimes(0);
+  });
+
+  it("only the last 32 deferred purchases can be made", async () => {
+    const Purchases = require("../index").default;
+    const deferredPurchases = [];
+    const listener = deferredPurchase => deferredPurchases.push(deferredPurchase);
+    Purchases.addShouldPurchasePromoProductListener(listener);
+
+    for (let callbackID = 101; callbackID <= 133; callbackID++) {
+      nativeEmitter.emit("Purchases-ShouldPurchasePromoProduct", {callbackID});
+    }
+    Purchases.removeShouldPurchasePromoProductListener(listener);
+    NativeModules.RNPurchases.makeDeferredPurchase.mockResolvedValue({
+      purchasedProductIdentifier: "123",
+      purchaserInfo: purchaserInfoStub
+    });
+
+    await expect(deferredPurchases[0]()).rejects.toThrow();
+    expect(NativeModules.RNPurchases.makeDeferredPurchase).toBeCalledTimes(0);
+
+    await deferredPurchases[1]();
+    await expect(deferredPurchases[1]()).rejects.toThrow();
+    await deferredPurchases[32]();
+    expect(NativeModules.RNPurchases.makeDeferredPurchase).toBeCalledTimes(2);
+    expect(NativeModules.RNPurchases.makeDeferredPurchase).toBeCalledWith(102);
+    expect(NativeModules.RNPurchases.makeDeferredPurchase).toBeCalledWith(133);
+  });
+
+  it("releaseDeferredPurchase doesn't do anything on Android", () => {
+    const Purchases = require("../index").default;
+    Platform.OS = "android";
+
+    Purchases.releaseDeferredPurchase(1);
+
+    expect(NativeModules.RNPurchases.releaseDeferredPurchase).toBeCalledTimes(0);
   });
 
   it("shouldPurchasePromoProductListener calls deferred purchase", async () => {
@@ -101,6 +229,22 @@ describe("Purchases", () => {
     expect(listener).toHaveBeenCalledTimes(0);
   });
 
+  it("tells native which events are observed", () => {
+    const Purchases = require("../index").default;
+    const listener = jest.fn();
+    const otherListener = jest.fn();
+
+    Purchases.addOfferingsUpdateListener(listener);
+    Purchases.addOfferingsUpdateListener(otherListener);
+    Purchases.removeOfferingsUpdateListener(listener);
+    Purchases.removeOfferingsUpdateListener(otherListener);
+
+    expect(NativeModules.RNPurchases.setEventObserved.mock.calls).toEqual([
+      ["Purchases-OfferingsUpdated", true],
+      ["Purchases-OfferingsUpdated", false],
+    ]);
+  });
+
   it("calling setup with something other than string throws exception", () => {
     const Purchases = require("../index").default;
 
@@ -158,6 +302,56 @@ describe("Purchases", () => {
     expect(offerings).toEqual(offeringsStub);
   })
 
+  it("get offerings with stale while revalidate cache policy works", async () => {
+    const Purchases = require("../index").default;
+
+    NativeModules.RNPurchases.getOfferingsStaleWhileRevalidate.mockResolvedValueOnce(offeringsStub);
+
+    const offerings = await Purchases.getOfferings({
+      cachePolicy: Purchases.OFFERINGS_CACHE_POLICY.STALE_WHILE_REVALIDATE
+    });
+
+    expect(NativeModules.RNPurchases.getOfferingsStaleWhileRevalidate).toBeCalledTimes(1);
+    expect(NativeModules.RNPurchases.getOfferings).toBeCalledTimes(0);
+    expect(offerings).toEqual(offeringsStub);
+  })
+
+  it("get offerings with fetch cache policy works", async () => {
+    const Purchases = require("../index").default;
+
+    NativeModules.RNPurchases.getOfferings.mockResolvedValueOnce(offeringsStub);
+
+    const offerings = await Purchases.getOfferings({ cachePolicy: Purchases.OFFERINGS_CACHE_POLICY.FETCH });
+
+    expect(NativeModules.RNPurchases.getOfferings).toBeCalledTimes(1);
+    expect(NativeModules.RNPurchases.getOfferingsStaleWhileRevalidate).toBeCalledTimes(0);
+    expect(offerings).toEqual(offeringsStub);
+  })
+
+  it("addOfferingsUpdateListener correctly saves listeners", () => {
+    const listener = jest.fn();
+    const Purchases = require("../index").default;
+
+    Purchases.addOfferingsUpdateListener(listener);
+
+    nativeEmitter.emit("Purchases-OfferingsUpdated", offeringsStub);
+
+    expect(listener).toHaveBeenCalledWith(offeringsStub);
+  });
+
+  it("removeOfferingsUpdateListener correctly removes a listener", () => {
+    const Purchases = require("../index").default;
+    const listener = jest.fn();
+    Purchases.addOfferingsUpdateListener(listener);
+
+    expect(Purchases.removeOfferingsUpdateListener(listener)).toEqual(true);
+    expect(Purchases.removeOfferingsUpdateListener(listener)).toEqual(false);
+
+    nativeEmitter.emit("Purchases-OfferingsUpdated", offeringsStub);
+
+    expect(listener).toHaveBeenCalledTimes(0);
+  });
+
   it("getProducts works and gets subs by default", async () => {
     const Purchases = require("../index").default;
 
@@ -178,6 +372,65 @@ describe("Purchases", () => {
     expect(products).toEqual([]);
   });
 
+  it("getProductsBatch looks up subs and inapp products in a single native call by default", async () => {
+    const Purchases = require("../index").default;
+
+    NativeModules.RNPurchases.getProductInfoBatch.mockResolvedValueOnce(productsStub);
+
+    let products = await Purchases.getProductsBatch(["onemonth_freetrial", "consumable"]);
+
+    expect(NativeModules.RNPurchases.getProductInfoBatch).toBeCalledWith(["onemonth_freetrial", "consumable"], ["subs", "inapp"]);
+    expect(products).toEqual(productsStub);
+
+    NativeModules.RNPurchases.getProductInfoBatch.mockResolvedValueOnce([]);
+
+    products = await Purchases.getProductsBatch(["consumable"], { types: [Purchases.PURCHASE_TYPE.INAPP] });
+
+    expect(NativeModules.RNPurchases.getProductInfoBatch).toBeCalledWith(["consumable"], ["inapp"]);
+    expect(NativeModules.RNPurchases.getProductInfoBatch).toBeCalledTimes(2);
+    expect(NativeModules.RNPurchases.getProductInfo).toBeCalledTimes(0);
+    expect(products).toEqual([]);
+  });
+
+  it("compact payloads are decoded into the same offerings and purchaser info", async () => {
+    const Purchases = require("../index").default;
+    const listener = jest.fn();
+    const encodeCompact = (payload) => {
+      const keys = [];
+      const encode = (value) => {
+        if (Array.isArray(value)) {
+          return [1, ...value.map(encode)];
+        }
+        if (value !== null && typeof value === "object") {
+          return Object.keys(value).reduce((encoded, key) => {
+            if (!keys.includes(key)) {
+              keys.push(key);
+            }
+            return encoded.concat([keys.indexOf(key), encode(value[key])]);
+          }, [0]);
+        }
+        return value;
+      };
+      const compactValue = encode(payload);
+      return { compactKeys: keys, compactValue };
+    };
+
+    Purchases.setPayloadEncoding(Purchases.PAYLOAD_ENCODING.COMPACT);
+    expect(NativeModules.RNPurchases.setPayloadEncoding).toBeCalledWith("compact");
+
+    NativeModules.RNPurchases.getOfferings.mockResolvedValueOnce(encodeCompact(offeringsStub));
+    expect(await Purchases.getOfferings()).toEqual(offeringsStub);
+
+    NativeModules.RNPurchases.getPurchaserInfo.mockResolvedValueOnce(encodeCompact(purchaserInfoStub));
+    expect(await Purchases.getPurchaserInfo()).toEqual(purchaserInfoStub);
+
+    const subscription = Purchases.addPurchaserInfoUpdateListener(listener);
+    nativeEmitter.emit("Purchases-PurchaserInfoUpdated", encodeCompact(purchaserInfoStub));
+    subscription.remove();
+
+    expect(listener).toHaveBeenCalledWith(purchaserInfoStub);
+  });
+
   it("makePurchase calls purchaseProduct", () => {
     const Purchases = require("../index").default;
 
@@ -226,6 +479,41 @@ describe("Purchases", () => {
     expect(NativeModules.RNPurchases.purchaseProduct).toBeCalledTimes(3);
   });
 
+  it("getTransactions pages from the cursor and validates the limit", async () => {
+    const Purchases = require("../index").default;
+    const page = { transactions: [], nextCursor: null, totalCount: 120 };
+    NativeModules.RNPurchases.getTransactions.mockResolvedValue(page);
+
+    Purchases.setPurchaserInfoMode(Purchases.PURCHASER_INFO_MODE.SUMMARY);
+    expect(await Purchases.getTransactions()).toEqual(page);
+    await Purchases.getTransactions({ after: "txn_50", limit: 20 });
+
+    expect(NativeModules.RNPurchases.setPurchaserInfoMode).toBeCalledWith("summary");
+    expect(NativeModules.RNPurchases.getTransactions.mock.calls).toEqual([[null, 50], ["txn_50", 20]]);
+    await expect(Purchases.getTransactions({ limit: 0 })).rejects.toThrow("limit needs to be at least 1");
+  });
+
+  it("purchasePreparedPurchase purchases the prepared handle", async () => {
+    const Purchases = require("../index").default;
+
+    const preparedPurchaseStub = { handle: 7, productIdentifier: "onemonth_freetrial", paymentDiscount: null };
+    NativeModules.RNPurchases.preparePurchase.mockResolvedValue(preparedPurchaseStub);
+    NativeModules.RNPurchases.purchasePreparedPurchase.mockResolvedValue({
+      productIdentifier: "onemonth_freetrial",
+      purchaserInfo: purchaserInfoStub
+    });
+
+    const aPackage = { identifier: "$rc_monthly", offeringIdentifier: "offering" };
+    const preparedPurchase = await Purchases.preparePurchase(aPackage, { identifier: "discount" });
+    await Purchases.purchasePreparedPurchase(preparedPurchase);
+    Purchases.releasePreparedPurchase(preparedPurchase);
+
+    expect(NativeModules.RNPurchases.preparePurchase).toBeCalledWith("$rc_monthly", "offering", "discount");
+    expect(NativeModules.RNPurchases.purchasePreparedPurchase).toBeCalledWith(7, undefined);
+    expect(NativeModules.RNPurchases.releasePreparedPurchase).toBeCalledWith(7);
+    expect(NativeModules.RNPurchases.purchasePackage).toBeCalledTimes(0);
+  });
+
   it("purchasePackage works", () => {
     const Purchases = require("../index").default;
 
@@ -302,6 +590,28 @@ describe("Purchases", () => {
     expect(purchaserInfo).toEqual(purchaserInfoStub);
   })
 
+  it("restoreTransactionsWithProgress calls the listener with the progress of its request", async () => {
+    const Purchases = require("../index").default;
+    const listener = jest.fn();
+    NativeModules.RNPurchases.restoreTransactionsWithProgress.mockImplementationOnce(requestID => {
+      nativeEmitter.emit("Purchases-RestoreProgress",
+        { requestID, stage: "started", processedProductCount: 0, purchasedProductCount: 0 });
+      nativeEmitter.emit("Purchases-RestoreProgress",
+        { requestID: requestID + 1, stage: "started", processedProductCount: 0, purchasedProductCount: 0 });
+      nativeEmitter.emit("Purchases-RestoreProgress",
+        { requestID, stage: "processed", processedProductCount: 3, purchasedProductCount: 3 });
+      return Promise.resolve(purchaserInfoStub);
+    });
+
+    const purchaserInfo = await Purchases.restoreTransactionsWithProgress(listener);
+
+    expect(purchaserInfo).toEqual(purchaserInfoStub);
+    expect(listener.mock.calls).toEqual([
+      [{ stage: Purchases.RESTORE_PROGRESS_STAGE.STARTED, processedProductCount: 0, purchasedProductCount: 0 }],
+      [{ stage: Purchases.RESTORE_PROGRESS_STAGE.PROCESSED, processedProductCount: 3, purchasedProductCount: 3 }],
+    ]);
+  })
+
   it("getAppUserID works", async () => {
     const Purchases = require("../index").default;
 
@@ -313,6 +623,58 @@ describe("Purchases", () => {
     expect(appUserID).toEqual("123");
   })
 
+  it("getAppUserIDSync works", () => {
+    const Purchases = require("../index").default;
+
+    NativeModules.RNPurchases.getAppUserIDSync.mockReturnValueOnce("123");
+
+    expect(Purchases.getAppUserIDSync()).toEqual("123");
+    expect(NativeModules.RNPurchases.getAppUserIDSync).toBeCalledTimes(1);
+  })
+
+  it("isAnonymousSync works", () => {
+    const Purchases = require("../index").default;
+
+    NativeModules.RNPurchases.isAnonymousSync.mockReturnValueOnce(true);
+
+    expect(Purchases.isAnonymousSync()).toEqual(true);
+    expect(NativeModules.RNPurchases.isAnonymousSync).toBeCalledTimes(1);
+  })
+
+  it("getCachedPurchaserInfoSync returns the last purchaser info received natively", () => {
+    const Purchases = require("../index").default;
+
+    NativeModules.RNPurchases.getCachedPurchaserInfoSync.mockReturnValueOnce(null);
+    expect(Purchases.getCachedPurchaserInfoSync()).toEqual(null);
+
+    NativeModules.RNPurchases.getCachedPurchaserInfoSync.mockReturnValueOnce(purchaserInfoStub);
+    expect(Purchases.getCachedPurchaserInfoSync()).toEqual(purchaserInfoStub);
+    expect(NativeModules.RNPurchases.getCachedPurchaserInfoSync).toBeCalledTimes(2);
+  })
+
+  it("getCachedOfferingsSync returns the last offerings fetched natively", () => {
+    const Purchases = require("../index").default;
+
+    NativeModules.RNPurchases.getCachedOfferingsSync.mockReturnValueOnce(offeringsStub);
+
+    expect(Purchases.getCachedOfferingsSync()).toEqual(offeringsStub);
+    expect(NativeModules.RNPurchases.getCachedOfferingsSync).toBeCalledTimes(1);
+  })
+
+  it("getCachedPurchaserInfoSync decodes compact payloads", () => {
+    const Purchases = require("../index").default;
+
+    NativeModules.RNPurchases.getCachedPurchaserInfoSync.mockReturnValueOnce({
+      compactKeys: ["originalAppUserId", "activeSubscriptions"],
+      compactValue: [0, 0, "user", 1, [1, "monthly"]],
+    });
+
+    expect(Purchases.getCachedPurchaserInfoSync()).toEqual({
+      originalAppUserId: "user",
+      activeSubscriptions: ["monthly"],
+    });
+  })
+
   it("createAlias throws errors if new app user id is not a string", () => {
     const Purchases = require("../index").default;
 
@@ -362,6 +724,52 @@ describe("Purchases", () => {
     expect(NativeModules.RNPurchases.identify).toBeCalledTimes(1);
   })
 
+  it("identify decodes compact payloads", async () => {
+    const Purchases = require("../index").default;
+
+    NativeModules.RNPurchases.identify.mockResolvedValueOnce({
+      compactKeys: ["originalAppUserId", "activeSubscriptions"],
+      compactValue: [0, 0, "user", 1, [1, "monthly"]],
+    });
+
+    expect(await Purchases.identify("user")).toEqual({
+      originalAppUserId: "user",
+      activeSubscriptions: ["monthly"],
+    });
+  })
+
+  it("reset and createAlias decode compact payloads", async () => {
+    const Purchases = require("../index").default;
+    const payload = {
+      compactKeys: ["originalAppUserId", "activeSubscriptions"],
+      compactValue: [0, 0, "user", 1, [1, "monthly"]],
+    };
+    const purchaserInfo = {originalAppUserId: "user", activeSubscriptions: ["monthly"]};
+
+    NativeModules.RNPurchases.reset.mockResolvedValueOnce(payload);
+    NativeModules.RNPurchases.createAlias.mockResolvedValueOnce(payload);
+
+    expect(await Purchases.reset()).toEqual(purchaserInfo);
+    expect(await Purchases.createAlias("user")).toEqual(purchaserInfo);
+  })
+
+  it("addIdentifyFailedListener is called when identify couldn't switch to a user in the background", () => {
+    const Purchases = require("../index").default;
+    Platform.OS = "android";
+    const listener = jest.fn();
+    const error = {code: 10, message: "Error performing request.", readableErrorCode: "NETWORK_ERROR", underlyingErrorMessage: ""};
+
+    Purchases.addIdentifyFailedListener(listener);
+    nativeEmitter.emit("Purchases-IdentifyFailed", {appUserID: "user", error});
+    Purchases.removeIdentifyFailedListener(listener);
+    nativeEmitter.emit("Purchases-IdentifyFailed", {appUserID: "user", error});
+
+    expect(listener).toHaveBeenCalledTimes(1);
+    expect(listener).toHaveBeenCalledWith("user", error);
+    expect(NativeModules.RNPurchases.setEventObserved).toBeCalledWith("Purchases-IdentifyFailed", true);
+    expect(NativeModules.RNPurchases.setEventObserved).toBeCalledWith("Purchases-IdentifyFailed", false);
+  })
+
   it("setDebugLogsEnabled works", () => {
     const Purchases = require("../index").default;
 
@@ -387,6 +795,219 @@ describe("Purchases", () => {
     expect(purchaserInfo).toEqual(purchaserInfoStub);
   })
 
+  it("lazy getPurchaserInfo fetches the larger fields when they're first read", async () => {
+    const Purchases = require("../index").default;
+    const {allPurchaseDates, nonSubscriptionTransactions, ...lazyPurchaserInfo} = purchaserInfoStub;
+
+    NativeModules.RNPurchases.getPurchaserInfoLazy.mockResolvedValueOnce({
+      ...lazyPurchaserInfo,
+      entitlements: {active: purchaserInfoStub.entitlements.active},
+      lazyFieldsHandle: 1,
+      lazyFields: ["allPurchaseDates", "nonSubscriptionTransactions", "entitlements.all"]
+    });
+    NativeModules.RNPurchases.getPurchaserInfoField.mockImplementation((handle, field) => ({
+      value: field === "entitlements.all" ? purchaserInfoStub.entitlements.all : purchaserInfoStub[field]
+    }));
+
+    const purchaserInfo = await Purchases.getPurchaserInfo({lazy: true});
+
+    expect(NativeModules.RNPurchases.getPurchaserInfo).toBeCalledTimes(0);
+    expect(purchaserInfo.entitlements.active).toEqual(purchaserInfoStub.entitlements.active);
+    expect(purchaserInfo.lazyFieldsHandle).toEqual(undefined);
+    expect(NativeModules.RNPurchases.getPurchaserInfoField).toBeCalledTimes(0);
+
+    expect(purchaserInfo.allPurchaseDates).toEqual(allPurchaseDates);
+    expect(purchaserInfo.allPurchaseDates).toEqual(allPurchaseDates);
+    expect(NativeModules.RNPurchases.getPurchaserInfoField).toBeCalledTimes(1);
+    expect(NativeModules.RNPurchases.getPurchaserInfoField).toBeCalledWith(1, "allPurchaseDates");
+
+    expect(purchaserInfo.entitlements.all).toEqual(purchaserInfoStub.entitlements.all);
+    expect(NativeModules.RNPurchases.getPurchaserInfoField).toBeCalledWith(1, "entitlements.all");
+    expect(purchaserInfo).toEqual(purchaserInfoStub);
+  })
+
+  it("lazy getPurchaserInfo throws when reading a field of a handle evicted by a 17th lazy call", async () => {
+    const Purchases = require("../index").default;
+    const {allPurchaseDates, nonSubscriptionTransactions, ...lazyPurchaserInfo} = purchaserInfoStub;
+    let lastHandle = 0;
+
+    NativeModules.RNPurchases.getPurchaserInfoLazy.mockImplementation(() => {
+      lastHandle += 1;
+      return Promise.resolve({
+        ...lazyPurchaserInfo,
+        lazyFieldsHandle: lastHandle,
+        lazyFields: ["allPurchaseDates", "nonSubscriptionTransactions"]
+      });
+    });
+    NativeModules.RNPurchases.getPurchaserInfoField.mockImplementation((handle, field) =>
+      handle <= lastHandle - 16 ? {evicted: true} : {value: purchaserInfoStub[field]}
+    );
+
+    const first = await Purchases.getPurchaserInfo({lazy: true});
+    const second = await Purchases.getPurchaserInfo({lazy: true});
+    expect(first.nonSubscriptionTransactions).toEqual(nonSubscriptionTransactions);
+    for (let i = 0; i < 15; i++) {
+      await Purchases.getPurchaserInfo({lazy: true});
+    }
+
+    expect(lastHandle).toEqual(17);
+    expect(() => first.allPurchaseDates).toThrow();
+    expect(first.nonSubscriptionTransactions).toEqual(nonSubscriptionTransactions);
+    expect(second.allPurchaseDates).toEqual(allPurchaseDates);
+  })
+
+  it("concurrent getPurchaserInfo calls share one native request", async () => {
+    const Purchases = require("../index").default;
+    const coalescedBefore = Purchases.getCoalescedRequestCounts().getPurchaserInfo;
+
+    NativeModules.RNPurchases.getPurchaserInfo.mockResolvedValueOnce(purchaserInfoStub);
+
+    const purchaserInfos = await Promise.all([Purchases.getPurchaserInfo(), Purchases.getPurchaserInfo()]);
+
+    expect(NativeModules.RNPurchases.getPurchaserInfo).toBeCalledTimes(1);
+    expect(purchaserInfos[0]).toEqual(purchaserInfoStub);
+    expect(purchaserInfos[1]).toEqual(purchaserInfoStub);
+    expect(Purchases.getCoalescedRequestCounts().getPurchaserInfo).toEqual(coalescedBefore + 1);
+  })
+
+  it("getPurchaserInfo calls made after identify don't share the request of the previous user", async () => {
+    const Purchases = require("../index").default;
+    const otherPurchaserInfo = {...purchaserInfoStub, originalAppUserId: "other"};
+
+    let resolvePreviousUserRequest;
+    NativeModules.RNPurchases.getPurchaserInfo
+      .mockReturnValueOnce(new Promise(resolve => resolvePreviousUserRequest = resolve))
+      .mockResolvedValueOnce(otherPurchaserInfo);
+    NativeModules.RNPurchases.identify.mockResolvedValueOnce(otherPurchaserInfo);
+
+    const previousUserPurchaserInfo = Purchases.getPurchaserInfo();
+    await Purchases.identify("other");
+    const purchaserInfo = Purchases.getPurchaserInfo();
+    resolvePreviousUserRequest(purchaserInfoStub);
+
+    expect(NativeModules.RNPurchases.getPurchaserInfo).toBeCalledTimes(2);
+    expect(await previousUserPurchaserInfo).toEqual(purchaserInfoStub);
+    expect(await purchaserInfo).toEqual(otherPurchaserInfo);
+  })
+
+  it("concurrent getProducts calls are only coalesced when the arguments match", async () => {
+    const Purchases = require("../index").default;
+    const coalescedBefore = Purchases.getCoalescedRequestCounts().getProductInfo;
+
+    NativeModules.RNPurchases.getProductInfo.mockResolvedValue([]);
+
+    await Promise.all([
+      Purchases.getProducts(["onemonth_freetrial"]),
+      Purchases.getProducts(["onemonth_freetrial"]),
+      Purchases.getProducts(["onemonth_freetrial"], Purchases.PURCHASE_TYPE.INAPP),
+    ]);
+
+    expect(NativeModules.RNPurchases.getProductInfo).toBeCalledTimes(2);
+    expect(Purchases.getCoalescedRequestCounts().getProductInfo).toEqual(coalescedBefore + 1);
+  })
+
+  it("performance metrics combine the JS timing with the native samples", async () => {
+    const Purchases = require("../index").default;
+    const listener = jest.fn();
+
+    Purchases.setPerformanceMetricsEnabled(true);
+    Purchases.addPerformanceMetricsListener(listener);
+    NativeModules.RNPurchases.getOfferings.mockResolvedValueOnce(offeringsStub);
+
+    await Purchases.getOfferings();
+    nativeEmitter.emit("Purchases-Metrics", {
+      method: "getOfferings",
+      nativeEntry: 1000,
+      sdkCompletion: 1150,
+      conversionMillis: 3,
+      resolve: 1160,
+      payloadBytes: 5000
+    });
+
+    Purchases.setPerformanceMetricsEnabled(false);
+    Purchases.removePerformanceMetricsListener(listener);
+
+    const metrics = Purchases.getPerformanceMetrics();
+    expect(NativeModules.RNPurchases.setPerformanceMetricsEnabled).toBeCalledWith(true);
+    expect(metrics.getOfferings.totalMillis.count).toEqual(1);
+    expect(metrics.getOfferings.nativeMillis).toEqual({
+      count: 1,
+      sum: 150,
+      min: 150,
+      max: 150,
+      bucketUpperBounds: [1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000],
+      bucketCounts: [0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0]
+    });
+    expect(metrics.getOfferings.conversionMillis.sum).toEqual(3);
+    expect(metrics.getOfferings.resolveMillis.sum).toEqual(10);
+    expect(metrics.getOfferings.payloadBytes.bucketCounts[2]).toEqual(1);
+    expect(listener).toHaveBeenCalledWith(metrics);
+  })
+
+  it("native events are only subscribed to while something listens to them", () => {
+    const Purchases = require("../index").default;
+    Purchases.setPerformanceMetricsEnabled(false);
+    NativeModules.RNPurchases.addListener.mockClear();
+
+    Purchases.setPerformanceMetricsEnabled(true);
+    Purchases.setPerformanceMetricsEnabled(true);
+    Purchases.setPerformanceMetricsEnabled(false);
+
+    expect(NativeModules.RNPurchases.addListener).toBeCalledTimes(1);
+    expect(NativeModules.RNPurchases.addListener).toBeCalledWith("Purchases-Metrics");
+  })
+
+  it("performance metrics measure the depth of operation queue flushes", () => {
+    const Purchases = require("../index").default;
+
+    Purchases.setPerformanceMetricsEnabled(true);
+    nativeEmitter.emit("Purchases-Metrics", {
+      method: "flushOperationQueue",
+      nativeEntry: 1000,
+      sdkCompletion: 1040,
+      conversionMillis: 0,
+      resolve: 1040,
+      payloadBytes: 0,
+      queueDepth: 12
+    });
+    Purchases.setPerformanceMetricsEnabled(false);
+
+    const metrics = Purchases.getPerformanceMetrics().flushOperationQueue;
+    expect(metrics.nativeMillis.sum).toEqual(40);
+    expect(metrics.queueDepth.count).toEqual(1);
+    expect(metrics.queueDepth.max).toEqual(12);
+    expect(metrics.queueDepth.bucketCounts[4]).toEqual(1);
+  })
+
+  it("performance metrics measure the main thread time of ios calls", () => {
+    const Purchases = require("../index").default;
+
+    Purchases.setPerformanceMetricsEnabled(true);
+    nativeEmitter.emit("Purchases-Metrics", {
+      method: "setupPurchases",
+      nativeEntry: 1000,
+      sdkCompletion: 1030,
+      conversionMillis: 0,
+      resolve: 1030,
+      payloadBytes: 0,
+      mainThreadMillis: 25
+    });
+    Purchases.setPerformanceMetricsEnabled(false);
+
+    const metrics = Purchases.getPerformanceMetrics().setupPurchases;
+    expect(metrics.mainThreadMillis.count).toEqual(1);
+    expect(metrics.mainThreadMillis.max).toEqual(25);
+    expect(metrics.mainThreadMillis.bucketUpperBounds[6]).toEqual(100);
+    expect(metrics.mainThreadMillis.bucketCounts[5]).toEqual(1);
+  })
+
+  it("getQueuedOperationCount resolves with the native queue depth", async () => {
+    const Purchases = require("../index").default;
+    NativeModules.RNPurchases.getQueuedOperationCount.mockResolvedValueOnce(4);
+
+    expect(await Purchases.getQueuedOperationCount()).toEqual(4);
+  })
+
   it("setup works", async () => {
     const Purchases = require("../index").default;
 
@@ -401,6 +1022,73 @@ describe("Purchases", () => {
     expect(NativeModules.RNPurchases.setupPurchases).toBeCalledTimes(2);
   })
 
+  it("setup with prewarm fetches offerings, products and eligibility once", async () => {
+    const Purchases = require("../index").default;
+    const eligibilityStub = {status: Purchases.INTRO_ELIGIBILITY_STATUS.INTRO_ELIGIBILITY_STATUS_ELIGIBLE, description: "eligible"};
+
+    NativeModules.RNPurchases.getOfferings.mockResolvedValueOnce(offeringsStub);
+    NativeModules.RNPurchases.getProductInfo.mockResolvedValueOnce([]);
+    NativeModules.RNPurchases.checkTrialOrIntroductoryPriceEligibility.mockResolvedValueOnce({
+      annual_freetrial: eligibilityStub,
+      consumable: eligibilityStub,
+      introductory_price: eligibilityStub,
+      monthly: eligibilityStub
+    });
+
+    Purchases.setup("key", "user", false, undefined, {
+      prewarm: {offerings: true, productIdentifiers: ["monthly"], eligibility: true}
+    });
+
+    expect(NativeModules.RNPurchases.setupPurchases).toBeCalledWith("key", "user", false, undefined);
+
+    const [offerings, products, eligibilities] = await Promise.all([
+      Purchases.getOfferings(),
+      Purchases.getProducts(["monthly"]),
+      Purchases.checkTrialOrIntroductoryPriceEligibility(["monthly"])
+    ]);
+
+    expect(offerings).toEqual(offeringsStub);
+    expect(products).toEqual([]);
+    expect(eligibilities).toEqual({monthly: eligibilityStub});
+    expect(NativeModules.RNPurchases.getOfferings).toBeCalledTimes(1);
+    expect(NativeModules.RNPurchases.getProductInfo).toBeCalledTimes(1);
+    expect(NativeModules.RNPurchases.getProductInfo).toBeCalledWith(["monthly"], "subs");
+    expect(NativeModules.RNPurchases.checkTrialOrIntroductoryPriceEligibility).toBeCalledTimes(1);
+    expect(NativeModules.RNPurchases.checkTrialOrIntroductoryPriceEligibility)
+      .toBeCalledWith(["introductory_price", "annual_freetrial", "consumable", "monthly"]);
+  })
+
+  it("checkTrialOrIntroductoryPriceEligibility asks natively for products missing from the prewarmed eligibility", async () => {
+    const Purchases = require("../index").default;
+    const eligibilityStub = {status: Purchases.INTRO_ELIGIBILITY_STATUS.INTRO_ELIGIBILITY_STATUS_UNKNOWN, description: "unknown"};
+
+    NativeModules.RNPurchases.getOfferings.mockResolvedValueOnce(offeringsStub);
+    NativeModules.RNPurchases.checkTrialOrIntroductoryPriceEligibility
+      .mockResolvedValueOnce({annual_freetrial: eligibilityStub})
+      .mockResolvedValueOnce({yearly: eligibilityStub});
+
+    Purchases.setup("key", "user", false, undefined, {prewarm: {eligibility: true}});
+
+    const eligibilities = await Purchases.checkTrialOrIntroductoryPriceEligibility(["yearly"]);
+
+    expect(eligibilities).toEqual({yearly: eligibilityStub});
+    expect(NativeModules.RNPurchases.checkTrialOrIntroductoryPriceEligibility).toBeCalledTimes(2);
+    expect(NativeModules.RNPurchases.checkTrialOrIntroductoryPriceEligibility).toBeCalledWith(["yearly"]);
+  })
+
+  it("getOfferings asks natively again once the prewarm request has finished", async () => {
+    const Purchases = require("../index").default;
+
+    NativeModules.RNPurchases.getOfferings.mockResolvedValue(offeringsStub);
+
+    Purchases.setup("key", "user", false, undefined, {prewarm: {offerings: true}});
+
+    await Purchases.getOfferings();
+    await Purchases.getOfferings();
+
+    expect(NativeModules.RNPurchases.getOfferings).toBeCalledTimes(2);
+  })
+
   it("cancelled makePurchase sets userCancelled in the error", () => {
     const Purchases = require("../index").default;
 
@@ -513,6 +1201,30 @@ describe("Purchases", () => {
     expect(NativeModules.RNPurchases.setFinishTransactions).toBeCalledTimes(2);
   })
 
+  it("checkTrialOrIntroductoryPriceEligibilityStreaming calls the listener with the eligibilities of its request", async () => {
+    const Purchases = require("../index").default;
+    const listener = jest.fn();
+    const monthly = { status: 2, description: "eligible" };
+    const yearly = { status: 1, description: "ineligible" };
+    NativeModules.RNPurchases.checkTrialOrIntroductoryPriceEligibilityStreaming.mockImplementationOnce(
+      (productIdentifiers, requestID) => {
+        nativeEmitter.emit("Purchases-IntroEligibility", { requestID, eligibilities: { monthly } });
+        nativeEmitter.emit("Purchases-IntroEligibility", { requestID: requestID + 1, eligibilities: { weekly: monthly } });
+        nativeEmitter.emit("Purchases-IntroEligibility", { requestID, eligibilities: { yearly } });
+        return Promise.resolve({ monthly, yearly });
+      }
+    );
+
+    const eligibilities = await Purchases.checkTrialOrIntroductoryPriceEligibilityStreaming(["monthly", "yearly"], listener);
+
+    expect(eligibilities).toEqual({ monthly, yearly });
+    expect(listener).toBeCalledTimes(2);
+    expect(listener.mock.calls[0][0]).toEqual({ monthly });
+    expect(listener.mock.calls[1][0]).toEqual({ yearly });
+    nativeEmitter.emit("Purchases-IntroEligibility", { requestID: 1, eligibilities: { monthly } });
+    expect(listener).toBeCalledTimes(2);
+  });
+
   it("checkTrialOrIntroductoryPriceEligibility works", () => {
     const Purchases = require("../index").default;
 
@@ -659,6 +1371,41 @@ describe("Purchases", () => {
     });
   });
 
+  describe("product cache", () => {
+    describe("when invalidateProductCache is called", () => {
+      it("makes the right call to Purchases", () => {
+        const Purchases = require("../index").default;
+        Purchases.invalidateProductCache();
+
+        expect(NativeModules.RNPurchases.invalidateProductCache).toBeCalledTimes(1);
+      });
+    });
+    describe("when setProductCacheTTL is called", () => {
+      it("makes the right call to Purchases", () => {
+        const Purchases = require("../index").default;
+        Purchases.setProductCacheTTL(60);
+
+        expect(NativeModules.RNPurchases.setProductCacheTTL).toBeCalledWith(60);
+      });
+    });
+    describe("when setUserSnapshotCacheLimit is called", () => {
+      it("makes the right call to Purchases", () => {
+        const Purchases = require("../index").default;
+        Purchases.setUserSnapshotCacheLimit(256 * 1024);
+
+        expect(NativeModules.RNPurchases.setUserSnapshotCacheLimit).toBeCalledWith(256 * 1024);
+      });
+    });
+    describe("when getProductCacheStats is called", () => {
+      it("resolves with the native hits and misses", async () => {
+        const Purchases = require("../index").default;
+        NativeModules.RNPurchases.getProductCacheStats.mockResolvedValueOnce({ hits: 3, misses: 1 });
+
+        expect(await Purchases.getProductCacheStats()).toEqual({ hits: 3, misses: 1 });
+      });
+    });
+  });
+
   describe("setAttributes", () => {
     describe("when setAttributes is called", () => {
       it("makes the right call to Purchases", () => {
@@ -672,6 +1419,57 @@ describe("Purchases", () => {
     });
   });
 
+  describe("setAttributesBatch", () => {
+    describe("when setAttributesBatch is called several times in the same tick", () => {
+      it("makes a single call to Purchases with the merged attributes", async () => {
+        const Purchases = require("../index").default;
+
+        Purchases.setAttributesBatch({ email: "garfield@revenuecat.com", attributes: { band: "AirBourne" } });
+        Purchases.setAttributesBatch({ adjustID: "adjust", attributes: { song: "Back in the game" } });
+        Purchases.setAttributesBatch({ email: null, collectDeviceIdentifiers: true, campaign: undefined });
+
+        expect(NativeModules.RNPurchases.setAttributesBatch).toBeCalledTimes(0);
+
+        await Promise.resolve();
+
+        expect(NativeModules.RNPurchases.setAttributesBatch).toBeCalledTimes(1);
+        expect(NativeModules.RNPurchases.setAttributesBatch).toBeCalledWith({
+          email: null,
+          adjustID: "adjust",
+          attributes: { band: "AirBourne", song: "Back in the game" },
+          collectDeviceIdentifiers: true,
+        });
+      });
+    });
+
+    describe("when setAttributesBatch is called with null attributes", () => {
+      it("sends the other attributes", async () => {
+        const Purchases = require("../index").default;
+
+        Purchases.setAttributesBatch({ email: "garfield@revenuecat.com", attributes: null });
+        await Promise.resolve();
+
+        expect(NativeModules.RNPurchases.setAttributesBatch).toBeCalledTimes(1);
+        expect(NativeModules.RNPurchases.setAttributesBatch).toBeCalledWith({ email: "garfield@revenuecat.com" });
+      });
+    });
+
+    describe("when setAttributesBatch is called in different ticks", () => {
+      it("makes a call to Purchases per tick", async () => {
+        const Purchases = require("../index").default;
+
+        Purchases.setAttributesBatch({ email: "garfield@revenuecat.com" });
+        await Promise.resolve();
+        Purchases.setAttributesBatch({ displayName: "Garfield" });
+        await Promise.resolve();
+
+        expect(NativeModules.RNPurchases.setAttributesBatch).toBeCalledTimes(2);
+        expect(NativeModules.RNPurchases.setAttributesBatch).toBeCalledWith({ email: "garfield@revenuecat.com" });
+        expect(NativeModules.RNPurchases.setAttributesBatch).toBeCalledWith({ displayName: "Garfield" });
+      });
+    });
+  });
+
   describe("setEmail", () => {
     describe("when setEmail is called", () => {
       it("makes the right call to Purchases", () => {
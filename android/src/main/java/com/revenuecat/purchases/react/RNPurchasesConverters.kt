@@ -2,7 +2,6 @@ package com.revenuecat.purchases.react
 
 import com.facebook.react.bridge.ReadableArray
 import com.facebook.react.bridge.ReadableMap
-import com.facebook.react.bridge.ReadableType
 import com.facebook.react.bridge.WritableArray
 import com.facebook.react.bridge.WritableMap
 import com.facebook.react.bridge.WritableNativeArray
@@ -12,79 +11,285 @@ import org.json.JSONException
 import org.json.JSONObject
 
 internal object RNPurchasesConverters {
+    private const val COMPACT_MAP = 0
+    private const val COMPACT_LIST = 1
+
     @JvmStatic
     @Throws(JSONException::class)
     fun convertReadableMapToJson(readableMap: ReadableMap?): JSONObject {
+        // toHashMap reads all keys and values at once, instead of a getType and a getter per key
+        return convertHashMapToJson(readableMap!!.toHashMap())
+    }
+
+    @Throws(JSONException::class)
+    fun convertReadableArrayToJson(readableArray: ReadableArray?): JSONArray {
+        return convertListToJson(readableArray!!.toArrayList())
+    }
+
+    @Throws(JSONException::class)
+    private fun convertHashMapToJson(map: Map<String, Any?>): JSONObject {
         val jsonObject = JSONObject()
-        val iterator = readableMap!!.keySetIterator()
-        while (iterator.hasNextKey()) {
-            val key = iterator.nextKey()
-            when (readableMap.getType(key)) {
-                ReadableType.Null -> jsonObject.put(key, JSONObject.NULL)
-                ReadableType.Boolean -> jsonObject.put(key, readableMap.getBoolean(key))
-                ReadableType.Number -> jsonObject.put(key, readableMap.getDouble(key))
-                ReadableType.String -> jsonObject.put(key, readableMap.getString(key))
-                ReadableType.Map -> jsonObject.put(
-                    key,
-                    convertReadableMapToJson(readableMap.getMap(key))
-                )
-                ReadableType.Array -> jsonObject.put(
-                    key,
-                    convertReadableArrayToJson(readableMap.getArray(key))
-                )
+        for ((key, value) in map) {
+            when (value) {
+                null -> jsonObject.put(key, JSONObject.NULL)
+                is Map<*, *> -> jsonObject.put(key, convertHashMapToJson(value as Map<String, Any?>))
+                is List<*> -> jsonObject.put(key, convertListToJson(value))
+                else -> jsonObject.put(key, value)
             }
         }
         return jsonObject
     }
 
     @Throws(JSONException::class)
-    fun convertReadableArrayToJson(readableArray: ReadableArray?): JSONArray {
+    private fun convertListToJson(list: List<*>): JSONArray {
         val array = JSONArray()
-        for (i in 0 until readableArray!!.size()) {
-            when (readableArray.getType(i)) {
-                ReadableType.Null -> { }
-                ReadableType.Boolean -> array.put(readableArray.getBoolean(i))
-                ReadableType.Number -> array.put(readableArray.getDouble(i))
-                ReadableType.String -> array.put(readableArray.getString(i))
-                ReadableType.Map -> array.put(convertReadableMapToJson(readableArray.getMap(i)))
-                ReadableType.Array -> array.put(convertReadableArrayToJson(readableArray.getArray(i)))
+        for (i in list.indices) {
+            when (val item = list[i]) {
+                null -> { }
+                is Map<*, *> -> array.put(convertHashMapToJson(item as Map<String, Any?>))
+                is List<*> -> array.put(convertListToJson(item))
+                else -> array.put(item)
             }
         }
         return array
     }
 
-    private fun convertArrayToWritableArray(array: Array<Any?>): WritableArray {
+    @Throws(JSONException::class)
+    fun convertJsonToMap(jsonObject: JSONObject): Map<String, Any?> {
+        val map = HashMap<String, Any?>(jsonObject.length())
+        val keys = jsonObject.keys()
+        while (keys.hasNext()) {
+            val key = keys.next()
+            map[key] = convertJsonValue(jsonObject.get(key))
+        }
+        return map
+    }
+
+    @Throws(JSONException::class)
+    private fun convertJsonToList(jsonArray: JSONArray): List<Any?> {
+        val list = ArrayList<Any?>(jsonArray.length())
+        for (i in 0 until jsonArray.length()) {
+            list.add(convertJsonValue(jsonArray.get(i)))
+        }
+        return list
+    }
+
+    private fun convertJsonValue(value: Any?): Any? {
+        return when (value) {
+            JSONObject.NULL -> null
+            is JSONObject -> convertJsonToMap(value)
+            is JSONArray -> convertJsonToList(value)
+            is Int, is Double, is Boolean, is String -> value
+            is Number -> value.toDouble()
+            else -> value
+        }
+    }
+
+    private fun convertArrayToWritableArray(array: Array<*>): WritableArray {
+        val writableArray: WritableArray = WritableNativeArray()
+        for (i in 0 until array.size) {
+            pushValue(writableArray, array[i])
+        }
+        return writableArray
+    }
+
+    // Lists from the mappers are ArrayLists, read by index so no iterator is created for each one
+    private fun convertCollectionToWritableArray(collection: Collection<*>): WritableArray {
         val writableArray: WritableArray = WritableNativeArray()
-        for (item in array) {
-            when (item) {
-                null -> writableArray.pushNull()
-                is Boolean -> writableArray.pushBoolean(item)
-                is Int -> writableArray.pushInt(item)
-                is Double -> writableArray.pushDouble(item)
-                is String -> writableArray.pushString(item)
-                is Map<*, *> -> writableArray.pushMap(convertMapToWriteableMap(item as Map<String, *>))
-                is Array<*> -> writableArray.pushArray(convertArrayToWritableArray(item as Array<Any?>))
-                is List<*> -> writableArray.pushArray(convertArrayToWritableArray(item.toTypedArray()))
+        if (collection is List<*> && collection is RandomAccess) {
+            for (i in 0 until collection.size) {
+                pushValue(writableArray, collection[i])
+            }
+        } else {
+            for (item in collection) {
+                pushValue(writableArray, item)
             }
         }
         return writableArray
     }
 
     @JvmStatic
-    fun convertMapToWriteableMap(map: Map<String, *>): WritableMap {
+    fun convertMapToWriteableMap(map: Map<String, *>): WritableMap = convertAnyMapToWritableMap(map)
+
+    // Nested maps come typed as Map<*, *>, their keys are Strings so toString doesn't allocate
+    private fun convertAnyMapToWritableMap(map: Map<*, *>): WritableMap {
         val writableMap: WritableMap = WritableNativeMap()
         for ((key, value) in map) {
-            when (value) {
-                null -> writableMap.putNull(key)
-                is Boolean -> writableMap.putBoolean(key, value)
-                is Int -> writableMap.putInt(key, value)
-                is Double -> writableMap.putDouble(key, value)
-                is String -> writableMap.putString(key, value)
-                is Map<*, *> -> writableMap.putMap(key, convertMapToWriteableMap(value as Map<String, *>))
-                is Array<*> -> writableMap.putArray(key, convertArrayToWritableArray(value as Array<Any?>))
-                is List<*> -> writableMap.putArray(key, convertArrayToWritableArray(value.toTypedArray()))
-            }
+            putValue(writableMap, key.toString(), value)
+        }
+        return writableMap
+    }
+
+    /**
+     * Encodes the map with every key interned, for PAYLOAD_ENCODING.COMPACT. Maps become [COMPACT_MAP, keyIndex,
+     * value, ...] and lists [COMPACT_LIST, value, ...], with each key sent once in compactKeys. Decoded in JS by
+     * decodePayload.
+     */
+    @JvmStatic
+    fun convertMapToCompactWritableMap(map: Map<String, *>): WritableMap {
+        // insertion order is the order of the key indexes
+        val keyIndexes = LinkedHashMap<String, Int>()
+        val compactValue = convertMapToCompactArray(map, keyIndexes)
+        val compactKeys: WritableArray = WritableNativeArray()
+        for (key in keyIndexes.keys) {
+            compactKeys.pushString(key)
         }
+        val writableMap: WritableMap = WritableNativeMap()
+        writableMap.putArray("compactKeys", compactKeys)
+        writableMap.putArray("compactValue", compactValue)
         return writableMap
     }
-}
\ No newline at end of file
+
+    private fun convertMapToCompactArray(map: Map<*, *>, keyIndexes: MutableMap<String, Int>): WritableArray {
+        val writableArray: WritableArray = WritableNativeArray()
+        writableArray.pushInt(COMPACT_MAP)
+        for ((key, value) in map) {
+            writableArray.pushInt(keyIndexes.getOrPut(key.toString()) { keyIndexes.size })
+            pushCompactValue(writableArray, value, keyIndexes)
+        }
+        return writableArray
+    }
+
+    private fun convertArrayToCompactArray(array: Array<*>, keyIndexes: MutableMap<String, Int>): WritableArray {
+        val writableArray: WritableArray = WritableNativeArray()
+        writableArray.pushInt(COMPACT_LIST)
+        for (i in 0 until array.size) {
+            pushCompactValue(writableArray, array[i], keyIndexes)
+        }
+        return writableArray
+    }
+
+    private fun convertCollectionToCompactArray(
+        collection: Collection<*>,
+        keyIndexes: MutableMap<String, Int>
+    ): WritableArray {
+        val writableArray: WritableArray = WritableNativeArray()
+        writableArray.pushInt(COMPACT_LIST)
+        if (collection is List<*> && collection is RandomAccess) {
+            for (i in 0 until collection.size) {
+                pushCompactValue(writableArray, collection[i], keyIndexes)
+            }
+        } else {
+            for (item in collection) {
+                pushCompactValue(writableArray, item, keyIndexes)
+            }
+        }
+        return writableArray
+    }
+
+    private fun pushCompactValue(writableArray: WritableArray, item: Any?, keyIndexes: MutableMap<String, Int>) {
+        when (item) {
+            is Map<*, *> -> writableArray.pushArray(convertMapToCompactArray(item, keyIndexes))
+            is Array<*> -> writableArray.pushArray(convertArrayToCompactArray(item, keyIndexes))
+            is Collection<*> -> writableArray.pushArray(convertCollectionToCompactArray(item, keyIndexes))
+            else -> {
+                val primitiveArray = convertPrimitiveArrayToWritableArray(item, compactList = true)
+                if (primitiveArray != null) {
+                    writableArray.pushArray(primitiveArray)
+                } else {
+                    pushValue(writableArray, item)
+                }
+            }
+        }
+    }
+
+    // Every type the mappers and the module put in maps. The cases are ordered by how often they show up in a
+    // purchaser info, and Numbers that don't fit in an Int are sent as doubles, the only other number JS has
+    private fun pushValue(writableArray: WritableArray, item: Any?) {
+        when (item) {
+            null -> writableArray.pushNull()
+            is String -> writableArray.pushString(item)
+            is Boolean -> writableArray.pushBoolean(item)
+            is Double -> writableArray.pushDouble(item)
+            is Int -> writableArray.pushInt(item)
+            is Long -> pushLong(writableArray, item)
+            // widened as is, so 0.99f arrives as 0.9900000095367432. The SDK sends prices as Doubles, Floats aren't
+            // worth rounding through their shortest decimal
+            is Float -> writableArray.pushDouble(item.toDouble())
+            is Short -> writableArray.pushInt(item.toInt())
+            is Byte -> writableArray.pushInt(item.toInt())
+            is Number -> writableArray.pushDouble(item.toDouble())
+            is Map<*, *> -> writableArray.pushMap(convertAnyMapToWritableMap(item))
+            is Collection<*> -> writableArray.pushArray(convertCollectionToWritableArray(item))
+            is Array<*> -> writableArray.pushArray(convertArrayToWritableArray(item))
+            else -> {
+                val primitiveArray = convertPrimitiveArrayToWritableArray(item, compactList = false)
+                if (primitiveArray != null) {
+                    writableArray.pushArray(primitiveArray)
+                } else {
+                    // Chars, CharSequences, enums and anything else are sent the way JSONObject serializes them
+                    writableArray.pushString(item.toString())
+                }
+            }
+        }
+    }
+
+    private fun putValue(writableMap: WritableMap, key: String, value: Any?) {
+        when (value) {
+            null -> writableMap.putNull(key)
+            is String -> writableMap.putString(key, value)
+            is Boolean -> writableMap.putBoolean(key, value)
+            is Double -> writableMap.putDouble(key, value)
+            is Int -> writableMap.putInt(key, value)
+            is Long -> putLong(writableMap, key, value)
+            // widened as is, same as in pushValue
+            is Float -> writableMap.putDouble(key, value.toDouble())
+            is Short -> writableMap.putInt(key, value.toInt())
+            is Byte -> writableMap.putInt(key, value.toInt())
+            is Number -> writableMap.putDouble(key, value.toDouble())
+            is Map<*, *> -> writableMap.putMap(key, convertAnyMapToWritableMap(value))
+            is Collection<*> -> writableMap.putArray(key, convertCollectionToWritableArray(value))
+            is Array<*> -> writableMap.putArray(key, convertArrayToWritableArray(value))
+            else -> {
+                val primitiveArray = convertPrimitiveArrayToWritableArray(value, compactList = false)
+                if (primitiveArray != null) {
+                    writableMap.putArray(key, primitiveArray)
+                } else {
+                    writableMap.putString(key, value.toString())
+                }
+            }
+        }
+    }
+
+    private fun pushLong(writableArray: WritableArray, value: Long) {
+        if (value >= Int.MIN_VALUE && value <= Int.MAX_VALUE) {
+            writableArray.pushInt(value.toInt())
+        } else {
+            writableArray.pushDouble(value.toDouble())
+        }
+    }
+
+    private fun putLong(writableMap: WritableMap, key: String, value: Long) {
+        if (value >= Int.MIN_VALUE && value <= Int.MAX_VALUE) {
+            writableMap.putInt(key, value.toInt())
+        } else {
+            writableMap.putDouble(key, value.toDouble())
+        }
+    }
+
+    /**
+     * Reads the elements without boxing them. With compactList the array starts with COMPACT_LIST, as each list of
+     * a compact payload does.
+     * @return null if the value isn't a primitive array.
+     */
+    private fun convertPrimitiveArrayToWritableArray(value: Any, compactList: Boolean): WritableArray? {
+        if (value !is IntArray && value !is LongArray && value !is DoubleArray && value !is FloatArray
+            && value !is BooleanArray && value !is ShortArray && value !is ByteArray) {
+            return null
+        }
+        val writableArray: WritableArray = WritableNativeArray()
+        if (compactList) {
+            writableArray.pushInt(COMPACT_LIST)
+        }
+        when (value) {
+            is IntArray -> for (i in 0 until value.size) writableArray.pushInt(value[i])
+            is LongArray -> for (i in 0 until value.size) pushLong(writableArray, value[i])
+            is DoubleArray -> for (i in 0 until value.size) writableArray.pushDouble(value[i])
+            is FloatArray -> for (i in 0 until value.size) writableArray.pushDouble(value[i].toDouble())
+            is BooleanArray -> for (i in 0 until value.size) writableArray.pushBoolean(value[i])
+            is ShortArray -> for (i in 0 until value.size) writableArray.pushInt(value[i].toInt())
+            is ByteArray -> for (i in 0 until value.size) writableArray.pushInt(value[i].toInt())
+        }
+        return writableArray
+    }
+}
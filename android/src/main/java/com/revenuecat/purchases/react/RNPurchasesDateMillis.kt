@@ -0,0 +1,91 @@
+package com.revenuecat.purchases.react
+
+import java.text.ParseException
+import java.text.SimpleDateFormat
+import java.util.Locale
+import java.util.TimeZone
+
+/**
+ * Adds epoch millis next to the ISO 8601 dates of purchaser infos, as `<date key>Millis`, so JS can compare
+ * dates as numbers instead of parsing strings. Dates that already have millis are left as they are.
+ */
+internal object RNPurchasesDateMillis {
+
+    private val PURCHASER_INFO_DATE_KEYS =
+        listOf("latestExpirationDate", "firstSeen", "originalPurchaseDate", "requestDate")
+    private val ENTITLEMENT_DATE_KEYS = listOf(
+        "latestPurchaseDate",
+        "originalPurchaseDate",
+        "expirationDate",
+        "unsubscribeDetectedAt",
+        "billingIssueDetectedAt")
+
+    // SimpleDateFormat isn't thread safe, and "X" patterns need API 24
+    private val formats = object : ThreadLocal<List<SimpleDateFormat>>() {
+        override fun initialValue() = listOf(
+            "yyyy-MM-dd'T'HH:mm:ss'Z'",
+            "yyyy-MM-dd'T'HH:mm:ss.SSS'Z'"
+        ).map { pattern ->
+            SimpleDateFormat(pattern, Locale.US).apply { timeZone = TimeZone.getTimeZone("UTC") }
+        }
+    }
+
+    /**
+     * Adds the millis to a purchaser info, or to the purchaserInfo of a purchase result.
+     */
+    @JvmStatic
+    fun addToResult(result: Map<String, *>): Map<String, *> {
+        val purchaserInfo = result["purchaserInfo"]
+        return when {
+            result["entitlements"] is Map<*, *> -> addToPurchaserInfo(result)
+            purchaserInfo is Map<*, *> -> HashMap<String, Any?>(result).apply {
+                @Suppress("UNCHECKED_CAST")
+                put("purchaserInfo", addToPurchaserInfo(purchaserInfo as Map<String, *>))
+            }
+            else -> result
+        }
+    }
+
+    @JvmStatic
+    fun addToPurchaserInfo(purchaserInfo: Map<String, *>): Map<String, *> {
+        val result = HashMap<String, Any?>(purchaserInfo)
+        addMillis(result, PURCHASER_INFO_DATE_KEYS)
+        val entitlements = purchaserInfo["entitlements"] as? Map<*, *> ?: return result
+        result["entitlements"] = entitlements.mapValues { (_, entitlementInfos) ->
+            (entitlementInfos as? Map<*, *>)?.mapValues { (_, entitlementInfo) ->
+                (entitlementInfo as? Map<*, *>)?.let { entitlement ->
+                    @Suppress("UNCHECKED_CAST")
+                    HashMap<String, Any?>(entitlement as Map<String, *>).apply {
+                        addMillis(this, ENTITLEMENT_DATE_KEYS)
+                    }
+                } ?: entitlementInfo
+            } ?: entitlementInfos
+        }
+        return result
+    }
+
+    private fun addMillis(map: MutableMap<String, Any?>, dateKeys: List<String>) {
+        for (key in dateKeys) {
+            val millisKey = "${key}Millis"
+            if (!map.containsKey(key) || map.containsKey(millisKey)) {
+                continue
+            }
+            when (val date = map[key]) {
+                null -> map[millisKey] = null
+                // unparsable dates get no millis, JS falls back to parsing the string
+                is String -> parseMillis(date)?.let { map[millisKey] = it }
+            }
+        }
+    }
+
+    private fun parseMillis(date: String): Double? {
+        for (format in formats.get()!!) {
+            try {
+                return format.parse(date)?.time?.toDouble()
+            } catch (e: ParseException) {
+                // try the next format
+            }
+        }
+        return null
+    }
+}
@@ -1,11 +1,13 @@
 package com.revenuecat.purchases.react;
 
+import android.os.SystemClock;
 import android.util.Log;
 
 import androidx.annotation.NonNull;
 import androidx.annotation.Nullable;
 
 import com.facebook.react.bridge.Arguments;
+import com.facebook.react.bridge.LifecycleEventListener;
 import com.facebook.react.bridge.Promise;
 import com.facebook.react.bridge.ReactApplicationContext;
 import com.facebook.react.bridge.ReactContextBaseJavaModule;
@@ -13,9 +15,11 @@ import com.facebook.react.bridge.ReactMethod;
 import com.facebook.react.bridge.ReadableArray;
 import com.facebook.react.bridge.ReadableMap;
 import com.facebook.react.bridge.WritableArray;
+import com.facebook.react.bridge.WritableMap;
 import com.facebook.react.modules.core.DeviceEventManagerModule;
 import com.revenuecat.purchases.PurchaserInfo;
 import com.revenuecat.purchases.Purchases;
+import com.revenuecat.purchases.PurchasesErrorCode;
 import com.revenuecat.purchases.common.CommonKt;
 import com.revenuecat.purchases.common.ErrorContainer;
 import com.revenuecat.purchases.common.OnResult;
@@ -26,35 +30,112 @@ import com.revenuecat.purchases.common.mappers.PurchaserInfoMapperKt;
 import com.revenuecat.purchases.interfaces.UpdatedPurchaserInfoListener;
 
 import org.jetbrains.annotations.NotNull;
+import org.json.JSONArray;
 import org.json.JSONException;
+import org.json.JSONObject;
 
+import java.nio.charset.Charset;
 import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collections;
 import java.util.HashMap;
+import java.util.HashSet;
+import java.util.LinkedHashMap;
+import java.util.LinkedHashSet;
 import java.util.List;
 import java.util.Map;
+import java.util.Set;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.RejectedExecutionException;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicReference;
 
 import kotlin.UninitializedPropertyAccessException;
 
 import static com.revenuecat.purchases.react.RNPurchasesConverters.convertMapToWriteableMap;
 
-public class RNPurchasesModule extends ReactContextBaseJavaModule implements UpdatedPurchaserInfoListener {
+public class RNPurchasesModule extends ReactContextBaseJavaModule implements UpdatedPurchaserInfoListener,
+        LifecycleEventListener {
 
     private static final String PURCHASER_INFO_UPDATED = "Purchases-PurchaserInfoUpdated";
+    private static final String OFFERINGS_UPDATED = "Purchases-OfferingsUpdated";
+    private static final String METRICS = "Purchases-Metrics";
+    private static final String INTRO_ELIGIBILITY = "Purchases-IntroEligibility";
+    private static final String RESTORE_PROGRESS = "Purchases-RestoreProgress";
+    private static final String IDENTIFY_FAILED = "Purchases-IdentifyFailed";
+    public static final String NAME = "RNPurchases";
     public static final String PLATFORM_NAME = "react-native";
     public static final String PLUGIN_VERSION = "3.4.3";
+    // SkuDetailsParams takes at most 20 SKUs per query, getProductInfoBatch splits larger lists
+    private static final int PRODUCT_INFO_BATCH_SIZE = 20;
+    // Unused prepared purchases are dropped after a while or when there are too many
+    private static final long PREPARED_PURCHASE_TTL_MILLIS = 10 * 60 * 1000L;
+    private static final int MAX_PREPARED_PURCHASES = 8;
+    // Sent empty in PURCHASER_INFO_MODE.SUMMARY, they grow with every purchase
+    private static final List<String> SUMMARY_EMPTY_PURCHASER_INFO_MAPS = Arrays.asList(
+            "allExpirationDates",
+            "allExpirationDatesMillis",
+            "allPurchaseDates",
+            "allPurchaseDatesMillis");
+    // Purchaser infos from getPurchaserInfoLazy kept around for getPurchaserInfoField, the oldest ones are dropped
+    private static final int MAX_LAZY_PURCHASER_INFOS = 16;
+    private static final List<String> LAZY_PURCHASER_INFO_FIELDS = Arrays.asList(
+            "allPurchasedProductIdentifiers",
+            "allExpirationDates",
+            "allExpirationDatesMillis",
+            "allPurchaseDates",
+            "allPurchaseDatesMillis",
+            "nonSubscriptionTransactions",
+            "entitlements.all");
 
     private final ReactApplicationContext reactContext;
+    private final RNPurchasesOfferingsSnapshot offeringsSnapshot;
+    private final AtomicReference<Map<String, ?>> lastPurchaserInfo = new AtomicReference<>();
+    private final AtomicReference<Map<String, ?>> lastOfferings = new AtomicReference<>();
+    // The app user lastPurchaserInfo belongs to, guarded by lastPurchaserInfo
+    @Nullable
+    private String lastPurchaserInfoAppUserID;
+    private final AtomicReference<Map<String, ?>> lastEmittedPurchaserInfo = new AtomicReference<>();
+    private final Map<String, List<Promise>> pendingPromises = new HashMap<>();
+    // SDK callbacks usually arrive on the main thread, results are converted and promises resolved here instead
+    private final ExecutorService conversionExecutor = Executors.newSingleThreadExecutor(new ThreadFactory() {
+        @Override
+        public Thread newThread(@NonNull Runnable runnable) {
+            return new Thread(runnable, "RNPurchases-conversion");
+        }
+    });
+    private final RNPurchasesProductCache productCache = new RNPurchasesProductCache();
+    private final RNPurchasesUserSnapshots userSnapshots = new RNPurchasesUserSnapshots();
+    private final RNPurchasesOperationQueue operationQueue;
+    private final Map<Integer, Map<String, ?>> lazyPurchaserInfos = new HashMap<>();
+    private int lastLazyPurchaserInfoHandle = 0;
+    private final Map<Integer, Map<String, Object>> preparedPurchases = new HashMap<>();
+    private int lastPreparedPurchaseHandle = 0;
+    // Events JS has listeners for, nothing is converted for the others
+    private final Set<String> observedEvents = Collections.synchronizedSet(new HashSet<String>());
+    private volatile boolean inBackground = false;
+    // The latest purchaser info and offerings kept while in the background, only touched on the conversion executor
+    private final Map<String, Map<String, ?>> pendingEvents = new LinkedHashMap<>();
+    private volatile boolean performanceMetricsEnabled = false;
+    private volatile boolean compactPayloads = false;
+    private volatile boolean summaryPurchaserInfos = false;
 
     @SuppressWarnings("WeakerAccess")
     public RNPurchasesModule(ReactApplicationContext reactContext) {
         super(reactContext);
         this.reactContext = reactContext;
+        this.offeringsSnapshot = new RNPurchasesOfferingsSnapshot(reactContext);
+        this.operationQueue = new RNPurchasesOperationQueue(reactContext);
+        reactContext.addLifecycleEventListener(this);
     }
 
     @NonNull
     @Override
     public String getName() {
-        return "RNPurchases";
+        return NAME;
     }
 
     public void onCatalystInstanceDestroy() {
@@ -63,59 +144,338 @@ public class RNPurchasesModule extends ReactContextBaseJavaModule implements Upd
         } catch (UninitializedPropertyAccessException e) {
             // there's no instance so all good
         }
+        operationQueue.stopMonitoring();
+        reactContext.removeLifecycleEventListener(this);
+        conversionExecutor.shutdown();
+    }
+
+    @Override
+    public void onHostResume() {
+        inBackground = false;
+        runOnConversionExecutor(new Runnable() {
+            @Override
+            public void run() {
+                flushPendingEvents();
+            }
+        });
+    }
+
+    @Override
+    public void onHostPause() {
+        inBackground = true;
+    }
+
+    @Override
+    public void onHostDestroy() {
+        // onCatalystInstanceDestroy cleans up
     }
 
     @ReactMethod
     public void setupPurchases(String apiKey, @Nullable String appUserID,
                                boolean observerMode, @Nullable String userDefaultsSuiteName,
                                final Promise promise) {
-        PlatformInfo platformInfo = new PlatformInfo(PLATFORM_NAME, PLUGIN_VERSION);
-        CommonKt.configure(reactContext, apiKey, appUserID, observerMode, platformInfo);
-        Purchases.getSharedInstance().setUpdatedPurchaserInfoListener(this);
-        promise.resolve(null);
+        boolean traced = RNPurchasesTrace.beginSection("setupPurchases");
+        try {
+            PlatformInfo platformInfo = new PlatformInfo(PLATFORM_NAME, PLUGIN_VERSION);
+            CommonKt.configure(reactContext, apiKey, appUserID, observerMode, platformInfo);
+            Purchases.getSharedInstance().setUpdatedPurchaserInfoListener(this);
+            // the operations queued while offline are replayed once connectivity returns, or right away if online
+            operationQueue.startMonitoring(new Runnable() {
+                @Override
+                public void run() {
+                    flushOperationQueue();
+                }
+            });
+            promise.resolve(null);
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setAllowSharingStoreAccount(boolean allowSharingStoreAccount) {
-        CommonKt.setAllowSharingAppStoreAccount(allowSharingStoreAccount);
+        boolean traced = RNPurchasesTrace.beginSection("setAllowSharingStoreAccount");
+        try {
+            CommonKt.setAllowSharingAppStoreAccount(allowSharingStoreAccount);
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void addAttributionData(ReadableMap data, Integer network, @Nullable String networkUserId) {
+        boolean traced = RNPurchasesTrace.beginSection("addAttributionData");
         try {
-            SubscriberAttributesKt.addAttributionData(RNPurchasesConverters.convertReadableMapToJson(data), network, networkUserId);
-        } catch (JSONException e) {
-            Log.e("RNPurchases", "Error parsing attribution date to JSON: " + e.getLocalizedMessage());
+            try {
+                JSONObject jsonData = RNPurchasesConverters.convertReadableMapToJson(data);
+                if (!operationQueue.submit(
+                        RNPurchasesOperationQueue.attributionOperation(jsonData, network, networkUserId),
+                        configuredAppUserID())) {
+                    SubscriberAttributesKt.addAttributionData(jsonData, network, networkUserId);
+                }
+            } catch (JSONException e) {
+                Log.e("RNPurchases", "Error parsing attribution date to JSON: " + e.getLocalizedMessage());
+            }
+        } finally {
+            RNPurchasesTrace.endSection(traced);
         }
     }
 
     @ReactMethod
     public void getOfferings(final Promise promise) {
-        CommonKt.getOfferings(getOnResult(promise));
+        boolean traced = RNPurchasesTrace.beginSection("getOfferings");
+        try {
+            final WritableMap metrics = startMetrics("getOfferings");
+            // keyed by app user, so a request made after the user changed doesn't get the previous user's result
+            final String requestKey = "getOfferings:" + CommonKt.getAppUserID();
+            if (!addPendingPromise(requestKey, promise)) {
+                return;
+            }
+            CommonKt.getOfferings(onConversionExecutor(new OnResult() {
+                @Override
+                public void onReceived(Map<String, ?> map) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("getOfferings.onReceived");
+                    try {
+                        recordSdkCompletion(metrics);
+                        onOfferingsReceived(map);
+                        long conversionStart = System.nanoTime();
+                        for (Promise pendingPromise : removePendingPromises(requestKey)) {
+                            pendingPromise.resolve(convertPayload(map));
+                        }
+                        recordConversion(metrics, conversionStart);
+                        sendMetrics(metrics, map);
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+
+                @Override
+                public void onError(ErrorContainer errorContainer) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("getOfferings.onError");
+                    try {
+                        recordSdkCompletion(metrics);
+                        for (Promise pendingPromise : removePendingPromises(requestKey)) {
+                            rejectPromise(pendingPromise, errorContainer);
+                        }
+                        sendMetrics(metrics, null);
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+            }));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
-    public void getProductInfo(ReadableArray productIDs, String type, final Promise promise) {
-        ArrayList<String> productIDList = new ArrayList<>();
-        for (int i = 0; i < productIDs.size(); i++) {
-            productIDList.add(productIDs.getString(i));
+    public void getOfferingsStaleWhileRevalidate(final Promise promise) {
+        boolean traced = RNPurchasesTrace.beginSection("getOfferingsStaleWhileRevalidate");
+        try {
+            final String appUserID = CommonKt.getAppUserID();
+            RNPurchasesUserSnapshots.Snapshot userSnapshot = userSnapshots.get(appUserID);
+            final Map<String, ?> snapshot = userSnapshot != null && userSnapshot.getOfferings() != null
+                    ? userSnapshot.getOfferings()
+                    : offeringsSnapshot.read(appUserID);
+            if (snapshot != null) {
+                promise.resolve(convertPayload(snapshot));
+            }
+            CommonKt.getOfferings(onConversionExecutor(new OnResult() {
+                @Override
+                public void onReceived(Map<String, ?> map) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("getOfferingsStaleWhileRevalidate.onReceived");
+                    try {
+                        onOfferingsReceived(map);
+                        if (snapshot == null) {
+                            promise.resolve(convertPayload(map));
+                        }
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+
+                @Override
+                public void onError(ErrorContainer errorContainer) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("getOfferingsStaleWhileRevalidate.onError");
+                    try {
+                        // when the snapshot was served, listeners just don't get refreshed offerings
+                        if (snapshot == null) {
+                            rejectPromise(promise, errorContainer);
+                        }
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+            }));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
         }
-        CommonKt.getProductInfo(productIDList, type, new OnResultList() {
-            @Override
-            public void onReceived(List<Map<String, ?>> map) {
-                WritableArray writableArray = Arguments.createArray();
-                for (Map<String, ?> detail : map) {
-                    writableArray.pushMap(convertMapToWriteableMap(detail));
+    }
+
+    @ReactMethod
+    public void getProductInfo(ReadableArray productIDs, final String type, final Promise promise) {
+        boolean traced = RNPurchasesTrace.beginSection("getProductInfo");
+        try {
+            final ArrayList<String> productIDList = new ArrayList<>();
+            for (int i = 0; i < productIDs.size(); i++) {
+                productIDList.add(productIDs.getString(i));
+            }
+            final WritableMap metrics = startMetrics("getProductInfo");
+            final RNPurchasesProductCache.Lookup lookup = productCache.lookup(productIDList, type);
+            if (lookup.getUncachedProductIDs().isEmpty()) {
+                recordSdkCompletion(metrics);
+                List<Map<String, ?>> products = lookup.merge(productIDList, new ArrayList<Map<String, ?>>());
+                promise.resolve(convertProductsToWritableArray(products));
+                sendMetrics(metrics, products);
+                return;
+            }
+            final String requestKey = "getProductInfo:" + type + ":" + productIDList;
+            if (!addPendingPromise(requestKey, promise)) {
+                return;
+            }
+            CommonKt.getProductInfo(lookup.getUncachedProductIDs(), type, onConversionExecutor(new OnResultList() {
+                @Override
+                public void onReceived(List<Map<String, ?>> map) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("getProductInfo.onReceived");
+                    try {
+                        recordSdkCompletion(metrics);
+                        productCache.put(map, type);
+                        List<Map<String, ?>> products = lookup.merge(productIDList, map);
+                        long conversionStart = System.nanoTime();
+                        for (Promise pendingPromise : removePendingPromises(requestKey)) {
+                            pendingPromise.resolve(convertProductsToWritableArray(products));
+                        }
+                        recordConversion(metrics, conversionStart);
+                        sendMetrics(metrics, products);
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+
+                @Override
+                public void onError(ErrorContainer errorContainer) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("getProductInfo.onError");
+                    try {
+                        recordSdkCompletion(metrics);
+                        for (Promise pendingPromise : removePendingPromises(requestKey)) {
+                            rejectPromise(pendingPromise, errorContainer);
+                        }
+                        sendMetrics(metrics, null);
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
                 }
-                promise.resolve(writableArray);
+            }));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void getProductInfoBatch(ReadableArray productIDs, ReadableArray types, final Promise promise) {
+        boolean traced = RNPurchasesTrace.beginSection("getProductInfoBatch");
+        try {
+            final LinkedHashSet<String> productIDSet = new LinkedHashSet<>();
+            for (int i = 0; i < productIDs.size(); i++) {
+                productIDSet.add(productIDs.getString(i));
+            }
+            final List<String> productIDList = new ArrayList<>(productIDSet);
+            final WritableMap metrics = startMetrics("getProductInfoBatch");
+            // Results of every type by product identifier, the first one for each identifier is kept
+            final Map<String, Map<String, ?>> productsByIdentifier = new HashMap<>();
+            Map<String, List<String>> uncachedProductIDsByType = new LinkedHashMap<>();
+            int queryCount = 0;
+            for (int t = 0; t < types.size(); t++) {
+                String type = types.getString(t);
+                RNPurchasesProductCache.Lookup lookup = productCache.lookup(productIDList, type);
+                addProductsByIdentifier(productsByIdentifier, lookup.getCachedProducts());
+                uncachedProductIDsByType.put(type, lookup.getUncachedProductIDs());
+                int uncachedCount = lookup.getUncachedProductIDs().size();
+                queryCount += (uncachedCount + PRODUCT_INFO_BATCH_SIZE - 1) / PRODUCT_INFO_BATCH_SIZE;
+            }
+            if (queryCount == 0) {
+                recordSdkCompletion(metrics);
+                resolveProductsBatch(promise, metrics, productIDList, productsByIdentifier);
+                return;
             }
+            final AtomicInteger remainingQueries = new AtomicInteger(queryCount);
+            final AtomicBoolean settled = new AtomicBoolean(false);
+            for (Map.Entry<String, List<String>> uncachedProductIDs : uncachedProductIDsByType.entrySet()) {
+                final String type = uncachedProductIDs.getKey();
+                List<String> uncachedProductIDList = uncachedProductIDs.getValue();
+                for (int start = 0; start < uncachedProductIDList.size(); start += PRODUCT_INFO_BATCH_SIZE) {
+                    List<String> chunk = new ArrayList<>(uncachedProductIDList.subList(
+                            start, Math.min(start + PRODUCT_INFO_BATCH_SIZE, uncachedProductIDList.size())));
+                    CommonKt.getProductInfo(chunk, type, onConversionExecutor(new OnResultList() {
+                        @Override
+                        public void onReceived(List<Map<String, ?>> map) {
+                            boolean tracedCallback = RNPurchasesTrace.beginSection("getProductInfoBatch.onReceived");
+                            try {
+                                productCache.put(map, type);
+                                addProductsByIdentifier(productsByIdentifier, map);
+                                if (remainingQueries.decrementAndGet() > 0 || !settled.compareAndSet(false, true)) {
+                                    return;
+                                }
+                                recordSdkCompletion(metrics);
+                                resolveProductsBatch(promise, metrics, productIDList, productsByIdentifier);
+                            } finally {
+                                RNPurchasesTrace.endSection(tracedCallback);
+                            }
+                        }
 
-            @Override
-            public void onError(ErrorContainer errorContainer) {
-                promise.reject(errorContainer.getCode() + "", errorContainer.getMessage(),
-                        convertMapToWriteableMap(errorContainer.getInfo()));
+                        @Override
+                        public void onError(ErrorContainer errorContainer) {
+                            boolean tracedCallback = RNPurchasesTrace.beginSection("getProductInfoBatch.onError");
+                            try {
+                                // the first failed query rejects, the results of the others are ignored
+                                if (settled.compareAndSet(false, true)) {
+                                    recordSdkCompletion(metrics);
+                                    rejectPromise(promise, errorContainer);
+                                    sendMetrics(metrics, null);
+                                }
+                            } finally {
+                                RNPurchasesTrace.endSection(tracedCallback);
+                            }
+                        }
+                    }));
+                }
             }
-        });
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void setProductCacheTTL(double ttlSeconds) {
+        boolean traced = RNPurchasesTrace.beginSection("setProductCacheTTL");
+        try {
+            productCache.setTtlMillis((long) (ttlSeconds * 1000));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void invalidateProductCache() {
+        boolean traced = RNPurchasesTrace.beginSection("invalidateProductCache");
+        try {
+            productCache.invalidate();
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void getProductCacheStats(final Promise promise) {
+        boolean traced = RNPurchasesTrace.beginSection("getProductCacheStats");
+        try {
+            WritableMap stats = Arguments.createMap();
+            stats.putDouble("hits", productCache.getHits());
+            stats.putDouble("misses", productCache.getMisses());
+            promise.resolve(stats);
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
@@ -124,13 +484,19 @@ public class RNPurchasesModule extends ReactContextBaseJavaModule implements Upd
                                 final String type,
                                 @Nullable final String discountTimestamp,
                                 final Promise promise) {
-        CommonKt.purchaseProduct(
-                getCurrentActivity(),
-                productIdentifier,
-                upgradeInfo != null && upgradeInfo.hasKey("oldSKU") ? upgradeInfo.getString("oldSKU") : null,
-                upgradeInfo != null && upgradeInfo.hasKey("prorationMode") ? upgradeInfo.getInt("prorationMode") : null,
-                type,
-                getOnResult(promise));
+        boolean traced = RNPurchasesTrace.beginSection("purchaseProduct");
+        try {
+            CommonKt.purchaseProduct(
+                    getCurrentActivity(),
+                    productIdentifier,
+                    upgradeInfo != null && upgradeInfo.hasKey("oldSKU") ? upgradeInfo.getString("oldSKU") : null,
+                    upgradeInfo != null && upgradeInfo.hasKey("prorationMode") ? upgradeInfo.getInt("prorationMode") : null,
+                    type,
+                    recordingPurchaserInfo(CommonKt.getAppUserID(),
+                            getOnResult(promise, startMetrics("purchaseProduct"))));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
@@ -139,89 +505,656 @@ public class RNPurchasesModule extends ReactContextBaseJavaModule implements Upd
                                 @Nullable final ReadableMap upgradeInfo,
                                 @Nullable final String discountTimestamp,
                                 final Promise promise) {
-        CommonKt.purchasePackage(
-                getCurrentActivity(),
-                packageIdentifier,
-                offeringIdentifier,
-                upgradeInfo != null && upgradeInfo.hasKey("oldSKU") ? upgradeInfo.getString("oldSKU") : null,
-                upgradeInfo != null && upgradeInfo.hasKey("prorationMode") ? upgradeInfo.getInt("prorationMode") : null,
-                getOnResult(promise));
+        boolean traced = RNPurchasesTrace.beginSection("purchasePackage");
+        try {
+            CommonKt.purchasePackage(
+                    getCurrentActivity(),
+                    packageIdentifier,
+                    offeringIdentifier,
+                    upgradeInfo != null && upgradeInfo.hasKey("oldSKU") ? upgradeInfo.getString("oldSKU") : null,
+                    upgradeInfo != null && upgradeInfo.hasKey("prorationMode") ? upgradeInfo.getInt("prorationMode") : null,
+                    recordingPurchaserInfo(CommonKt.getAppUserID(),
+                            getOnResult(promise, startMetrics("purchasePackage"))));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void preparePurchase(final String packageIdentifier,
+                                final String offeringIdentifier,
+                                @Nullable final String discountIdentifier,
+                                final Promise promise) {
+        boolean traced = RNPurchasesTrace.beginSection("preparePurchase");
+        try {
+            final WritableMap metrics = startMetrics("preparePurchase");
+            // Purchases keeps the offerings and their SkuDetails once fetched, so the purchase finds them without a
+            // request. There are no payment discounts on Android, discountIdentifier is ignored
+            CommonKt.getOfferings(onConversionExecutor(new OnResult() {
+                @Override
+                public void onReceived(Map<String, ?> map) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("preparePurchase.onReceived");
+                    try {
+                        recordSdkCompletion(metrics);
+                        onOfferingsReceived(map);
+                        String productIdentifier = getProductIdentifier(map, packageIdentifier, offeringIdentifier);
+                        if (productIdentifier == null) {
+                            promise.reject(PurchasesErrorCode.ProductNotAvailableForPurchaseError.getCode() + "",
+                                    "Couldn't find package " + packageIdentifier + " in offering " + offeringIdentifier);
+                            sendMetrics(metrics, null);
+                            return;
+                        }
+                        Map<String, Object> result = addPreparedPurchase(
+                                packageIdentifier, offeringIdentifier, productIdentifier);
+                        promise.resolve(convertMapToWriteableMap(result));
+                        sendMetrics(metrics, result);
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+
+                @Override
+                public void onError(ErrorContainer errorContainer) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("preparePurchase.onError");
+                    try {
+                        recordSdkCompletion(metrics);
+                        rejectPromise(promise, errorContainer);
+                        sendMetrics(metrics, null);
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+            }));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void purchasePreparedPurchase(int handle,
+                                         @Nullable final ReadableMap upgradeInfo,
+                                         final Promise promise) {
+        boolean traced = RNPurchasesTrace.beginSection("purchasePreparedPurchase");
+        try {
+            Map<String, Object> preparedPurchase;
+            synchronized (preparedPurchases) {
+                preparedPurchase = preparedPurchases.remove(handle);
+            }
+            if (preparedPurchase == null || SystemClock.elapsedRealtime() - (long) preparedPurchase.get("preparedAt")
+                    >= PREPARED_PURCHASE_TTL_MILLIS) {
+                promise.reject(PurchasesErrorCode.UnknownError.getCode() + "",
+                        "The prepared purchase was already made, released or has expired");
+                return;
+            }
+            CommonKt.purchasePackage(
+                    getCurrentActivity(),
+                    (String) preparedPurchase.get("packageIdentifier"),
+                    (String) preparedPurchase.get("offeringIdentifier"),
+                    upgradeInfo != null && upgradeInfo.hasKey("oldSKU") ? upgradeInfo.getString("oldSKU") : null,
+                    upgradeInfo != null && upgradeInfo.hasKey("prorationMode") ? upgradeInfo.getInt("prorationMode") : null,
+                    recordingPurchaserInfo(CommonKt.getAppUserID(),
+                            getOnResult(promise, startMetrics("purchasePreparedPurchase"))));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void releasePreparedPurchase(int handle) {
+        boolean traced = RNPurchasesTrace.beginSection("releasePreparedPurchase");
+        try {
+            synchronized (preparedPurchases) {
+                preparedPurchases.remove(handle);
+            }
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void getAppUserID(final Promise promise) {
-        promise.resolve(CommonKt.getAppUserID());
+        boolean traced = RNPurchasesTrace.beginSection("getAppUserID");
+        try {
+            promise.resolve(CommonKt.getAppUserID());
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod(isBlockingSynchronousMethod = true)
+    public String getAppUserIDSync() {
+        boolean traced = RNPurchasesTrace.beginSection("getAppUserIDSync");
+        try {
+            return CommonKt.getAppUserID();
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void restoreTransactions(final Promise promise) {
-        CommonKt.restoreTransactions(getOnResult(promise));
+        boolean traced = RNPurchasesTrace.beginSection("restoreTransactions");
+        try {
+            CommonKt.restoreTransactions(
+                    recordingPurchaserInfo(CommonKt.getAppUserID(),
+                            getOnResult(promise, startMetrics("restoreTransactions"), true)));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    // The SDK queries the purchase history and posts it in a single call, so the stages are around that call. The
+    // purchaser info is converted once, after the SDK merged everything it restored
+    @ReactMethod
+    public void restoreTransactionsWithProgress(final int requestID, final Promise promise) {
+        boolean traced = RNPurchasesTrace.beginSection("restoreTransactionsWithProgress");
+        try {
+            final WritableMap metrics = startMetrics("restoreTransactionsWithProgress");
+            final String appUserID = CommonKt.getAppUserID();
+            sendRestoreProgress(requestID, "started", 0, 0);
+            CommonKt.restoreTransactions(onConversionExecutor(new OnResult() {
+                @Override
+                public void onReceived(Map<String, ?> result) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("restoreTransactionsWithProgress.onReceived");
+                    try {
+                        recordSdkCompletion(metrics);
+                        Map<String, ?> purchaserInfo = RNPurchasesDateMillis.addToPurchaserInfo(result);
+                        onPurchaserInfoReceived(appUserID, purchaserInfo);
+                        Object purchasedProducts = purchaserInfo.get("allPurchasedProductIdentifiers");
+                        int purchasedProductCount =
+                                purchasedProducts instanceof List ? ((List<?>) purchasedProducts).size() : 0;
+                        sendRestoreProgress(requestID, "restored", 0, purchasedProductCount);
+                        long conversionStart = System.nanoTime();
+                        WritableMap writableMap = convertPayload(purchaserInfo);
+                        recordConversion(metrics, conversionStart);
+                        sendRestoreProgress(requestID, "processed", purchasedProductCount, purchasedProductCount);
+                        promise.resolve(writableMap);
+                        sendMetrics(metrics, purchaserInfo);
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+
+                @Override
+                public void onError(ErrorContainer errorContainer) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("restoreTransactionsWithProgress.onError");
+                    try {
+                        recordSdkCompletion(metrics);
+                        rejectPromise(promise, errorContainer);
+                        sendMetrics(metrics, null);
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+            }));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void reset(final Promise promise) {
-        CommonKt.reset(getOnResult(promise));
+        boolean traced = RNPurchasesTrace.beginSection("reset");
+        try {
+            willChangeAppUser();
+            CommonKt.reset(recordingSwitchedUserPurchaserInfo(getOnResult(promise, null, true)));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void identify(final String appUserID, final Promise promise) {
+        boolean traced = RNPurchasesTrace.beginSection("identify");
+        try {
+            willChangeAppUser();
+            RNPurchasesUserSnapshots.Snapshot snapshot = userSnapshots.get(appUserID);
+            if (snapshot == null || snapshot.getPurchaserInfo() == null) {
+                CommonKt.identify(appUserID, onIdentified(appUserID, getOnResult(promise, null, true)));
+                return;
+            }
+            // Served from the snapshot, identify still switches the SDK to the user and listeners get its purchaser
+            // info if it changed. Until then the SDK is still on the previous user, if switching fails JS is told
+            // with an IDENTIFY_FAILED event.
+            final Map<String, ?> snapshotPurchaserInfo = snapshot.getPurchaserInfo();
+            final Map<String, ?> snapshotOfferings = snapshot.getOfferings();
+            setLastPurchaserInfo(appUserID, snapshotPurchaserInfo);
+            if (snapshotOfferings != null) {
+                lastOfferings.set(snapshotOfferings);
+            }
+            runOnConversionExecutor(new Runnable() {
+                @Override
+                public void run() {
+                    promise.resolve(convertPayload(snapshotPurchaserInfo));
+                }
+            });
+            CommonKt.identify(appUserID, onIdentified(appUserID, onConversionExecutor(new OnResult() {
+                @Override
+                public void onReceived(Map<String, ?> map) {
+                }
+
+                @Override
+                public void onError(ErrorContainer errorContainer) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("identify.onError");
+                    try {
+                        Log.e("RNPurchases", "Error identifying " + appUserID + ": " + errorContainer.getMessage());
+                        // the snapshot of the user that couldn't be switched to isn't the current one
+                        synchronized (lastPurchaserInfo) {
+                            if (lastPurchaserInfo.get() == snapshotPurchaserInfo) {
+                                setLastPurchaserInfo(null, null);
+                            }
+                        }
+                        if (snapshotOfferings != null) {
+                            lastOfferings.compareAndSet(snapshotOfferings, null);
+                        }
+                        sendIdentifyFailed(appUserID, errorContainer);
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+            })));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
-    public void identify(String appUserID, final Promise promise) {
-        CommonKt.identify(appUserID, getOnResult(promise));
+    public void setUserSnapshotCacheLimit(int maxBytes) {
+        boolean traced = RNPurchasesTrace.beginSection("setUserSnapshotCacheLimit");
+        try {
+            userSnapshots.setMaxBytes(maxBytes);
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void createAlias(String newAppUserID, final Promise promise) {
-        CommonKt.createAlias(newAppUserID, getOnResult(promise));
+        boolean traced = RNPurchasesTrace.beginSection("createAlias");
+        try {
+            willChangeAppUser();
+            CommonKt.createAlias(newAppUserID, recordingSwitchedUserPurchaserInfo(getOnResult(promise, null, true)));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setDebugLogsEnabled(boolean enabled) {
-        CommonKt.setDebugLogsEnabled(enabled);
+        boolean traced = RNPurchasesTrace.beginSection("setDebugLogsEnabled");
+        try {
+            CommonKt.setDebugLogsEnabled(enabled);
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void getPurchaserInfo(final Promise promise) {
-        CommonKt.getPurchaserInfo(getOnResult(promise));
+        boolean traced = RNPurchasesTrace.beginSection("getPurchaserInfo");
+        try {
+            final WritableMap metrics = startMetrics("getPurchaserInfo");
+            // keyed by app user, so a request made after the user changed doesn't get the previous user's result
+            final String appUserID = CommonKt.getAppUserID();
+            final String requestKey = "getPurchaserInfo:" + appUserID;
+            if (!addPendingPromise(requestKey, promise)) {
+                return;
+            }
+            CommonKt.getPurchaserInfo(onConversionExecutor(new OnResult() {
+                @Override
+                public void onReceived(Map<String, ?> purchaserInfo) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("getPurchaserInfo.onReceived");
+                    try {
+                        recordSdkCompletion(metrics);
+                        Map<String, ?> map = RNPurchasesDateMillis.addToPurchaserInfo(purchaserInfo);
+                        onPurchaserInfoReceived(appUserID, map);
+                        long conversionStart = System.nanoTime();
+                        for (Promise pendingPromise : removePendingPromises(requestKey)) {
+                            pendingPromise.resolve(convertPayload(map));
+                        }
+                        recordConversion(metrics, conversionStart);
+                        sendMetrics(metrics, map);
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+
+                @Override
+                public void onError(ErrorContainer errorContainer) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("getPurchaserInfo.onError");
+                    try {
+                        recordSdkCompletion(metrics);
+                        for (Promise pendingPromise : removePendingPromises(requestKey)) {
+                            rejectPromise(pendingPromise, errorContainer);
+                        }
+                        sendMetrics(metrics, null);
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+            }));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void getPurchaserInfoLazy(final Promise promise) {
+        boolean traced = RNPurchasesTrace.beginSection("getPurchaserInfoLazy");
+        try {
+            final WritableMap metrics = startMetrics("getPurchaserInfoLazy");
+            final String appUserID = CommonKt.getAppUserID();
+            CommonKt.getPurchaserInfo(onConversionExecutor(new OnResult() {
+                @Override
+                public void onReceived(Map<String, ?> purchaserInfo) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("getPurchaserInfoLazy.onReceived");
+                    try {
+                        recordSdkCompletion(metrics);
+                        Map<String, ?> map = RNPurchasesDateMillis.addToPurchaserInfo(purchaserInfo);
+                        onPurchaserInfoReceived(appUserID, map);
+                        long conversionStart = System.nanoTime();
+                        Map<String, ?> lazyPurchaserInfo = getLazyPurchaserInfo(map);
+                        WritableMap writableMap = convertMapToWriteableMap(lazyPurchaserInfo);
+                        recordConversion(metrics, conversionStart);
+                        promise.resolve(writableMap);
+                        sendMetrics(metrics, lazyPurchaserInfo);
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+
+                @Override
+                public void onError(ErrorContainer errorContainer) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("getPurchaserInfoLazy.onError");
+                    try {
+                        recordSdkCompletion(metrics);
+                        rejectPromise(promise, errorContainer);
+                        sendMetrics(metrics, null);
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+            }));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod(isBlockingSynchronousMethod = true)
+    public WritableMap getPurchaserInfoField(int handle, String field) {
+        boolean traced = RNPurchasesTrace.beginSection("getPurchaserInfoField");
+        try {
+            Object value;
+            synchronized (lazyPurchaserInfos) {
+                value = lazyPurchaserInfos.get(handle);
+            }
+            // synchronous methods can't return arbitrary values, so it's wrapped in a map
+            Map<String, Object> result = new HashMap<>();
+            if (value == null) {
+                // only the last MAX_LAZY_PURCHASER_INFOS handles are kept
+                result.put("evicted", true);
+                return convertMapToWriteableMap(result);
+            }
+            for (String key : field.split("\\.")) {
+                value = value instanceof Map ? ((Map<?, ?>) value).get(key) : null;
+            }
+            result.put("value", value);
+            return convertMapToWriteableMap(result);
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setFinishTransactions(boolean enabled) {
-        CommonKt.setFinishTransactions(enabled);
+        boolean traced = RNPurchasesTrace.beginSection("setFinishTransactions");
+        try {
+            CommonKt.setFinishTransactions(enabled);
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void syncPurchases() {
-        CommonKt.syncPurchases();
+        boolean traced = RNPurchasesTrace.beginSection("syncPurchases");
+        try {
+            if (!operationQueue.submit(RNPurchasesOperationQueue.syncPurchasesOperation(), configuredAppUserID())) {
+                CommonKt.syncPurchases();
+            }
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void isAnonymous(final Promise promise) {
-        promise.resolve(CommonKt.isAnonymous());
+        boolean traced = RNPurchasesTrace.beginSection("isAnonymous");
+        try {
+            promise.resolve(CommonKt.isAnonymous());
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod(isBlockingSynchronousMethod = true)
+    public boolean isAnonymousSync() {
+        boolean traced = RNPurchasesTrace.beginSection("isAnonymousSync");
+        try {
+            return CommonKt.isAnonymous();
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod(isBlockingSynchronousMethod = true)
+    @Nullable
+    public WritableMap getCachedPurchaserInfoSync() {
+        boolean traced = RNPurchasesTrace.beginSection("getCachedPurchaserInfoSync");
+        try {
+            Map<String, ?> purchaserInfo = lastPurchaserInfo.get();
+            return purchaserInfo != null ? convertPayload(purchaserInfo) : null;
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod(isBlockingSynchronousMethod = true)
+    @Nullable
+    public WritableMap getCachedOfferingsSync() {
+        boolean traced = RNPurchasesTrace.beginSection("getCachedOfferingsSync");
+        try {
+            Map<String, ?> offerings = lastOfferings.get();
+            return offerings != null ? convertPayload(offerings) : null;
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void checkTrialOrIntroductoryPriceEligibility(ReadableArray productIDs, final Promise promise) {
-        ArrayList<String> productIDList = new ArrayList<>();
-        for (int i = 0; i < productIDs.size(); i++) {
-            productIDList.add(productIDs.getString(i));
+        boolean traced = RNPurchasesTrace.beginSection("checkTrialOrIntroductoryPriceEligibility");
+        try {
+            ArrayList<String> productIDList = new ArrayList<>();
+            for (int i = 0; i < productIDs.size(); i++) {
+                productIDList.add(productIDs.getString(i));
+            }
+            WritableMap metrics = startMetrics("checkTrialOrIntroductoryPriceEligibility");
+            Map<String, ?> eligibilities = CommonKt.checkTrialOrIntroductoryPriceEligibility(productIDList);
+            recordSdkCompletion(metrics);
+            long conversionStart = System.nanoTime();
+            WritableMap writableMap = convertMapToWriteableMap(eligibilities);
+            recordConversion(metrics, conversionStart);
+            promise.resolve(writableMap);
+            sendMetrics(metrics, eligibilities);
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    // Play Billing has no eligibility to check, every product is known right away so there's a single event
+    @ReactMethod
+    public void checkTrialOrIntroductoryPriceEligibilityStreaming(ReadableArray productIDs, int requestID,
+                                                                  final Promise promise) {
+        boolean traced = RNPurchasesTrace.beginSection("checkTrialOrIntroductoryPriceEligibilityStreaming");
+        try {
+            ArrayList<String> productIDList = new ArrayList<>();
+            for (int i = 0; i < productIDs.size(); i++) {
+                productIDList.add(productIDs.getString(i));
+            }
+            WritableMap metrics = startMetrics("checkTrialOrIntroductoryPriceEligibilityStreaming");
+            Map<String, ?> eligibilities = CommonKt.checkTrialOrIntroductoryPriceEligibility(productIDList);
+            recordSdkCompletion(metrics);
+            long conversionStart = System.nanoTime();
+            WritableMap event = Arguments.createMap();
+            event.putInt("requestID", requestID);
+            event.putMap("eligibilities", convertMapToWriteableMap(eligibilities));
+            WritableMap writableMap = convertMapToWriteableMap(eligibilities);
+            recordConversion(metrics, conversionStart);
+            reactContext.getJSModule(DeviceEventManagerModule.RCTDeviceEventEmitter.class)
+                    .emit(RNPurchasesModule.INTRO_ELIGIBILITY, event);
+            promise.resolve(writableMap);
+            sendMetrics(metrics, eligibilities);
+        } finally {
+            RNPurchasesTrace.endSection(traced);
         }
-        promise.resolve(convertMapToWriteableMap(CommonKt.checkTrialOrIntroductoryPriceEligibility(productIDList)));
     }
 
     @Override
-    public void onReceived(@NonNull PurchaserInfo purchaserInfo) {
-        reactContext.getJSModule(DeviceEventManagerModule.RCTDeviceEventEmitter.class)
-                .emit(RNPurchasesModule.PURCHASER_INFO_UPDATED,
-                        convertMapToWriteableMap(PurchaserInfoMapperKt.map(purchaserInfo)));
+    public void onReceived(@NonNull final PurchaserInfo purchaserInfo) {
+        // the SDK sends the purchaser info of its current user, which can change before the executor gets to it
+        final String appUserID = CommonKt.getAppUserID();
+        runOnConversionExecutor(new Runnable() {
+            @Override
+            public void run() {
+                boolean traced = RNPurchasesTrace.beginSection("onPurchaserInfoUpdated");
+                try {
+                    Map<String, ?> purchaserInfoMap =
+                            RNPurchasesDateMillis.addToPurchaserInfo(PurchaserInfoMapperKt.map(purchaserInfo));
+                    onPurchaserInfoReceived(appUserID, purchaserInfoMap);
+                    if (!observedEvents.contains(PURCHASER_INFO_UPDATED)
+                            || isPurchaserInfoEqual(purchaserInfoMap,
+                            lastEmittedPurchaserInfo.getAndSet(purchaserInfoMap))) {
+                        return;
+                    }
+                    emitLatest(PURCHASER_INFO_UPDATED, purchaserInfoMap);
+                } finally {
+                    RNPurchasesTrace.endSection(traced);
+                }
+            }
+        });
+    }
+
+    @ReactMethod
+    public void setEventObserved(String eventName, boolean observed) {
+        boolean traced = RNPurchasesTrace.beginSection("setEventObserved");
+        try {
+            if (observed) {
+                observedEvents.add(eventName);
+            } else {
+                observedEvents.remove(eventName);
+                if (PURCHASER_INFO_UPDATED.equals(eventName)) {
+                    // the next listener gets the purchaser info it missed
+                    lastEmittedPurchaserInfo.set(null);
+                }
+            }
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void setPurchaserInfoMode(String mode) {
+        boolean traced = RNPurchasesTrace.beginSection("setPurchaserInfoMode");
+        try {
+            summaryPurchaserInfos = "summary".equals(mode);
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void getTransactions(@Nullable final String after, final int limit, final Promise promise) {
+        boolean traced = RNPurchasesTrace.beginSection("getTransactions");
+        try {
+            // it's refetched when the SDK switched to another app user since it was received
+            final String appUserID = CommonKt.getAppUserID();
+            Map<String, ?> purchaserInfo = getLastPurchaserInfo(appUserID);
+            if (purchaserInfo != null) {
+                resolveTransactions(purchaserInfo, after, limit, promise);
+                return;
+            }
+            CommonKt.getPurchaserInfo(onConversionExecutor(new OnResult() {
+                @Override
+                public void onReceived(Map<String, ?> fetchedPurchaserInfo) {
+                    boolean tracedCallback = RNPurchasesTrace.beginSection("getTransactions.onReceived");
+                    try {
+                        Map<String, ?> map = RNPurchasesDateMillis.addToPurchaserInfo(fetchedPurchaserInfo);
+                        onPurchaserInfoReceived(appUserID, map);
+                        resolveTransactions(map, after, limit, promise);
+                    } finally {
+                        RNPurchasesTrace.endSection(tracedCallback);
+                    }
+                }
+
+                @Override
+                public void onError(ErrorContainer errorContainer) {
+                    rejectPromise(promise, errorContainer);
+                }
+            }));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void setPayloadEncoding(String encoding) {
+        boolean traced = RNPurchasesTrace.beginSection("setPayloadEncoding");
+        try {
+            compactPayloads = "compact".equals(encoding);
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void setPerformanceMetricsEnabled(boolean enabled) {
+        boolean traced = RNPurchasesTrace.beginSection("setPerformanceMetricsEnabled");
+        try {
+            performanceMetricsEnabled = enabled;
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void invalidatePurchaserInfoCache() {
-        CommonKt.invalidatePurchaserInfoCache();
+        boolean traced = RNPurchasesTrace.beginSection("invalidatePurchaserInfoCache");
+        try {
+            CommonKt.invalidatePurchaserInfoCache();
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void getQueuedOperationCount(final Promise promise) {
+        boolean traced = RNPurchasesTrace.beginSection("getQueuedOperationCount");
+        try {
+            promise.resolve(operationQueue.depth());
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setProxyURLString(String proxyURLString) {
-        CommonKt.setProxyURLString(proxyURLString);
+        boolean traced = RNPurchasesTrace.beginSection("setProxyURLString");
+        try {
+            CommonKt.setProxyURLString(proxyURLString);
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     //================================================================================
@@ -230,60 +1163,124 @@ public class RNPurchasesModule extends ReactContextBaseJavaModule implements Upd
 
     @ReactMethod
     public void setAttributes(ReadableMap attributes) {
-        HashMap attributesHashMap = attributes.toHashMap();
-        SubscriberAttributesKt.setAttributes(attributesHashMap);
+        boolean traced = RNPurchasesTrace.beginSection("setAttributes");
+        try {
+            submitAttributes(Collections.singletonMap("attributes", attributes.toHashMap()));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
+    }
+
+    @ReactMethod
+    public void setAttributesBatch(ReadableMap batch) {
+        boolean traced = RNPurchasesTrace.beginSection("setAttributesBatch");
+        try {
+            submitAttributes(batch.toHashMap());
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setEmail(String email) {
-      SubscriberAttributesKt.setEmail(email);
+        boolean traced = RNPurchasesTrace.beginSection("setEmail");
+        try {
+          submitAttributes(Collections.singletonMap("email", email));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setPhoneNumber(String phoneNumber) {
-      SubscriberAttributesKt.setPhoneNumber(phoneNumber);
+        boolean traced = RNPurchasesTrace.beginSection("setPhoneNumber");
+        try {
+          submitAttributes(Collections.singletonMap("phoneNumber", phoneNumber));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setDisplayName(String displayName) {
-      SubscriberAttributesKt.setDisplayName(displayName);
+        boolean traced = RNPurchasesTrace.beginSection("setDisplayName");
+        try {
+          submitAttributes(Collections.singletonMap("displayName", displayName));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setPushToken(String pushToken) {
-      SubscriberAttributesKt.setPushToken(pushToken);
+        boolean traced = RNPurchasesTrace.beginSection("setPushToken");
+        try {
+          submitAttributes(Collections.singletonMap("pushToken", pushToken));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     // region Attribution IDs
 
     @ReactMethod
     public void collectDeviceIdentifiers() {
-      SubscriberAttributesKt.collectDeviceIdentifiers();
+        boolean traced = RNPurchasesTrace.beginSection("collectDeviceIdentifiers");
+        try {
+          submitAttributes(Collections.singletonMap("collectDeviceIdentifiers", true));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setAdjustID(String adjustID) {
-      SubscriberAttributesKt.setAdjustID(adjustID);
+        boolean traced = RNPurchasesTrace.beginSection("setAdjustID");
+        try {
+          submitAttributes(Collections.singletonMap("adjustID", adjustID));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setAppsflyerID(String appsflyerID) {
-      SubscriberAttributesKt.setAppsflyerID(appsflyerID);
+        boolean traced = RNPurchasesTrace.beginSection("setAppsflyerID");
+        try {
+          submitAttributes(Collections.singletonMap("appsflyerID", appsflyerID));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setFBAnonymousID(String fbAnonymousID) {
-      SubscriberAttributesKt.setFBAnonymousID(fbAnonymousID);
+        boolean traced = RNPurchasesTrace.beginSection("setFBAnonymousID");
+        try {
+          submitAttributes(Collections.singletonMap("fbAnonymousID", fbAnonymousID));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setMparticleID(String mparticleID) {
-      SubscriberAttributesKt.setMparticleID(mparticleID);
+        boolean traced = RNPurchasesTrace.beginSection("setMparticleID");
+        try {
+          submitAttributes(Collections.singletonMap("mparticleID", mparticleID));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setOnesignalID(String onesignalID) {
-      SubscriberAttributesKt.setOnesignalID(onesignalID);
+        boolean traced = RNPurchasesTrace.beginSection("setOnesignalID");
+        try {
+          submitAttributes(Collections.singletonMap("onesignalID", onesignalID));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     // endregion
@@ -292,32 +1289,62 @@ public class RNPurchasesModule extends ReactContextBaseJavaModule implements Upd
 
     @ReactMethod
     public void setMediaSource(String mediaSource) {
-        SubscriberAttributesKt.setMediaSource(mediaSource);
+        boolean traced = RNPurchasesTrace.beginSection("setMediaSource");
+        try {
+            submitAttributes(Collections.singletonMap("mediaSource", mediaSource));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setCampaign(String campaign) {
-        SubscriberAttributesKt.setCampaign(campaign);
+        boolean traced = RNPurchasesTrace.beginSection("setCampaign");
+        try {
+            submitAttributes(Collections.singletonMap("campaign", campaign));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setAdGroup(String adGroup) {
-        SubscriberAttributesKt.setAdGroup(adGroup);
+        boolean traced = RNPurchasesTrace.beginSection("setAdGroup");
+        try {
+            submitAttributes(Collections.singletonMap("adGroup", adGroup));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setAd(String ad) {
-        SubscriberAttributesKt.setAd(ad);
+        boolean traced = RNPurchasesTrace.beginSection("setAd");
+        try {
+            submitAttributes(Collections.singletonMap("ad", ad));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setKeyword(String keyword) {
-        SubscriberAttributesKt.setKeyword(keyword);
+        boolean traced = RNPurchasesTrace.beginSection("setKeyword");
+        try {
+            submitAttributes(Collections.singletonMap("keyword", keyword));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     @ReactMethod
     public void setCreative(String creative) {
-        SubscriberAttributesKt.setCreative(creative);
+        boolean traced = RNPurchasesTrace.beginSection("setCreative");
+        try {
+            submitAttributes(Collections.singletonMap("creative", creative));
+        } finally {
+            RNPurchasesTrace.endSection(traced);
+        }
     }
 
     // endregion
@@ -326,20 +1353,634 @@ public class RNPurchasesModule extends ReactContextBaseJavaModule implements Upd
     // Private methods
     //================================================================================
 
+    // Keeps the offerings in memory and on disk, and lets JS know if they changed since the last snapshot
+    private void onOfferingsReceived(Map<String, ?> offerings) {
+        lastOfferings.set(offerings);
+        String appUserID = CommonKt.getAppUserID();
+        userSnapshots.putOfferings(appUserID, offerings);
+        boolean hadSnapshot = offeringsSnapshot.contains(appUserID);
+        if (offeringsSnapshot.write(appUserID, offerings) && hadSnapshot && observedEvents.contains(OFFERINGS_UPDATED)) {
+            emitLatest(OFFERINGS_UPDATED, offerings);
+        }
+    }
+
+    // On the conversion executor. In the background only the latest payload of each event is kept, and converted
+    // once the app is back in the foreground
+    private void emitLatest(String eventName, Map<String, ?> payload) {
+        if (inBackground) {
+            pendingEvents.put(eventName, payload);
+            return;
+        }
+        // anything still pending is older than this payload
+        pendingEvents.remove(eventName);
+        reactContext.getJSModule(DeviceEventManagerModule.RCTDeviceEventEmitter.class)
+                .emit(eventName, convertPayload(payload));
+    }
+
+    // Sent before the restore resolves, so JS still has the listener of the request
+    private void sendRestoreProgress(int requestID, String stage, int processedProductCount,
+                                     int purchasedProductCount) {
+        if (!observedEvents.contains(RESTORE_PROGRESS)) {
+            return;
+        }
+        WritableMap event = Arguments.createMap();
+        event.putInt("requestID", requestID);
+        event.putString("stage", stage);
+        event.putInt("processedProductCount", processedProductCount);
+        event.putInt("purchasedProductCount", purchasedProductCount);
+        reactContext.getJSModule(DeviceEventManagerModule.RCTDeviceEventEmitter.class)
+                .emit(RESTORE_PROGRESS, event);
+    }
+
+    private void sendIdentifyFailed(String appUserID, ErrorContainer errorContainer) {
+        if (!observedEvents.contains(IDENTIFY_FAILED)) {
+            return;
+        }
+        WritableMap event = Arguments.createMap();
+        event.putString("appUserID", appUserID);
+        event.putMap("error", convertMapToWriteableMap(errorContainer.getInfo()));
+        reactContext.getJSModule(DeviceEventManagerModule.RCTDeviceEventEmitter.class)
+                .emit(IDENTIFY_FAILED, event);
+    }
+
+    // On the conversion executor
+    private void flushPendingEvents() {
+        List<Map.Entry<String, Map<String, ?>>> events = new ArrayList<>(pendingEvents.entrySet());
+        pendingEvents.clear();
+        for (Map.Entry<String, Map<String, ?>> event : events) {
+            if (observedEvents.contains(event.getKey())) {
+                emitLatest(event.getKey(), event.getValue());
+            }
+        }
+    }
+
+    // The page of nonSubscriptionTransactions after the transaction with the revenueCatId after, from the start without one
+    private static void resolveTransactions(Map<String, ?> purchaserInfo,
+                                            @Nullable String after,
+                                            int limit,
+                                            Promise promise) {
+        Object nonSubscriptionTransactions = purchaserInfo.get("nonSubscriptionTransactions");
+        List<?> transactions = nonSubscriptionTransactions instanceof List
+                ? (List<?>) nonSubscriptionTransactions
+                : Collections.emptyList();
+        int start = 0;
+        if (after != null) {
+            start = -1;
+            for (int i = 0; i < transactions.size(); i++) {
+                Object transaction = transactions.get(i);
+                if (transaction instanceof Map && after.equals(((Map<?, ?>) transaction).get("revenueCatId"))) {
+                    start = i + 1;
+                    break;
+                }
+            }
+            if (start < 0) {
+                promise.reject(PurchasesErrorCode.UnknownError.getCode() + "",
+                        "Transaction " + after + " isn't in the purchaser info anymore");
+                return;
+            }
+        }
+        int end = Math.min(transactions.size(), start + Math.max(limit, 1));
+        List<?> page = transactions.subList(start, end);
+        Object lastTransaction = page.isEmpty() ? null : page.get(page.size() - 1);
+        Map<String, Object> result = new HashMap<>();
+        result.put("transactions", new ArrayList<>(page));
+        result.put("nextCursor", end < transactions.size() && lastTransaction instanceof Map
+                ? ((Map<?, ?>) lastTransaction).get("revenueCatId")
+                : null);
+        result.put("totalCount", transactions.size());
+        promise.resolve(convertMapToWriteableMap(result));
+    }
+
+    // appUserID is the user the request was made for, the SDK may have switched to another one since. Its purchaser
+    // info is still kept in its snapshot, but it doesn't replace the cached one of the current user
+    private void onPurchaserInfoReceived(String appUserID, Map<String, ?> purchaserInfo) {
+        synchronized (lastPurchaserInfo) {
+            if (appUserID.equals(configuredAppUserID())) {
+                setLastPurchaserInfo(appUserID, purchaserInfo);
+            }
+        }
+        userSnapshots.putPurchaserInfo(appUserID, purchaserInfo);
+    }
+
+    private void setLastPurchaserInfo(@Nullable String appUserID, @Nullable Map<String, ?> purchaserInfo) {
+        synchronized (lastPurchaserInfo) {
+            lastPurchaserInfoAppUserID = appUserID;
+            lastPurchaserInfo.set(purchaserInfo);
+        }
+    }
+
+    // null when there's none, or it belongs to another app user than appUserID
+    @Nullable
+    private Map<String, ?> getLastPurchaserInfo(String appUserID) {
+        synchronized (lastPurchaserInfo) {
+            return appUserID.equals(lastPurchaserInfoAppUserID) ? lastPurchaserInfo.get() : null;
+        }
+    }
+
+    private static Map<String, ?> getPurchaserInfoSummary(Map<String, ?> purchaserInfo) {
+        Map<String, Object> summary = new HashMap<>(purchaserInfo);
+        for (String key : SUMMARY_EMPTY_PURCHASER_INFO_MAPS) {
+            if (summary.containsKey(key)) {
+                summary.put(key, Collections.emptyMap());
+            }
+        }
+        Object transactions = purchaserInfo.get("nonSubscriptionTransactions");
+        summary.put("nonSubscriptionTransactions", Collections.emptyList());
+        summary.put("nonSubscriptionTransactionCount", transactions instanceof List ? ((List<?>) transactions).size() : 0);
+        summary.put("isSummary", true);
+        return summary;
+    }
+
+    // Keeps the full purchaser info for getPurchaserInfoField, and sends JS everything but the lazy fields
+    private Map<String, ?> getLazyPurchaserInfo(Map<String, ?> purchaserInfo) {
+        int handle;
+        synchronized (lazyPurchaserInfos) {
+            handle = ++lastLazyPurchaserInfoHandle;
+            lazyPurchaserInfos.put(handle, purchaserInfo);
+            lazyPurchaserInfos.remove(handle - MAX_LAZY_PURCHASER_INFOS);
+        }
+        Map<String, Object> lazyPurchaserInfo = new HashMap<>(purchaserInfo);
+        Object entitlements = purchaserInfo.get("entitlements");
+        if (entitlements instanceof Map) {
+            Map<Object, Object> lazyEntitlements = new HashMap<>((Map<?, ?>) entitlements);
+            lazyEntitlements.remove("all");
+            lazyPurchaserInfo.put("entitlements", lazyEntitlements);
+        }
+        for (String field : LAZY_PURCHASER_INFO_FIELDS) {
+            lazyPurchaserInfo.remove(field);
+        }
+        lazyPurchaserInfo.put("lazyFieldsHandle", handle);
+        lazyPurchaserInfo.put("lazyFields", LAZY_PURCHASER_INFO_FIELDS);
+        return lazyPurchaserInfo;
+    }
+
+    @Nullable
+    private static String getProductIdentifier(Map<String, ?> offerings,
+                                               String packageIdentifier,
+                                               String offeringIdentifier) {
+        Object allOfferings = offerings.get("all");
+        Object offering = allOfferings instanceof Map ? ((Map<?, ?>) allOfferings).get(offeringIdentifier) : null;
+        Object packages = offering instanceof Map ? ((Map<?, ?>) offering).get("availablePackages") : null;
+        if (!(packages instanceof List)) {
+            return null;
+        }
+        for (Object aPackage : (List<?>) packages) {
+            if (aPackage instanceof Map && packageIdentifier.equals(((Map<?, ?>) aPackage).get("identifier"))) {
+                Object product = ((Map<?, ?>) aPackage).get("product");
+                return product instanceof Map ? (String) ((Map<?, ?>) product).get("identifier") : null;
+            }
+        }
+        return null;
+    }
+
+    // Returns what preparePurchase resolves with
+    private Map<String, Object> addPreparedPurchase(String packageIdentifier,
+                                                    String offeringIdentifier,
+                                                    String productIdentifier) {
+        Map<String, Object> preparedPurchase = new HashMap<>();
+        preparedPurchase.put("packageIdentifier", packageIdentifier);
+        preparedPurchase.put("offeringIdentifier", offeringIdentifier);
+        preparedPurchase.put("preparedAt", SystemClock.elapsedRealtime());
+        int handle;
+        synchronized (preparedPurchases) {
+            handle = ++lastPreparedPurchaseHandle;
+            preparedPurchases.put(handle, preparedPurchase);
+            preparedPurchases.remove(handle - MAX_PREPARED_PURCHASES);
+        }
+        Map<String, Object> result = new HashMap<>();
+        result.put("handle", handle);
+        result.put("productIdentifier", productIdentifier);
+        result.put("paymentDiscount", null);
+        return result;
+    }
+
+    // Returns false when an identical request is already in flight, the promise is then settled with its result
+    private boolean addPendingPromise(String requestKey, Promise promise) {
+        synchronized (pendingPromises) {
+            List<Promise> promises = pendingPromises.get(requestKey);
+            boolean isNewRequest = promises == null;
+            if (isNewRequest) {
+                promises = new ArrayList<>();
+                pendingPromises.put(requestKey, promises);
+            }
+            promises.add(promise);
+            return isNewRequest;
+        }
+    }
+
+    @NonNull
+    private List<Promise> removePendingPromises(String requestKey) {
+        synchronized (pendingPromises) {
+            List<Promise> promises = pendingPromises.remove(requestKey);
+            return promises != null ? promises : new ArrayList<Promise>();
+        }
+    }
+
+    private static WritableArray convertProductsToWritableArray(List<Map<String, ?>> products) {
+        WritableArray writableArray = Arguments.createArray();
+        for (Map<String, ?> product : products) {
+            writableArray.pushMap(convertMapToWriteableMap(product));
+        }
+        return writableArray;
+    }
+
+    private static void addProductsByIdentifier(Map<String, Map<String, ?>> productsByIdentifier,
+                                                List<Map<String, ?>> products) {
+        synchronized (productsByIdentifier) {
+            for (Map<String, ?> product : products) {
+                Object identifier = product.get("identifier");
+                if (identifier instanceof String && !productsByIdentifier.containsKey(identifier)) {
+                    productsByIdentifier.put((String) identifier, product);
+                }
+            }
+        }
+    }
+
+    private void resolveProductsBatch(Promise promise,
+                                      @Nullable WritableMap metrics,
+                                      List<String> productIDs,
+                                      Map<String, Map<String, ?>> productsByIdentifier) {
+        long conversionStart = System.nanoTime();
+        List<Map<String, ?>> products = new ArrayList<>();
+        synchronized (productsByIdentifier) {
+            for (String productID : productIDs) {
+                Map<String, ?> product = productsByIdentifier.get(productID);
+                if (product != null) {
+                    products.add(product);
+                }
+            }
+        }
+        promise.resolve(convertProductsToWritableArray(products));
+        recordConversion(metrics, conversionStart);
+        sendMetrics(metrics, products);
+    }
+
+    // Returns null when performance metrics are disabled. Timestamps are in milliseconds since 1970, same as Date.now()
+    @Nullable
+    private WritableMap startMetrics(String method) {
+        if (!performanceMetricsEnabled) {
+            return null;
+        }
+        WritableMap metrics = Arguments.createMap();
+        metrics.putString("method", method);
+        metrics.putDouble("nativeEntry", System.currentTimeMillis());
+        metrics.putDouble("conversionMillis", 0);
+        return metrics;
+    }
+
+    private static void recordSdkCompletion(@Nullable WritableMap metrics) {
+        if (metrics != null) {
+            metrics.putDouble("sdkCompletion", System.currentTimeMillis());
+        }
+    }
+
+    private static void recordConversion(@Nullable WritableMap metrics, long conversionStartNanos) {
+        if (metrics != null) {
+            metrics.putDouble("conversionMillis", (System.nanoTime() - conversionStartNanos) / 1e6);
+        }
+    }
+
+    // Called right after resolving, the payload is measured afterwards so it doesn't delay the result
+    private void sendMetrics(@Nullable WritableMap metrics, @Nullable Object result) {
+        if (metrics == null || !observedEvents.contains(METRICS)) {
+            return;
+        }
+        metrics.putDouble("resolve", System.currentTimeMillis());
+        String payload = "";
+        if (result instanceof Map) {
+            payload = new JSONObject((Map<?, ?>) result).toString();
+        } else if (result instanceof List) {
+            payload = new JSONArray((List<?>) result).toString();
+        }
+        metrics.putInt("payloadBytes", payload.getBytes(Charset.forName("UTF-8")).length);
+        reactContext.getJSModule(DeviceEventManagerModule.RCTDeviceEventEmitter.class)
+                .emit(RNPurchasesModule.METRICS, metrics);
+    }
+
+    private static void rejectPromise(Promise promise, ErrorContainer errorContainer) {
+        promise.reject(errorContainer.getCode() + "", errorContainer.getMessage(),
+                convertMapToWriteableMap(errorContainer.getInfo()));
+    }
+
+    // requestDate changes on every fetch, so it's not taken into account when looking for changes
+    private static boolean isPurchaserInfoEqual(Map<String, ?> purchaserInfo,
+                                                @Nullable Map<String, ?> otherPurchaserInfo) {
+        if (otherPurchaserInfo == null) {
+            return false;
+        }
+        Map<String, ?> comparable = new HashMap<>(purchaserInfo);
+        Map<String, ?> otherComparable = new HashMap<>(otherPurchaserInfo);
+        for (String ignoredKey : new String[]{"requestDate", "requestDateMillis"}) {
+            comparable.remove(ignoredKey);
+            otherComparable.remove(ignoredKey);
+        }
+        return comparable.equals(otherComparable);
+    }
+
+    // Keys and values are the ones of setAttributesBatch
+    private static void applyAttributesBatch(Map<String, ?> batch) {
+        Object attributes = batch.get("attributes");
+        if (attributes instanceof Map) {
+            SubscriberAttributesKt.setAttributes((Map) attributes);
+        }
+        if (batch.containsKey("email")) {
+            SubscriberAttributesKt.setEmail((String) batch.get("email"));
+        }
+        if (batch.containsKey("phoneNumber")) {
+            SubscriberAttributesKt.setPhoneNumber((String) batch.get("phoneNumber"));
+        }
+        if (batch.containsKey("displayName")) {
+            SubscriberAttributesKt.setDisplayName((String) batch.get("displayName"));
+        }
+        if (batch.containsKey("pushToken")) {
+            SubscriberAttributesKt.setPushToken((String) batch.get("pushToken"));
+        }
+        if (batch.containsKey("adjustID")) {
+            SubscriberAttributesKt.setAdjustID((String) batch.get("adjustID"));
+        }
+        if (batch.containsKey("appsflyerID")) {
+            SubscriberAttributesKt.setAppsflyerID((String) batch.get("appsflyerID"));
+        }
+        if (batch.containsKey("fbAnonymousID")) {
+            SubscriberAttributesKt.setFBAnonymousID((String) batch.get("fbAnonymousID"));
+        }
+        if (batch.containsKey("mparticleID")) {
+            SubscriberAttributesKt.setMparticleID((String) batch.get("mparticleID"));
+        }
+        if (batch.containsKey("onesignalID")) {
+            SubscriberAttributesKt.setOnesignalID((String) batch.get("onesignalID"));
+        }
+        if (batch.containsKey("mediaSource")) {
+            SubscriberAttributesKt.setMediaSource((String) batch.get("mediaSource"));
+        }
+        if (batch.containsKey("campaign")) {
+            SubscriberAttributesKt.setCampaign((String) batch.get("campaign"));
+        }
+        if (batch.containsKey("adGroup")) {
+            SubscriberAttributesKt.setAdGroup((String) batch.get("adGroup"));
+        }
+        if (batch.containsKey("ad")) {
+            SubscriberAttributesKt.setAd((String) batch.get("ad"));
+        }
+        if (batch.containsKey("keyword")) {
+            SubscriberAttributesKt.setKeyword((String) batch.get("keyword"));
+        }
+        if (batch.containsKey("creative")) {
+            SubscriberAttributesKt.setCreative((String) batch.get("creative"));
+        }
+        if (Boolean.TRUE.equals(batch.get("collectDeviceIdentifiers"))) {
+            SubscriberAttributesKt.collectDeviceIdentifiers();
+        }
+    }
+
+    private void submitAttributes(Map<String, ?> batch) {
+        if (!operationQueue.submit(RNPurchasesOperationQueue.attributesOperation(batch), configuredAppUserID())) {
+            applyAttributesBatch(batch);
+        }
+    }
+
+    // Replays the merged operations queued while offline, on the conversion executor since the queue is read from disk
+    private void flushOperationQueue() {
+        runOnConversionExecutor(new Runnable() {
+            @Override
+            public void run() {
+                operationQueue.flush(configuredAppUserID(), operationReplayer());
+            }
+        });
+    }
+
     @NotNull
-    private OnResult getOnResult(final Promise promise) {
+    private RNPurchasesOperationQueue.Replayer operationReplayer() {
+        return new RNPurchasesOperationQueue.Replayer() {
+            @Override
+            public void replay(@NotNull RNPurchasesOperationQueue.Batch batch) {
+                boolean traced = RNPurchasesTrace.beginSection("flushOperationQueue");
+                try {
+                    WritableMap metrics = startMetrics("flushOperationQueue");
+                    applyAttributesBatch(batch.getAttributes());
+                    for (JSONObject attribution : batch.getAttributions()) {
+                        try {
+                            SubscriberAttributesKt.addAttributionData(attribution.getJSONObject("data"),
+                                    attribution.getInt("network"),
+                                    attribution.isNull("networkUserId")
+                                            ? null : attribution.getString("networkUserId"));
+                        } catch (JSONException e) {
+                            Log.e("RNPurchases", "Error reading queued attribution data: " + e.getLocalizedMessage());
+                        }
+                    }
+                    if (batch.getSyncPurchases()) {
+                        CommonKt.syncPurchases();
+                    }
+                    recordSdkCompletion(metrics);
+                    if (metrics != null) {
+                        metrics.putInt("queueDepth", batch.getOperationCount());
+                    }
+                    sendMetrics(metrics, null);
+                } finally {
+                    RNPurchasesTrace.endSection(traced);
+                }
+            }
+        };
+    }
+
+    @Nullable
+    private static String configuredAppUserID() {
+        try {
+            return CommonKt.getAppUserID();
+        } catch (UninitializedPropertyAccessException e) {
+            // setupPurchases wasn't called yet
+            return null;
+        }
+    }
+
+    private void runOnConversionExecutor(Runnable runnable) {
+        try {
+            conversionExecutor.execute(runnable);
+        } catch (RejectedExecutionException e) {
+            // the catalyst instance is gone, there's nothing left to resolve or emit to
+        }
+    }
+
+    @NotNull
+    private OnResult onConversionExecutor(final OnResult onResult) {
         return new OnResult() {
             @Override
-            public void onReceived(Map<String, ?> map) {
-                promise.resolve(convertMapToWriteableMap(map));
+            public void onReceived(final Map<String, ?> map) {
+                runOnConversionExecutor(new Runnable() {
+                    @Override
+                    public void run() {
+                        onResult.onReceived(map);
+                    }
+                });
+            }
+
+            @Override
+            public void onError(final ErrorContainer errorContainer) {
+                runOnConversionExecutor(new Runnable() {
+                    @Override
+                    public void run() {
+                        onResult.onError(errorContainer);
+                    }
+                });
+            }
+        };
+    }
+
+    @NotNull
+    private OnResultList onConversionExecutor(final OnResultList onResultList) {
+        return new OnResultList() {
+            @Override
+            public void onReceived(final List<Map<String, ?>> map) {
+                runOnConversionExecutor(new Runnable() {
+                    @Override
+                    public void run() {
+                        onResultList.onReceived(map);
+                    }
+                });
+            }
+
+            @Override
+            public void onError(final ErrorContainer errorContainer) {
+                runOnConversionExecutor(new Runnable() {
+                    @Override
+                    public void run() {
+                        onResultList.onError(errorContainer);
+                    }
+                });
+            }
+        };
+    }
+
+    // Offerings and purchaser infos go through here, in the encoding set with setPayloadEncoding
+    private WritableMap convertPayload(Map<String, ?> payload) {
+        if (summaryPurchaserInfos && payload.containsKey("entitlements")) {
+            payload = getPurchaserInfoSummary(payload);
+        }
+        return compactPayloads
+                ? RNPurchasesConverters.convertMapToCompactWritableMap(payload)
+                : convertMapToWriteableMap(payload);
+    }
+
+    // Keeps the purchaser info identify completes with as the cached one and as the snapshot of the user
+    private OnResult onIdentified(final String appUserID, final OnResult onResult) {
+        return new OnResult() {
+            @Override
+            public void onReceived(final Map<String, ?> purchaserInfo) {
+                runOnConversionExecutor(new Runnable() {
+                    @Override
+                    public void run() {
+                        onPurchaserInfoReceived(appUserID, RNPurchasesDateMillis.addToPurchaserInfo(purchaserInfo));
+                    }
+                });
+                onResult.onReceived(purchaserInfo);
             }
 
             @Override
             public void onError(ErrorContainer errorContainer) {
-                promise.reject(errorContainer.getCode() + "", errorContainer.getMessage(),
-                        convertMapToWriteableMap(errorContainer.getInfo()));
+                onResult.onError(errorContainer);
             }
         };
     }
 
+    // Keeps the purchaser info of purchase and restore results as the cached one of the app user they were made for.
+    // It's queued on the conversion executor ahead of the conversion of onResult, so it's kept before the promise
+    // resolves
+    private OnResult recordingPurchaserInfo(final String appUserID, final OnResult onResult) {
+        return new OnResult() {
+            @Override
+            public void onReceived(final Map<String, ?> result) {
+                final Object purchaserInfo = result.containsKey("purchaserInfo") ? result.get("purchaserInfo") : result;
+                if (purchaserInfo instanceof Map) {
+                    runOnConversionExecutor(new Runnable() {
+                        @Override
+                        @SuppressWarnings("unchecked")
+                        public void run() {
+                            onPurchaserInfoReceived(appUserID,
+                                    RNPurchasesDateMillis.addToPurchaserInfo((Map<String, ?>) purchaserInfo));
+                        }
+                    });
+                }
+                onResult.onReceived(result);
+            }
+
+            @Override
+            public void onError(ErrorContainer errorContainer) {
+                onResult.onError(errorContainer);
+            }
+        };
+    }
+
+    // Same as recordingPurchaserInfo for the results of app user changes, which belong to the user the SDK switched to
+    private OnResult recordingSwitchedUserPurchaserInfo(final OnResult onResult) {
+        return new OnResult() {
+            @Override
+            public void onReceived(Map<String, ?> result) {
+                recordingPurchaserInfo(CommonKt.getAppUserID(), onResult).onReceived(result);
+            }
+
+            @Override
+            public void onError(ErrorContainer errorContainer) {
+                onResult.onError(errorContainer);
+            }
+        };
+    }
+
+    // The cached purchaser info and offerings belong to the app user being replaced, they're not served as the next
+    // one's. The operations still queued were made for that user too, they're handed to the SDK before the switch even
+    // if offline, so they're not dropped
+    private void willChangeAppUser() {
+        String appUserID = configuredAppUserID();
+        if (appUserID != null) {
+            operationQueue.flush(appUserID, operationReplayer(), true);
+        }
+        setLastPurchaserInfo(null, null);
+        lastOfferings.set(null);
+    }
+
+    @NotNull
+    private OnResult getOnResult(final Promise promise) {
+        return getOnResult(promise, null);
+    }
+
+    @NotNull
+    private OnResult getOnResult(final Promise promise, @Nullable final WritableMap metrics) {
+        return getOnResult(promise, metrics, false);
+    }
+
+    @NotNull
+    private OnResult getOnResult(final Promise promise,
+                                 @Nullable final WritableMap metrics,
+                                 final boolean isPayload) {
+        return onConversionExecutor(new OnResult() {
+            @Override
+            public void onReceived(Map<String, ?> result) {
+                boolean tracedCallback = RNPurchasesTrace.beginSection("onResult.onReceived");
+                try {
+                    recordSdkCompletion(metrics);
+                    Map<String, ?> map = RNPurchasesDateMillis.addToResult(result);
+                    long conversionStart = System.nanoTime();
+                    WritableMap writableMap = isPayload ? convertPayload(map) : convertMapToWriteableMap(map);
+                    recordConversion(metrics, conversionStart);
+                    promise.resolve(writableMap);
+                    sendMetrics(metrics, map);
+                } finally {
+                    RNPurchasesTrace.endSection(tracedCallback);
+                }
+            }
+
+            @Override
+            public void onError(ErrorContainer errorContainer) {
+                boolean tracedCallback = RNPurchasesTrace.beginSection("onResult.onError");
+                try {
+                    recordSdkCompletion(metrics);
+                    promise.reject(errorContainer.getCode() + "", errorContainer.getMessage(),
+                            convertMapToWriteableMap(errorContainer.getInfo()));
+                    sendMetrics(metrics, null);
+                } finally {
+                    RNPurchasesTrace.endSection(tracedCallback);
+                }
+            }
+        });
+    }
+
 }
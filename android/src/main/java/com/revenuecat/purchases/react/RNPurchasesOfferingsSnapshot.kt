@@ -0,0 +1,59 @@
+package com.revenuecat.purchases.react
+
+import android.content.Context
+import org.json.JSONException
+import org.json.JSONObject
+
+/**
+ * Persists the last offerings fetched for an app user, so they can be served on cold start while fresh
+ * offerings are fetched in the background.
+ */
+internal class RNPurchasesOfferingsSnapshot(context: Context) {
+
+    private val preferences =
+        context.getSharedPreferences("com.revenuecat.purchases.react.offerings", Context.MODE_PRIVATE)
+
+    fun read(appUserID: String): Map<String, Any?>? {
+        val json = readJson(appUserID) ?: return null
+        return try {
+            RNPurchasesConverters.convertJsonToMap(JSONObject(json))
+        } catch (e: JSONException) {
+            null
+        }
+    }
+
+    fun contains(appUserID: String): Boolean = readJson(appUserID) != null
+
+    /**
+     * Stores the offerings for the given app user.
+     * @return true if they are different from the ones previously stored for that user.
+     */
+    fun write(appUserID: String, offerings: Map<String, *>): Boolean {
+        val json = JSONObject(offerings).toString()
+        if (json == readJson(appUserID)) {
+            return false
+        }
+        preferences.edit()
+            .putInt(KEY_VERSION, VERSION)
+            .putString(KEY_APP_USER_ID, appUserID)
+            .putString(KEY_OFFERINGS, json)
+            .apply()
+        return true
+    }
+
+    private fun readJson(appUserID: String): String? {
+        if (preferences.getInt(KEY_VERSION, 0) != VERSION ||
+            preferences.getString(KEY_APP_USER_ID, null) != appUserID) {
+            return null
+        }
+        return preferences.getString(KEY_OFFERINGS, null)
+    }
+
+    private companion object {
+        // Bump when the format of the snapshot changes, older snapshots are ignored
+        const val VERSION = 1
+        const val KEY_VERSION = "version"
+        const val KEY_APP_USER_ID = "appUserID"
+        const val KEY_OFFERINGS = "offerings"
+    }
+}
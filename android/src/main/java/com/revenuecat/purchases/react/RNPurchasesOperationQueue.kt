@@ -0,0 +1,225 @@
+package com.revenuecat.purchases.react
+
+import android.content.BroadcastReceiver
+import android.content.Context
+import android.content.Intent
+import android.content.IntentFilter
+import android.net.ConnectivityManager
+import android.util.Log
+import org.json.JSONException
+import org.json.JSONObject
+import java.io.File
+import java.io.IOException
+
+/**
+ * Subscriber attribute writes, attribution data and syncPurchases calls made before setupPurchases or while the
+ * device is offline. They are appended to a file, one JSON operation per line, so they survive the app being killed,
+ * and replayed together once connectivity returns.
+ */
+internal class RNPurchasesOperationQueue(context: Context) {
+
+    /**
+     * The queued operations merged: the latest value for each attribute key, the latest attribution data for each
+     * network, and whether purchases have to be synced.
+     */
+    class Batch(
+        /**
+         * In the format of setAttributesBatch.
+         */
+        val attributes: Map<String, Any?>,
+        val attributions: List<JSONObject>,
+        val syncPurchases: Boolean,
+        val operationCount: Int
+    )
+
+    interface Replayer {
+        fun replay(batch: Batch)
+    }
+
+    private val context = context.applicationContext
+    private val file = File(this.context.filesDir, "RNPurchasesOperationQueue")
+    private var depth = -1
+    private var flushing = false
+    private var receiver: BroadcastReceiver? = null
+
+    /**
+     * Number of operations waiting for connectivity.
+     */
+    @Synchronized
+    fun depth(): Int {
+        if (depth < 0) {
+            depth = if (file.exists()) readLines().size else 0
+        }
+        return depth
+    }
+
+    /**
+     * Queues the operation when offline or before [startMonitoring], along with the user it was made for.
+     * @param appUserID null before setupPurchases, those operations are replayed for the configured user.
+     * @return false if the caller has to perform the operation right away.
+     */
+    @Synchronized
+    fun submit(operation: JSONObject, appUserID: String?): Boolean {
+        if (receiver != null && isOnline()) {
+            return false
+        }
+        val queuedOperations = depth()
+        return try {
+            file.appendText(operation.put(OPERATION_APP_USER_ID, appUserID ?: JSONObject.NULL).toString() + "\n")
+            depth = queuedOperations + 1
+            true
+        } catch (e: IOException) {
+            Log.e("RNPurchases", "Error queueing operation: " + e.localizedMessage)
+            false
+        }
+    }
+
+    /**
+     * Replays the queued operations if online, including the ones queued while replaying. Operations made for another
+     * user than [appUserID] are dropped, the SDK can only write to the current user. Does nothing if another thread is
+     * already flushing.
+     * @param offline replays even without connectivity, before the app user changes. The SDK keeps the attributes it
+     * couldn't sync for the user they were set for.
+     */
+    @JvmOverloads
+    fun flush(appUserID: String?, replayer: Replayer, offline: Boolean = false) {
+        while (true) {
+            val batch = synchronized(this) {
+                if (flushing || depth() == 0 || !(offline || isOnline())) {
+                    return
+                }
+                flushing = true
+                drain(appUserID)
+            }
+            try {
+                replayer.replay(batch)
+            } finally {
+                synchronized(this) {
+                    flushing = false
+                }
+            }
+        }
+    }
+
+    /**
+     * Calls [onConnected] on the main thread every time connectivity returns, and once right away if online.
+     */
+    @Synchronized
+    fun startMonitoring(onConnected: Runnable) {
+        if (receiver != null) {
+            return
+        }
+        val connectivityReceiver = object : BroadcastReceiver() {
+            override fun onReceive(context: Context?, intent: Intent?) {
+                if (isOnline()) {
+                    onConnected.run()
+                }
+            }
+        }
+        receiver = connectivityReceiver
+        @Suppress("DEPRECATION")
+        context.registerReceiver(connectivityReceiver, IntentFilter(ConnectivityManager.CONNECTIVITY_ACTION))
+    }
+
+    @Synchronized
+    fun stopMonitoring() {
+        receiver?.let { context.unregisterReceiver(it) }
+        receiver = null
+    }
+
+    private fun isOnline(): Boolean {
+        val connectivityManager =
+            context.getSystemService(Context.CONNECTIVITY_SERVICE) as? ConnectivityManager ?: return true
+        return try {
+            @Suppress("DEPRECATION")
+            connectivityManager.activeNetworkInfo?.isConnected == true
+        } catch (e: SecurityException) {
+            // without ACCESS_NETWORK_STATE nothing gets queued
+            true
+        }
+    }
+
+    private fun drain(appUserID: String?): Batch {
+        val allOperations = readLines().mapNotNull { line ->
+            try {
+                JSONObject(line)
+            } catch (e: JSONException) {
+                // a line cut short by the app being killed while writing
+                null
+            }
+        }
+        file.delete()
+        depth = 0
+        val operations = allOperations.filter { operation ->
+            operation.isNull(OPERATION_APP_USER_ID) || operation.getString(OPERATION_APP_USER_ID) == appUserID
+        }
+        if (operations.size < allOperations.size) {
+            Log.w("RNPurchases", "Dropped " + (allOperations.size - operations.size) +
+                    " queued operations made before the app user changed")
+        }
+
+        val attributes = LinkedHashMap<String, Any?>()
+        val customAttributes = LinkedHashMap<String, Any?>()
+        val attributionsByNetwork = LinkedHashMap<Int, JSONObject>()
+        var syncPurchases = false
+        for (operation in operations) {
+            when (operation.optString(OPERATION_TYPE)) {
+                TYPE_ATTRIBUTES -> {
+                    val batch = RNPurchasesConverters.convertJsonToMap(operation.getJSONObject(OPERATION_PAYLOAD))
+                    for ((key, value) in batch) {
+                        when (key) {
+                            "attributes" -> (value as? Map<*, *>)?.forEach { (attributeKey, attributeValue) ->
+                                customAttributes[attributeKey as String] = attributeValue
+                            }
+                            "collectDeviceIdentifiers" ->
+                                attributes[key] = value == true || attributes[key] == true
+                            else -> attributes[key] = value
+                        }
+                    }
+                }
+                TYPE_ATTRIBUTION -> {
+                    val attribution = operation.getJSONObject(OPERATION_PAYLOAD)
+                    val network = attribution.getInt("network")
+                    attributionsByNetwork.remove(network)
+                    attributionsByNetwork[network] = attribution
+                }
+                TYPE_SYNC_PURCHASES -> syncPurchases = true
+            }
+        }
+        if (customAttributes.isNotEmpty()) {
+            attributes["attributes"] = customAttributes
+        }
+        return Batch(attributes, attributionsByNetwork.values.toList(), syncPurchases, operations.size)
+    }
+
+    private fun readLines(): List<String> {
+        return try {
+            file.readLines().filter { it.isNotBlank() }
+        } catch (e: IOException) {
+            emptyList()
+        }
+    }
+
+    companion object {
+        private const val OPERATION_TYPE = "type"
+        private const val OPERATION_PAYLOAD = "payload"
+        private const val OPERATION_APP_USER_ID = "appUserID"
+        private const val TYPE_ATTRIBUTES = "attributes"
+        private const val TYPE_ATTRIBUTION = "attribution"
+        private const val TYPE_SYNC_PURCHASES = "syncPurchases"
+
+        @JvmStatic
+        fun attributesOperation(batch: Map<String, *>): JSONObject =
+            JSONObject().put(OPERATION_TYPE, TYPE_ATTRIBUTES).put(OPERATION_PAYLOAD, JSONObject(batch))
+
+        @JvmStatic
+        fun attributionOperation(data: JSONObject, network: Int, networkUserId: String?): JSONObject =
+            JSONObject().put(OPERATION_TYPE, TYPE_ATTRIBUTION).put(OPERATION_PAYLOAD, JSONObject()
+                .put("data", data)
+                .put("network", network)
+                .put("networkUserId", networkUserId ?: JSONObject.NULL))
+
+        @JvmStatic
+        fun syncPurchasesOperation(): JSONObject = JSONObject().put(OPERATION_TYPE, TYPE_SYNC_PURCHASES)
+    }
+}
@@ -1,24 +1,50 @@
-
 package com.revenuecat.purchases.react;
 
 import androidx.annotation.NonNull;
+import androidx.annotation.Nullable;
 
-import java.util.Arrays;
 import java.util.Collections;
+import java.util.HashMap;
 import java.util.List;
+import java.util.Map;
 
-import com.facebook.react.ReactPackage;
+import com.facebook.react.TurboReactPackage;
 import com.facebook.react.bridge.NativeModule;
 import com.facebook.react.bridge.ReactApplicationContext;
+import com.facebook.react.module.model.ReactModuleInfo;
+import com.facebook.react.module.model.ReactModuleInfoProvider;
 import com.facebook.react.uimanager.ViewManager;
 import com.facebook.react.bridge.JavaScriptModule;
 
 
-public class RNPurchasesPackage implements ReactPackage {
-  @NonNull
+// The module is only created when JS first uses it, instead of when the React instance starts
+public class RNPurchasesPackage extends TurboReactPackage {
+  @Nullable
+  @Override
+  public NativeModule getModule(String name, @NonNull ReactApplicationContext reactContext) {
+    if (RNPurchasesModule.NAME.equals(name)) {
+      return new RNPurchasesModule(reactContext);
+    }
+    return null;
+  }
+
   @Override
-  public List<NativeModule> createNativeModules(@NonNull ReactApplicationContext reactContext) {
-    return Arrays.<NativeModule>asList(new RNPurchasesModule(reactContext));
+  public ReactModuleInfoProvider getReactModuleInfoProvider() {
+    return new ReactModuleInfoProvider() {
+      @Override
+      public Map<String, ReactModuleInfo> getReactModuleInfos() {
+        Map<String, ReactModuleInfo> moduleInfos = new HashMap<>();
+        moduleInfos.put(RNPurchasesModule.NAME, new ReactModuleInfo(
+                RNPurchasesModule.NAME,
+                RNPurchasesModule.class.getName(),
+                false, // canOverrideExistingModule
+                false, // needsEagerInit
+                false, // hasConstants
+                false, // isCxxModule
+                false)); // isTurboModule
+        return moduleInfos;
+      }
+    };
   }
 
   // Deprecated from RN 0.47
@@ -31,4 +57,4 @@ public class RNPurchasesPackage implements ReactPackage {
   public List<ViewManager> createViewManagers(@NonNull ReactApplicationContext reactContext) {
     return Collections.emptyList();
   }
-}
\ No newline at end of file
+}
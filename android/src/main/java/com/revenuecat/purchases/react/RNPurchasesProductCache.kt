@@ -0,0 +1,100 @@
+package com.revenuecat.purchases.react
+
+import android.os.SystemClock
+
+/**
+ * Products fetched by getProductInfo and getProductInfoBatch by type and identifier, so looking up the same
+ * products again doesn't go back to Play Billing until they expire.
+ */
+internal class RNPurchasesProductCache {
+
+    private class Entry(val product: Map<String, *>, val cachedAtMillis: Long)
+
+    /**
+     * The products of a lookup that were cached, and the identifiers that have to be fetched.
+     */
+    class Lookup(val cachedProducts: List<Map<String, *>>, val uncachedProductIDs: List<String>) {
+
+        /**
+         * @return the cached and the fetched products in the order of the identifiers, or the fetched products as
+         * they are if nothing was cached.
+         */
+        fun merge(productIDs: List<String>, fetchedProducts: List<Map<String, *>>): List<Map<String, *>> {
+            if (cachedProducts.isEmpty()) {
+                return fetchedProducts
+            }
+            val productsByID = (cachedProducts + fetchedProducts).associateBy { it["identifier"] }
+            return productIDs.distinct().mapNotNull { productsByID[it] }
+        }
+    }
+
+    private val entries = HashMap<String, Entry>()
+
+    /**
+     * How long products are served from the cache, 0 or less disables it.
+     */
+    @Volatile
+    var ttlMillis = DEFAULT_TTL_MILLIS
+
+    @get:Synchronized
+    var hits = 0L
+        private set
+
+    @get:Synchronized
+    var misses = 0L
+        private set
+
+    /**
+     * Counts a hit for every identifier that has a valid entry and a miss for every other one.
+     */
+    @Synchronized
+    fun lookup(productIDs: List<String>, type: String): Lookup {
+        val now = SystemClock.elapsedRealtime()
+        val cachedProducts = ArrayList<Map<String, *>>()
+        val uncachedProductIDs = ArrayList<String>()
+        for (productID in productIDs) {
+            val product = get(productID, type, now)
+            if (product != null) {
+                cachedProducts.add(product)
+            } else {
+                uncachedProductIDs.add(productID)
+            }
+        }
+        hits += cachedProducts.size
+        misses += uncachedProductIDs.size
+        return Lookup(cachedProducts, uncachedProductIDs)
+    }
+
+    @Synchronized
+    fun put(products: List<Map<String, *>>, type: String) {
+        if (ttlMillis <= 0) {
+            return
+        }
+        val now = SystemClock.elapsedRealtime()
+        for (product in products) {
+            val productID = product["identifier"] as? String ?: continue
+            entries[key(productID, type)] = Entry(product, now)
+        }
+    }
+
+    @Synchronized
+    fun invalidate() {
+        entries.clear()
+    }
+
+    private fun get(productID: String, type: String, now: Long): Map<String, *>? {
+        val key = key(productID, type)
+        val entry = entries[key] ?: return null
+        if (now - entry.cachedAtMillis >= ttlMillis) {
+            entries.remove(key)
+            return null
+        }
+        return entry.product
+    }
+
+    private fun key(productID: String, type: String) = "$type:$productID"
+
+    companion object {
+        const val DEFAULT_TTL_MILLIS = 5 * 60 * 1000L
+    }
+}
@@ -0,0 +1,38 @@
+package com.revenuecat.purchases.react
+
+import android.os.Build
+import android.os.Trace
+
+/**
+ * Trace sections around the native calls, so they show up in Perfetto and systrace captures.
+ * Disabled by default, when disabled each section only costs a field read. Enable it from the app, for
+ * example in debug builds, with `RNPurchasesTrace.setEnabled(true)`.
+ */
+object RNPurchasesTrace {
+
+    @Volatile
+    @JvmStatic
+    var enabled = false
+
+    /**
+     * @return whether a section was begun, to pass to [endSection].
+     */
+    @JvmStatic
+    fun beginSection(name: String): Boolean {
+        if (!enabled || Build.VERSION.SDK_INT < Build.VERSION_CODES.JELLY_BEAN_MR2) {
+            return false
+        }
+        Trace.beginSection("RNPurchases.$name")
+        return true
+    }
+
+    /**
+     * Must be called on the thread that began the section.
+     */
+    @JvmStatic
+    fun endSection(begun: Boolean) {
+        if (begun && Build.VERSION.SDK_INT >= Build.VERSION_CODES.JELLY_BEAN_MR2) {
+            Trace.endSection()
+        }
+    }
+}
@@ -0,0 +1,91 @@
+package com.revenuecat.purchases.react
+
+/**
+ * The last purchaser info and offerings of recently identified app users, so switching back to one of them with
+ * identify is served right away while the SDK revalidates in the background. Least recently used users are dropped
+ * once the snapshots, estimated as JSON, go over [maxBytes].
+ */
+internal class RNPurchasesUserSnapshots {
+
+    class Snapshot(
+        val purchaserInfo: Map<String, *>?,
+        val offerings: Map<String, *>?,
+        val purchaserInfoBytes: Int,
+        val offeringsBytes: Int
+    ) {
+        val bytes get() = purchaserInfoBytes + offeringsBytes
+    }
+
+    // access ordered, the eldest entry is the least recently used
+    private val snapshots = LinkedHashMap<String, Snapshot>(16, 0.75f, true)
+    private var totalBytes = 0
+
+    /**
+     * 0 or less disables the snapshots.
+     */
+    var maxBytes = DEFAULT_MAX_BYTES
+        @Synchronized set(value) {
+            field = value
+            trim()
+        }
+
+    @Synchronized
+    fun get(appUserID: String): Snapshot? = snapshots[appUserID]
+
+    fun putPurchaserInfo(appUserID: String, purchaserInfo: Map<String, *>) {
+        val bytes = byteCount(purchaserInfo)
+        synchronized(this) {
+            val snapshot = snapshots[appUserID]
+            put(appUserID, Snapshot(purchaserInfo, snapshot?.offerings, bytes, snapshot?.offeringsBytes ?: 0))
+        }
+    }
+
+    fun putOfferings(appUserID: String, offerings: Map<String, *>) {
+        val bytes = byteCount(offerings)
+        synchronized(this) {
+            val snapshot = snapshots[appUserID]
+            put(appUserID, Snapshot(snapshot?.purchaserInfo, offerings, snapshot?.purchaserInfoBytes ?: 0, bytes))
+        }
+    }
+
+    private fun put(appUserID: String, snapshot: Snapshot) {
+        snapshots.put(appUserID, snapshot)?.let { totalBytes -= it.bytes }
+        totalBytes += snapshot.bytes
+        trim()
+    }
+
+    private fun trim() {
+        val iterator = snapshots.values.iterator()
+        while (totalBytes > maxBytes && iterator.hasNext()) {
+            totalBytes -= iterator.next().bytes
+            iterator.remove()
+        }
+    }
+
+    // Roughly the length of the value as JSON, without serializing it: escapes and number formatting are ignored
+    private fun byteCount(value: Any?): Int {
+        return when (value) {
+            is Map<*, *> -> {
+                var length = 1
+                for ((key, entryValue) in value) {
+                    length += key.toString().length + 4 + byteCount(entryValue)
+                }
+                length
+            }
+            is Iterable<*> -> {
+                var length = 1
+                for (element in value) {
+                    length += byteCount(element) + 1
+                }
+                length
+            }
+            is String -> value.length + 2
+            null -> 4
+            else -> value.toString().length
+        }
+    }
+
+    companion object {
+        const val DEFAULT_MAX_BYTES = 1024 * 1024
+    }
+}
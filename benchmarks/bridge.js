@@ -0,0 +1,165 @@
+/** @format */
+
+// Drives synthetic offerings and purchaser infos through the JS side of the bridge and reports p50/p99 times, so
+// changes to decoding and conversion can be compared in review. Run it with `yarn benchmark [iterations]`.
+//
+// Bridge time is parsing the serialized payload, which is the part of a native call the old bridge spends in JS.
+// Conversion time is everything react-native-purchases does afterwards until the promise resolves. Native time
+// isn't included, Purchases.setPerformanceMetricsEnabled measures it on a device: its conversionMillis is the native
+// date millis, summary and compact encoding of each response, on iOS and Android.
+//
+// runBridgeBenchmarks only uses the native module it's given, so it also runs under Hermes or JSC, for example from
+// the example app with a copy of NativeModules.RNPurchases.
+
+const { createOfferings, createPurchaserInfo, encodeCompact } = require("./payloads");
+
+const SIZES = [10, 100, 1000];
+
+const percentile = (sortedSamples, fraction) =>
+  sortedSamples[Math.min(sortedSamples.length - 1, Math.floor(fraction * sortedSamples.length))];
+
+const summarize = samples => {
+  const sorted = samples.slice().sort((a, b) => a - b);
+  return { p50: percentile(sorted, 0.5), p99: percentile(sorted, 0.99) };
+};
+
+const scenarios = [
+  {
+    name: "getOfferings",
+    method: "getOfferings",
+    createPayload: createOfferings,
+    call: Purchases => Purchases.getOfferings(),
+  },
+  {
+    name: "getOfferings (compact)",
+    method: "getOfferings",
+    createPayload: size => encodeCompact(createOfferings(size)),
+    call: Purchases => Purchases.getOfferings(),
+  },
+  {
+    name: "getPurchaserInfo",
+    method: "getPurchaserInfo",
+    createPayload: createPurchaserInfo,
+    call: Purchases => Purchases.getPurchaserInfo(),
+  },
+  {
+    name: "getPurchaserInfo (compact)",
+    method: "getPurchaserInfo",
+    createPayload: size => encodeCompact(createPurchaserInfo(size)),
+    call: Purchases => Purchases.getPurchaserInfo(),
+  },
+];
+
+/**
+ * @param {object} options Purchases and getActiveEntitlements from react-native-purchases, nativeModule the
+ * NativeModules.RNPurchases the module was loaded with, whose methods get replaced, now a millisecond clock,
+ * iterations how many calls to time per scenario and size.
+ * @returns {Promise<object[]>} One row per scenario and size with the payload bytes and the p50/p99 bridge and
+ * conversion millis.
+ */
+const runBridgeBenchmarks = ({ Purchases, getActiveEntitlements, nativeModule, now, iterations = 200 }) => {
+  // the first calls run before the JIT warms up and aren't recorded
+  const warmupIterations = Math.ceil(iterations / 10);
+  const rows = [];
+  let chain = Promise.resolve();
+  scenarios.forEach(scenario => {
+    SIZES.forEach(size => {
+      chain = chain.then(() => {
+        const serialized = JSON.stringify(scenario.createPayload(size));
+        let bridgeMillis = 0;
+        nativeModule[scenario.method] = () =>
+          Promise.resolve().then(() => {
+            const start = now();
+            const payload = JSON.parse(serialized);
+            bridgeMillis = now() - start;
+            return payload;
+          });
+        const bridgeSamples = [];
+        const conversionSamples = [];
+        const run = iteration => {
+          if (iteration === warmupIterations + iterations) {
+            return undefined;
+          }
+          const start = now();
+          return scenario.call(Purchases).then(() => {
+            if (iteration >= warmupIterations) {
+              bridgeSamples.push(bridgeMillis);
+              conversionSamples.push(now() - start - bridgeMillis);
+            }
+            return run(iteration + 1);
+          });
+        };
+        return Promise.resolve(run(0)).then(() => {
+          rows.push({
+            name: scenario.name,
+            size,
+            payloadBytes: serialized.length,
+            bridge: summarize(bridgeSamples),
+            conversion: summarize(conversionSamples),
+          });
+        });
+      });
+    });
+  });
+  return chain.then(() => {
+    SIZES.forEach(size => {
+      const purchaserInfo = createPurchaserInfo(size);
+      const samples = [];
+      for (let iteration = 0; iteration < warmupIterations + iterations; iteration++) {
+        const start = now();
+        getActiveEntitlements(purchaserInfo);
+        if (iteration >= warmupIterations) {
+          samples.push(now() - start);
+        }
+      }
+      rows.push({
+        name: "getActiveEntitlements",
+        size,
+        payloadBytes: 0,
+        bridge: { p50: 0, p99: 0 },
+        conversion: summarize(samples),
+      });
+    });
+    return rows;
+  });
+};
+
+const formatRows = rows =>
+  ["scenario                        size   payload KB   bridge p50/p99 ms   conversion p50/p99 ms"]
+    .concat(
+      rows.map(
+        row =>
+          `${row.name.padEnd(30)} ${String(row.size).padStart(5)} ${(row.payloadBytes / 1024).toFixed(1).padStart(12)}` +
+          ` ${`${row.bridge.p50.toFixed(3)}/${row.bridge.p99.toFixed(3)}`.padStart(19)}` +
+          ` ${`${row.conversion.p50.toFixed(3)}/${row.conversion.p99.toFixed(3)}`.padStart(23)}`
+      )
+    )
+    .join("\n");
+
+module.exports = { runBridgeBenchmarks, formatRows };
+
+if (require.main === module) {
+  // Node can't load react-native, the library only needs these parts of it
+  const Module = require("module");
+  const nativeModule = {};
+  const reactNative = {
+    NativeModules: { RNPurchases: nativeModule },
+    NativeEventEmitter: function NativeEventEmitter() {
+      this.addListener = () => ({ remove: () => undefined });
+    },
+    Platform: { OS: "ios", select: specifics => specifics.ios },
+  };
+  const load = Module._load;
+  Module._load = function (request) {
+    return request === "react-native" ? reactNative : load.apply(this, arguments);
+  };
+  const { performance } = require("perf_hooks");
+  const purchases = require("../index");
+  runBridgeBenchmarks({
+    Purchases: purchases.default,
+    getActiveEntitlements: purchases.getActiveEntitlements,
+    nativeModule,
+    now: () => performance.now(),
+    iterations: Number(process.argv[2]) || undefined,
+  }).then(rows => console.log(formatRows(rows)));
+}
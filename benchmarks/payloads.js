@@ -0,0 +1,164 @@
+/** @format */
+
+// Synthetic payloads in the shape PurchasesHybridCommon sends over the bridge, sized by number of products or
+// transactions. Everything is derived from the index, so runs are comparable across machines and builds.
+
+const DAY_MILLIS = 24 * 60 * 60 * 1000;
+const BASE_MILLIS = Date.parse("2020-01-01T00:00:00Z");
+const PACKAGE_TYPES = ["WEEKLY", "MONTHLY", "TWO_MONTH", "THREE_MONTH", "SIX_MONTH", "ANNUAL", "LIFETIME"];
+
+const isoDate = millis => new Date(millis).toISOString();
+
+const createProduct = index => ({
+  identifier: `product_${index}`,
+  description: `Synthetic product ${index}`,
+  title: `Product ${index} (Benchmark)`,
+  price: 0.99 + index,
+  price_string: `$${(0.99 + index).toFixed(2)}`,
+  currency_code: "USD",
+  intro_price: index % 2 === 0 ? 0 : null,
+  intro_price_string: index % 2 === 0 ? "$0.00" : null,
+  intro_price_period: index % 2 === 0 ? "P1W" : null,
+  intro_price_cycles: index % 2 === 0 ? 1 : null,
+  intro_price_period_unit: index % 2 === 0 ? "DAY" : null,
+  intro_price_period_number_of_units: index % 2 === 0 ? 7 : null,
+  discounts: [],
+});
+
+const createPackage = (index, offeringIdentifier) => ({
+  identifier: `$rc_package_${index}`,
+  packageType: PACKAGE_TYPES[index % PACKAGE_TYPES.length],
+  product: createProduct(index),
+  offeringIdentifier,
+});
+
+/**
+ * Offerings with productCount products, spread over offerings of 10 packages each.
+ */
+const createOfferings = productCount => {
+  const all = {};
+  for (let index = 0; index < productCount; index++) {
+    const offeringIdentifier = `offering_${Math.floor(index / 10)}`;
+    if (!all[offeringIdentifier]) {
+      all[offeringIdentifier] = {
+        identifier: offeringIdentifier,
+        serverDescription: `Synthetic offering ${offeringIdentifier}`,
+        availablePackages: [],
+        lifetime: null,
+        annual: null,
+        sixMonth: null,
+        threeMonth: null,
+        twoMonth: null,
+        monthly: null,
+        weekly: null,
+      };
+    }
+    all[offeringIdentifier].availablePackages.push(createPackage(index, offeringIdentifier));
+  }
+  return { all, current: all.offering_0 || null };
+};
+
+const createEntitlement = (index, nowMillis) => {
+  // every other entitlement has expired, every tenth one never expires
+  const expirationMillis = index % 10 === 0 ? null : nowMillis + (index % 2 === 0 ? 1 : -1) * (index + 1) * DAY_MILLIS;
+  const purchaseMillis = BASE_MILLIS + index * DAY_MILLIS;
+  return {
+    identifier: `entitlement_${index}`,
+    isActive: expirationMillis === null || expirationMillis > nowMillis,
+    willRenew: index % 3 !== 0,
+    periodType: "NORMAL",
+    latestPurchaseDate: isoDate(purchaseMillis),
+    latestPurchaseDateMillis: purchaseMillis,
+    originalPurchaseDate: isoDate(purchaseMillis),
+    originalPurchaseDateMillis: purchaseMillis,
+    expirationDate: expirationMillis === null ? null : isoDate(expirationMillis),
+    expirationDateMillis: expirationMillis,
+    store: index % 2 === 0 ? "APP_STORE" : "PLAY_STORE",
+    productIdentifier: `product_${index}`,
+    isSandbox: true,
+    unsubscribeDetectedAt: null,
+    unsubscribeDetectedAtMillis: null,
+    billingIssueDetectedAt: null,
+    billingIssueDetectedAtMillis: null,
+  };
+};
+
+/**
+ * A purchaser info with transactionCount purchased products and as many entitlements, with date millis like the
+ * native side adds them.
+ */
+const createPurchaserInfo = (transactionCount, nowMillis = Date.now()) => {
+  const all = {};
+  const active = {};
+  const allExpirationDates = {};
+  const allPurchaseDates = {};
+  const allPurchasedProductIdentifiers = [];
+  const activeSubscriptions = [];
+  const nonSubscriptionTransactions = [];
+  for (let index = 0; index < transactionCount; index++) {
+    const entitlement = createEntitlement(index, nowMillis);
+    all[entitlement.identifier] = entitlement;
+    if (entitlement.isActive) {
+      active[entitlement.identifier] = entitlement;
+      activeSubscriptions.push(entitlement.productIdentifier);
+    }
+    allExpirationDates[entitlement.productIdentifier] = entitlement.expirationDate;
+    allPurchaseDates[entitlement.productIdentifier] = entitlement.latestPurchaseDate;
+    allPurchasedProductIdentifiers.push(entitlement.productIdentifier);
+    if (entitlement.expirationDate === null) {
+      nonSubscriptionTransactions.push({
+        revenueCatId: `transaction_${index}`,
+        productId: entitlement.productIdentifier,
+        purchaseDate: entitlement.latestPurchaseDate,
+        purchaseDateMillis: entitlement.latestPurchaseDateMillis,
+      });
+    }
+  }
+  return {
+    entitlements: { all, active },
+    activeSubscriptions,
+    allPurchasedProductIdentifiers,
+    nonSubscriptionTransactions,
+    latestExpirationDate: null,
+    latestExpirationDateMillis: null,
+    firstSeen: isoDate(BASE_MILLIS),
+    firstSeenMillis: BASE_MILLIS,
+    originalAppUserId: "$RCAnonymousID:benchmark",
+    requestDate: isoDate(nowMillis),
+    requestDateMillis: nowMillis,
+    allExpirationDates,
+    allPurchaseDates,
+    originalApplicationVersion: null,
+    originalPurchaseDate: null,
+    managementURL: null,
+  };
+};
+
+/**
+ * Encodes a payload the way the native side does for PAYLOAD_ENCODING.COMPACT.
+ */
+const encodeCompact = payload => {
+  const keyIndexes = {};
+  const keys = [];
+  const encode = value => {
+    if (Array.isArray(value)) {
+      return [1].concat(value.map(encode));
+    }
+    if (value !== null && typeof value === "object") {
+      const encoded = [0];
+      Object.keys(value).forEach(key => {
+        if (keyIndexes[key] === undefined) {
+          keyIndexes[key] = keys.length;
+          keys.push(key);
+        }
+        encoded.push(keyIndexes[key], encode(value[key]));
+      });
+      return encoded;
+    }
+    return value;
+  };
+  const compactValue = encode(payload);
+  return { compactKeys: keys, compactValue };
+};
+
+module.exports = { createOfferings, createPurchaserInfo, encodeCompact };
@@ -0,0 +1,25 @@
+/** @format */
+
+// Imported first by index.js, so loading react-native-purchases is timed from a cold start. Compare the logged times
+// across builds in release mode, debug builds load the bundle from Metro.
+// react-native itself is loaded beforehand so it isn't part of the measurement.
+import "react-native";
+
+const now = () => (global.nativePerformanceNow ? global.nativePerformanceNow() : Date.now());
+
+const loadStart = now();
+const Purchases = require("react-native-purchases").default;
+
+const loadMillis = now() - loadStart;
+
+// The first native call includes creating the native module, which happens lazily
+export default function reportStartupBenchmark() {
+  const callStart = now();
+  return Purchases.getQueuedOperationCount().then(() => {
+    const firstCallMillis = now() - callStart;
+    console.log(
+      `[StartupBenchmark] loading react-native-purchases: ${loadMillis.toFixed(1)}ms, ` +
+        `first native call: ${firstCallMillis.toFixed(1)}ms`
+    );
+  });
+}
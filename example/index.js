@@ -1,7 +1,9 @@
 /** @format */
 
+import reportStartupBenchmark from "./app/startupBenchmark";
 import { AppRegistry } from "react-native";
 import App from "./App";
 import { name as appName } from "./app.json";
 
 AppRegistry.registerComponent(appName, () => App);
+reportStartupBenchmark();
@@ -92,6 +92,54 @@ export declare enum INTRO_ELIGIBILITY_STATUS {
      */
     INTRO_ELIGIBILITY_STATUS_ELIGIBLE = 2
 }
+export declare enum OFFERINGS_CACHE_POLICY {
+    /**
+     * Always fetch the offerings and wait for the response.
+     */
+    FETCH = "fetch",
+    /**
+     * Resolve right away with the offerings stored from the last fetch, if there are any, and refresh them in the
+     * background. Refreshed offerings are sent to the listeners added with addOfferingsUpdateListener.
+     */
+    STALE_WHILE_REVALIDATE = "staleWhileRevalidate"
+}
+export declare enum PAYLOAD_ENCODING {
+    /**
+     * Offerings and purchaser info are sent over the bridge as maps.
+     */
+    MAP = "map",
+    /**
+     * Offerings and purchaser info are sent with every key interned, and decoded back into the same objects in JS.
+     * Much smaller bridge messages for large offerings and long transaction histories.
+     */
+    COMPACT = "compact"
+}
+export declare enum PURCHASER_INFO_MODE {
+    /**
+     * Purchaser infos are sent with every field.
+     */
+    FULL = "full",
+    /**
+     * allExpirationDates, allPurchaseDates and nonSubscriptionTransactions, which grow with every purchase, are sent
+     * empty. isSummary is true and nonSubscriptionTransactionCount has the number of transactions, page through them
+     * with getTransactions.
+     */
+    SUMMARY = "summary"
+}
+export declare enum RESTORE_PROGRESS_STAGE {
+    /**
+     * The restore started, the store history is being synced.
+     */
+    STARTED = "started",
+    /**
+     * The SDK restored the purchases, purchasedProductCount is known and the purchaser info is being converted.
+     */
+    RESTORED = "restored",
+    /**
+     * The purchaser info was converted, the promise resolves right after.
+     */
+    PROCESSED = "processed"
+}
 /**
  * The EntitlementInfo object gives you access to all of the information about the status of a user entitlement.
  */
@@ -117,15 +165,30 @@ export interface PurchasesEntitlementInfo {
      * The latest purchase or renewal date for the entitlement.
      */
     readonly latestPurchaseDate: string;
+    /**
+     * latestPurchaseDate in milliseconds since the epoch, to compare without parsing the date string.
+     * Missing only if the native date couldn't be parsed.
+     */
+    readonly latestPurchaseDateMillis?: number;
     /**
      * The first date this entitlement was purchased.
      */
     readonly originalPurchaseDate: string;
+    /**
+     * originalPurchaseDate in milliseconds since the epoch, to compare without parsing the date string.
+     * Missing only if the native date couldn't be parsed.
+     */
+    readonly originalPurchaseDateMillis?: number;
     /**
      * The expiration date for the entitlement, can be `null` for lifetime access. If the `periodType` is `trial`,
      * this is the trial expiration date.
      */
     readonly expirationDate: string | null;
+    /**
+     * expirationDate in milliseconds since the epoch, to compare without parsing the date string.
+     * Missing only if the native date couldn't be parsed.
+     */
+    readonly expirationDateMillis?: number | null;
     /**
      * The store where this entitlement was unlocked from. Either: appStore, macAppStore, playStore, stripe,
      * promotional, unknownStore
@@ -145,12 +208,22 @@ export interface PurchasesEntitlementInfo {
      * @note: Entitlement may still be active even if user has unsubscribed. Check the `isActive` property.
      */
     readonly unsubscribeDetectedAt: string | null;
+    /**
+     * unsubscribeDetectedAt in milliseconds since the epoch, to compare without parsing the date string.
+     * Missing only if the native date couldn't be parsed.
+     */
+    readonly unsubscribeDetectedAtMillis?: number | null;
     /**
      * The date a billing issue was detected. Can be `null` if there is no billing issue or an issue has been resolved
      *
      * @note: Entitlement may still be active even if there is a billing issue. Check the `isActive` property.
      */
     readonly billingIssueDetectedAt: string | null;
+    /**
+     * billingIssueDetectedAt in milliseconds since the epoch, to compare without parsing the date string.
+     * Missing only if the native date couldn't be parsed.
+     */
+    readonly billingIssueDetectedAtMillis?: number | null;
 }
 /**
  * Contains all the entitlements associated to the user.
@@ -186,10 +259,20 @@ export interface PurchaserInfo {
      * The latest expiration date of all purchased skus
      */
     readonly latestExpirationDate: string | null;
+    /**
+     * latestExpirationDate in milliseconds since the epoch, to compare without parsing the date string.
+     * Missing only if the native date couldn't be parsed.
+     */
+    readonly latestExpirationDateMillis?: number | null;
     /**
      * The date this user was first seen in RevenueCat.
      */
     readonly firstSeen: string;
+    /**
+     * firstSeen in milliseconds since the epoch, to compare without parsing the date string.
+     * Missing only if the native date couldn't be parsed.
+     */
+    readonly firstSeenMillis?: number;
     /**
      * The original App User Id recorded for this user.
      */
@@ -198,6 +281,11 @@ export interface PurchaserInfo {
      * Date when this info was requested
      */
     readonly requestDate: string;
+    /**
+     * requestDate in milliseconds since the epoch, to compare without parsing the date string.
+     * Missing only if the native date couldn't be parsed.
+     */
+    readonly requestDateMillis?: number;
     /**
      * Map of skus to expiration dates
      */
@@ -225,6 +313,11 @@ export interface PurchaserInfo {
      * Use this for grandfathering users when migrating to subscriptions.
      */
     readonly originalPurchaseDate: string | null;
+    /**
+     * originalPurchaseDate in milliseconds since the epoch, to compare without parsing the date string.
+     * Missing only if the native date couldn't be parsed.
+     */
+    readonly originalPurchaseDateMillis?: number | null;
     /**
      * URL to manage the active subscription of the user. If this user has an active iOS
      * subscription, this will point to the App Store, if the user has an active Play Store subscription
@@ -237,6 +330,14 @@ export interface PurchaserInfo {
      * non-subscription purchases
      */
     readonly nonSubscriptionTransactions: [PurchasesTransaction];
+    /**
+     * True when the purchaser info was sent in PURCHASER_INFO_MODE.SUMMARY, see setPurchaserInfoMode.
+     */
+    readonly isSummary?: boolean;
+    /**
+     * Number of non subscription transactions, only sent in PURCHASER_INFO_MODE.SUMMARY.
+     */
+    readonly nonSubscriptionTransactionCount?: number;
 }
 export interface PurchasesTransaction {
     /**
@@ -462,6 +563,185 @@ export interface PurchasesOfferings {
      */
     readonly current: PurchasesOffering | null;
 }
+/**
+ * Options for getOfferings
+ */
+export interface GetOfferingsOptions {
+    /**
+     * The [OFFERINGS_CACHE_POLICY] to use. FETCH by default.
+     */
+    readonly cachePolicy?: OFFERINGS_CACHE_POLICY;
+}
+/**
+ * Options for getProductsBatch
+ */
+export interface GetProductsBatchOptions {
+    /**
+     * Types of products to look the identifiers up as, in parallel. Subs and inapp by default. Ignored on iOS.
+     */
+    readonly types?: PURCHASE_TYPE[];
+}
+/**
+ * Options for getPurchaserInfo
+ */
+export interface GetPurchaserInfoOptions {
+    /**
+     * Leave allPurchasedProductIdentifiers, allExpirationDates, allPurchaseDates, nonSubscriptionTransactions and
+     * entitlements.all out of the bridge call, and fetch each of them synchronously the first time it's read.
+     * Not available when debugging remotely. Only the last 16 lazy purchaser infos keep their fields, reading a field
+     * that wasn't read yet on an older one throws. False by default.
+     */
+    readonly lazy?: boolean;
+}
+/**
+ * Options for getTransactions
+ */
+export interface GetTransactionsOptions {
+    /**
+     * nextCursor of the previous page. The first page by default.
+     */
+    readonly after?: string | null;
+    /**
+     * Maximum number of transactions in the page, 50 by default.
+     */
+    readonly limit?: number;
+}
+/**
+ * A page of the non subscription transactions of the purchaser info, in the order the SDK lists them.
+ */
+export interface PurchasesTransactionsPage {
+    readonly transactions: PurchasesTransaction[];
+    /**
+     * Pass as after to get the next page, null on the last page.
+     */
+    readonly nextCursor: string | null;
+    /**
+     * Number of non subscription transactions of the purchaser info.
+     */
+    readonly totalCount: number;
+}
+/**
+ * Options for addPurchaserInfoUpdateListener. Without any, the listener is called on every update.
+ */
+export interface PurchaserInfoUpdateListenerOptions {
+    /**
+     * Call the listener at most once per animation frame, with the latest purchaser info.
+     */
+    readonly coalesceToAnimationFrame?: boolean;
+    /**
+     * Call the listener with the latest purchaser info once no update has arrived for this many milliseconds.
+     * Takes precedence over coalesceToAnimationFrame.
+     */
+    readonly debounceMillis?: number;
+}
+/**
+ * Returned when adding a listener
+ */
+export interface ListenerSubscription {
+    /**
+     * Removes the listener, same as calling the matching remove method with it
+     */
+    remove(): void;
+}
+/**
+ * Lookups of product identifiers by getProducts and getProductsBatch that were served from the native product
+ * cache, and the ones that had to go to the store
+ */
+export interface ProductCacheStats {
+    readonly hits: number;
+    readonly misses: number;
+}
+/**
+ * Number of calls that were given the result of an identical request already in flight, by method
+ */
+export interface CoalescedRequestCounts {
+    readonly getPurchaserInfo: number;
+    readonly getOfferings: number;
+    readonly getProductInfo: number;
+}
+/**
+ * Distribution of a performance measurement
+ */
+export interface PerformanceHistogram {
+    readonly count: number;
+    readonly sum: number;
+    readonly min: number;
+    readonly max: number;
+    /**
+     * Inclusive upper bounds of the buckets. bucketCounts has one more entry, for the values above the last bound.
+     */
+    readonly bucketUpperBounds: number[];
+    readonly bucketCounts: number[];
+}
+/**
+ * Performance measurements of a native method
+ */
+export interface MethodPerformanceMetrics {
+    /**
+     * From the JS call to the promise settling, in milliseconds.
+     */
+    readonly totalMillis: PerformanceHistogram;
+    /**
+     * From the native module receiving the call to the SDK calling back, in milliseconds.
+     */
+    readonly nativeMillis: PerformanceHistogram;
+    /**
+     * Converting the result to send it over the bridge, in milliseconds. Always 0 on iOS, where the result is passed to
+     * the bridge as it is.
+     */
+    readonly conversionMillis: PerformanceHistogram;
+    /**
+     * From the SDK calling back to the native module resolving the promise, conversion included, in milliseconds.
+     */
+    readonly resolveMillis: PerformanceHistogram;
+    /**
+     * Size of the result serialized as JSON, in bytes.
+     */
+    readonly payloadBytes: PerformanceHistogram;
+    /**
+     * Operations replayed by each flush of the queue of operations made offline. Only measured for
+     * flushOperationQueue, where nativeMillis is how long the flush took.
+     */
+    readonly queueDepth?: PerformanceHistogram;
+    /**
+     * iOS only. Time the call kept the main thread busy, in milliseconds. Only measured for setupPurchases and the
+     * purchase methods, the only parts of a call that still run on the main queue.
+     */
+    readonly mainThreadMillis?: PerformanceHistogram;
+}
+/**
+ * Performance measurements by native method name
+ */
+export declare type PerformanceMetrics = {
+    [method: string]: MethodPerformanceMetrics;
+};
+/**
+ * Requests to start as soon as Purchases is set up
+ */
+export interface PrewarmOptions {
+    /**
+     * Fetch the offerings.
+     */
+    readonly offerings?: boolean;
+    /**
+     * Fetch the subscription products with these identifiers.
+     */
+    readonly productIdentifiers?: string[];
+    /**
+     * Check the intro eligibility of the products in the offerings and in productIdentifiers. Implies offerings.
+     */
+    readonly eligibility?: boolean;
+}
+/**
+ * Options for setup
+ */
+export interface SetupOptions {
+    /**
+     * Requests to start right after setup. Calls to getOfferings, getProducts and
+     * checkTrialOrIntroductoryPriceEligibility made while they are in flight wait for them instead of making new ones.
+     */
+    readonly prewarm?: PrewarmOptions;
+}
 export interface PurchasesError {
     code: number;
     message: string;
@@ -494,6 +774,20 @@ export interface IntroEligibility {
      */
     readonly description: string;
 }
+/**
+ * Progress of restoreTransactionsWithProgress
+ */
+export interface RestoreProgress {
+    readonly stage: RESTORE_PROGRESS_STAGE;
+    /**
+     * Number of purchased products processed so far, all of them once PROCESSED
+     */
+    readonly processedProductCount: number;
+    /**
+     * Number of products the purchaser info has purchases of, 0 until RESTORED
+     */
+    readonly purchasedProductCount: number;
+}
 export interface PurchasesPaymentDiscount {
     readonly identifier: string;
     readonly keyIdentifier: string;
@@ -501,18 +795,117 @@ export interface PurchasesPaymentDiscount {
     readonly signature: string;
     readonly timestamp: number;
 }
+/**
+ * A package whose product, and discount if any, were looked up ahead of time by preparePurchase, so
+ * purchasePreparedPurchase goes straight to the store.
+ */
+export interface PreparedPurchase {
+    /**
+     * Identifies the prepared purchase natively. It can be purchased once, and expires after 10 minutes.
+     */
+    readonly handle: number;
+    readonly productIdentifier: string;
+    /**
+     * iOS only. The signed discount, when preparePurchase was called with one.
+     */
+    readonly paymentDiscount: PurchasesPaymentDiscount | null;
+}
+/**
+ * Subscriber attributes to set with a single call to setAttributesBatch. Attributes that are not present are left
+ * untouched. Empty Strings or null will delete the subscriber attribute.
+ */
+export interface SubscriberAttributesBatch {
+    /**
+     * Map of custom attributes by key. Same as calling setAttributes.
+     */
+    readonly attributes?: {
+        [key: string]: string | null;
+    };
+    readonly email?: string | null;
+    readonly phoneNumber?: string | null;
+    readonly displayName?: string | null;
+    readonly pushToken?: string | null;
+    readonly adjustID?: string | null;
+    readonly appsflyerID?: string | null;
+    readonly fbAnonymousID?: string | null;
+    readonly mparticleID?: string | null;
+    readonly onesignalID?: string | null;
+    readonly mediaSource?: string | null;
+    readonly campaign?: string | null;
+    readonly adGroup?: string | null;
+    readonly ad?: string | null;
+    readonly keyword?: string | null;
+    readonly creative?: string | null;
+    /**
+     * Set to true to also collect the device identifiers. Same as calling collectDeviceIdentifiers.
+     */
+    readonly collectDeviceIdentifiers?: boolean;
+}
 /**
  * Listener used on updated purchaser info
  * @callback PurchaserInfoUpdateListener
  * @param {Object} purchaserInfo Object containing info for the purchaser
  */
 export declare type PurchaserInfoUpdateListener = (purchaserInfo: PurchaserInfo) => void;
-export declare type ShouldPurchasePromoProductListener = (deferredPurchase: () => MakePurchasePromise) => void;
+/**
+ * Listener used on promotional purchases initiated from the App Store
+ * @callback ShouldPurchasePromoProductListener
+ * @param {Function} deferredPurchase Makes the promotional purchase. Rejects if the purchase was already made,
+ * released, expired after an hour, or was dropped after 32 newer promotional purchases.
+ * @param {number} callbackID Identifies the deferred purchase, pass it to releaseDeferredPurchase if the purchase won't
+ * be made. Listeners that only take deferredPurchase can leave it out.
+ */
+export declare type ShouldPurchasePromoProductListener = (deferredPurchase: () => MakePurchasePromise, callbackID: number) => void;
+/**
+ * Listener used on updated offerings
+ * @callback OfferingsUpdateListener
+ * @param {Object} offerings Object containing the refreshed offerings
+ */
+export declare type OfferingsUpdateListener = (offerings: PurchasesOfferings) => void;
+/**
+ * Listener used when identify, resolved with a recently identified user's purchaser info, failed to switch the SDK to
+ * that user. The SDK stays on the previous user.
+ * @callback IdentifyFailedListener
+ * @param {String} appUserID The appUserID that couldn't be switched to
+ * @param {Object} error The error of the identify call
+ */
+export declare type IdentifyFailedListener = (appUserID: string, error: PurchasesError) => void;
+/**
+ * Listener used on updated performance metrics
+ * @callback PerformanceMetricsListener
+ * @param {Object} metrics Performance measurements by native method name
+ */
+export declare type PerformanceMetricsListener = (metrics: PerformanceMetrics) => void;
+/**
+ * Listener used on eligibilities streamed by checkTrialOrIntroductoryPriceEligibilityStreaming
+ * @callback IntroEligibilityListener
+ * @param {Object} eligibilities IntroEligibility of some of the requested products, by product identifier
+ */
+export declare type IntroEligibilityListener = (eligibilities: {
+    [productId: string]: IntroEligibility;
+}) => void;
+/**
+ * Listener used on the progress of restoreTransactionsWithProgress
+ * @callback RestoreProgressListener
+ * @param {Object} progress RestoreProgress with the stage the restore got to
+ */
+export declare type RestoreProgressListener = (progress: RestoreProgress) => void;
 declare type MakePurchasePromise = Promise<{
     productIdentifier: string;
     purchaserInfo: PurchaserInfo;
 }>;
 export declare const isUTCDateStringFuture: (dateString: string) => boolean;
+/**
+ * Evaluates which entitlements are active, comparing every expiration date against a single Date.now(). Unlike
+ * entitlements.active, the result follows the clock instead of reflecting when the purchaser info was fetched.
+ * @param {PurchaserInfo} purchaserInfo The purchaser info to evaluate
+ * @param {number} nowMillis Optional time to evaluate at, in milliseconds since the epoch. Now by default
+ * @returns {{ [key: string]: PurchasesEntitlementInfo }} The entitlements that don't expire or expire after
+ * nowMillis, keyed by entitlement identifier
+ */
+export declare const getActiveEntitlements: (purchaserInfo: PurchaserInfo, nowMillis?: number) => {
+    [key: string]: PurchasesEntitlementInfo;
+};
 export default class Purchases {
     /**
      * Enum for attribution networks
@@ -552,6 +945,30 @@ export default class Purchases {
      * @enum {number}
      */
     static INTRO_ELIGIBILITY_STATUS: typeof INTRO_ELIGIBILITY_STATUS;
+    /**
+     * Cache policies that can be used when getting offerings.
+     * @readonly
+     * @enum {string}
+     */
+    static OFFERINGS_CACHE_POLICY: typeof OFFERINGS_CACHE_POLICY;
+    /**
+     * Encodings that can be used to send offerings and purchaser info over the bridge.
+     * @readonly
+     * @enum {string}
+     */
+    static PAYLOAD_ENCODING: typeof PAYLOAD_ENCODING;
+    /**
+     * Modes that can be used to send purchaser infos over the bridge.
+     * @readonly
+     * @enum {string}
+     */
+    static PURCHASER_INFO_MODE: typeof PURCHASER_INFO_MODE;
+    /**
+     * Stages reported by restoreTransactionsWithProgress.
+     * @readonly
+     * @enum {string}
+     */
+    static RESTORE_PROGRESS_STAGE: typeof RESTORE_PROGRESS_STAGE;
     /**
      * Sets up Purchases with your API key and an app user id.
      * @param {String} apiKey RevenueCat API Key. Needs to be a String
@@ -560,9 +977,11 @@ export default class Purchases {
      * @param {String?} userDefaultsSuiteName An optional string. iOS-only, will be ignored for Android.
      * Set this if you would like the RevenueCat SDK to store its preferences in a different NSUserDefaults suite, otherwise it will use standardUserDefaults.
      * Default is null, which will make the SDK use standardUserDefaults.
+     * @param {SetupOptions?} options An optional object. Set prewarm to start fetching offerings, products and intro
+     * eligibility right after setup.
      * @returns {Promise<void>} Returns when setup completes
      */
-    static setup(apiKey: string, appUserID?: string | null, observerMode?: boolean, userDefaultsSuiteName?: string): any;
+    static setup(apiKey: string, appUserID?: string | null, observerMode?: boolean, userDefaultsSuiteName?: string, options?: SetupOptions): any;
     /**
      * @param {Boolean} allowSharing Set this to true if you are passing in an appUserID but it is anonymous, this is true by default if you didn't pass an appUserID
      * If an user tries to purchase a product that is active on the current app store account, we will treat it as a restore and alias
@@ -574,16 +993,44 @@ export default class Purchases {
      */
     static setFinishTransactions(finishTransactions: boolean): void;
     /**
-     * Sets a function to be called on updated purchaser info
+     * Sets a function to be called on updated purchaser info. Adding a listener that was already added replaces its
+     * options.
      * @param {PurchaserInfoUpdateListener} purchaserInfoUpdateListener PurchaserInfo update listener
+     * @param {PurchaserInfoUpdateListenerOptions} options Optional options, to only call the listener with the latest
+     * purchaser info once per animation frame or after a debounce
+     * @returns {ListenerSubscription} A subscription to remove the listener with
      */
-    static addPurchaserInfoUpdateListener(purchaserInfoUpdateListener: PurchaserInfoUpdateListener): void;
+    static addPurchaserInfoUpdateListener(purchaserInfoUpdateListener: PurchaserInfoUpdateListener, options?: PurchaserInfoUpdateListenerOptions): ListenerSubscription;
     /**
      * Removes a given PurchaserInfoUpdateListener
      * @param {PurchaserInfoUpdateListener} listenerToRemove PurchaserInfoUpdateListener reference of the listener to remove
      * @returns {boolean} True if listener was removed, false otherwise
      */
     static removePurchaserInfoUpdateListener(listenerToRemove: PurchaserInfoUpdateListener): boolean;
+    /**
+     * Sets a function to be called when offerings refreshed in the background are different from the stored ones
+     * @param {OfferingsUpdateListener} offeringsUpdateListener Offerings update listener
+     */
+    static addOfferingsUpdateListener(offeringsUpdateListener: OfferingsUpdateListener): void;
+    /**
+     * Removes a given OfferingsUpdateListener
+     * @param {OfferingsUpdateListener} listenerToRemove OfferingsUpdateListener reference of the listener to remove
+     * @returns {boolean} True if listener was removed, false otherwise
+     */
+    static removeOfferingsUpdateListener(listenerToRemove: OfferingsUpdateListener): boolean;
+    /**
+     * Sets a function to be called when identify, resolved with a recently identified user's purchaser info, fails to
+     * switch the SDK to that user. Calls made after identify resolved and before it failed were made for the previous
+     * user.
+     * @param {IdentifyFailedListener} identifyFailedListener Identify failed listener
+     */
+    static addIdentifyFailedListener(identifyFailedListener: IdentifyFailedListener): void;
+    /**
+     * Removes a given IdentifyFailedListener
+     * @param {IdentifyFailedListener} listenerToRemove IdentifyFailedListener reference of the listener to remove
+     * @returns {boolean} True if listener was removed, false otherwise
+     */
+    static removeIdentifyFailedListener(listenerToRemove: IdentifyFailedListener): boolean;
     /**
      * Sets a function to be called on purchases initiated on the Apple App Store. This is only used in iOS.
      * @param {ShouldPurchasePromoProductListener} shouldPurchasePromoProductListener Called when a user initiates a
@@ -591,7 +1038,8 @@ export default class Purchases {
      * the deferredPurchase function. If the app is not in a state to make a purchase: cache the deferredPurchase, then
      * call the deferredPurchase when the app is ready to make the promotional purchase.
      * If the purchase should never be made, you don't need to ever call the deferredPurchase and the app will not
-     * proceed with promotional purchases.
+     * proceed with promotional purchases. Call releaseDeferredPurchase with the callbackID to free it right away,
+     * otherwise it expires after an hour.
      */
     static addShouldPurchasePromoProductListener(shouldPurchasePromoProductListener: ShouldPurchasePromoProductListener): void;
     /**
@@ -613,9 +1061,18 @@ export default class Purchases {
     }, network: ATTRIBUTION_NETWORK, networkUserId?: string): void;
     /**
      * Gets the map of entitlements -> offerings -> products
+     * @param {GetOfferingsOptions} options Optional options. Set cachePolicy to OFFERINGS_CACHE_POLICY.STALE_WHILE_REVALIDATE
+     * to get the offerings stored from the last fetch right away, and have them refreshed in the background.
      * @returns {Promise<PurchasesOfferings>} Promise of entitlements structure
      */
-    static getOfferings(): Promise<PurchasesOfferings>;
+    static getOfferings(options?: GetOfferingsOptions): Promise<PurchasesOfferings>;
+    /**
+     * Gets the last offerings fetched by getOfferings synchronously, without waiting on the bridge.
+     * Not available when debugging remotely, use getOfferings in that case.
+     * They're cleared by identify, createAlias and reset until the offerings of the new app user are fetched.
+     * @returns {PurchasesOfferings | null} The last fetched offerings, or null if they haven't been fetched yet
+     */
+    static getCachedOfferingsSync(): PurchasesOfferings | null;
     /**
      * Fetch the product info
      * @param {String[]} productIdentifiers Array of product identifiers
@@ -624,6 +1081,17 @@ export default class Purchases {
      * configured in RevenueCat or if there is another error retrieving them. Rejections return an error code, and a userInfo object with more information.
      */
     static getProducts(productIdentifiers: string[], type?: PURCHASE_TYPE): Promise<PurchasesProduct[]>;
+    /**
+     * Fetch the product info of a large number of products in a single call. The identifiers are split in chunks
+     * sized to the store limits and every type is queried in parallel, then the results are merged and deduplicated
+     * natively.
+     * @param {String[]} productIdentifiers Array of product identifiers
+     * @param {GetProductsBatchOptions} options Optional options, with the types of products to fetch
+     * @returns {Promise<PurchasesProduct[]>} A promise containing an array of products, in the order of the
+     * identifiers. The promise will be rejected if any of the lookups fails. Rejections return an error code, and a
+     * userInfo object with more information.
+     */
+    static getProductsBatch(productIdentifiers: string[], options?: GetProductsBatchOptions): Promise<PurchasesProduct[]>;
     /**
      * Make a purchase
      *
@@ -680,16 +1148,57 @@ export default class Purchases {
      * a boolean indicating if the user cancelled the purchase, and an object with more information.
      */
     static purchaseDiscountedPackage(aPackage: PurchasesPackage, discount: PurchasesPaymentDiscount): MakePurchasePromise;
+    /**
+     * Looks up the product of a package, and signs a discount for it on iOS, ahead of the purchase, for example when
+     * the paywall is shown. Purchasing the returned PreparedPurchase with purchasePreparedPurchase then goes straight
+     * to the store. Prepared purchases are dropped after 10 minutes and when the app user changes.
+     *
+     * @param {PurchasesPackage} aPackage The Package you wish to purchase. You can get the Packages by calling getOfferings
+     * @param {PurchasesDiscount} discount iOS only. Optional discount to apply to the package, ignored on Android.
+     * @returns {Promise<PreparedPurchase>} A promise of a prepared purchase. Rejections return an error code, and a
+     * userInfo object with more information.
+     */
+    static preparePurchase(aPackage: PurchasesPackage, discount?: PurchasesDiscount | null): Promise<PreparedPurchase>;
+    /**
+     * Purchases a package prepared with preparePurchase, applying its discount if it has one.
+     *
+     * @param {PreparedPurchase} preparedPurchase The prepared purchase. It can't be purchased again after this.
+     * @param {UpgradeInfo} upgradeInfo Android only. Optional UpgradeInfo you wish to upgrade from containing the oldSKU
+     * and the optional prorationMode.
+     * @returns {Promise<{ productIdentifier: string, purchaserInfo: PurchaserInfo }>} A promise of an object containing
+     * a purchaser info object and a product identifier. Rejections return an error code,
+     * a boolean indicating if the user cancelled the purchase, and an object with more information.
+     */
+    static purchasePreparedPurchase(preparedPurchase: PreparedPurchase, upgradeInfo?: UpgradeInfo | null): MakePurchasePromise;
+    /**
+     * Releases a prepared purchase that won't be purchased. It can't be purchased after this.
+     *
+     * @param {PreparedPurchase} preparedPurchase The prepared purchase returned by preparePurchase
+     */
+    static releasePreparedPurchase(preparedPurchase: PreparedPurchase): void;
     /**
      * Restores a user's previous purchases and links their appUserIDs to any user's also using those purchases.
      * @returns {Promise<PurchaserInfo>} A promise of a purchaser info object. Rejections return an error code, and a userInfo object with more information.
      */
     static restoreTransactions(): Promise<PurchaserInfo>;
+    /**
+     * Same as restoreTransactions, but the listener is called as the restore goes through its stages, so a long
+     * restore can show its progress instead of holding the UI until it resolves.
+     * @param {RestoreProgressListener} listener Called with the RestoreProgress of every stage
+     * @returns {Promise<PurchaserInfo>} A promise of a purchaser info object. Rejections return an error code, and a userInfo object with more information.
+     */
+    static restoreTransactionsWithProgress(listener: RestoreProgressListener): Promise<PurchaserInfo>;
     /**
      * Get the appUserID
      * @returns {Promise<string>} The app user id in a promise
      */
     static getAppUserID(): Promise<string>;
+    /**
+     * Get the appUserID synchronously, without waiting on the bridge.
+     * Not available when debugging remotely, use getAppUserID in that case.
+     * @returns {string} The app user id
+     */
+    static getAppUserIDSync(): string;
     /**
      * This function will alias two appUserIDs together.
      * @param {String} newAppUserID The new appUserID that should be linked to the currently identified appUserID. Needs to be a string.
@@ -697,7 +1206,10 @@ export default class Purchases {
      */
     static createAlias(newAppUserID: string): Promise<PurchaserInfo>;
     /**
-     * This function will identify the current user with an appUserID. Typically this would be used after a logout to identify a new user without calling configure
+     * This function will identify the current user with an appUserID. Typically this would be used after a logout to identify a new user without calling configure.
+     * Switching back to a recently identified user resolves with their last purchaser info, see setUserSnapshotCacheLimit.
+     * The SDK then switches to the user in the background, see addIdentifyFailedListener. Until it has, purchases, restores
+     * and subscriber attributes still go to the previous user: wait for getAppUserID to return the new one before making them.
      * @param {String} newAppUserID The appUserID that should be linked to the currently user
      * @returns {Promise<PurchaserInfo>} A promise of a purchaser info object. Rejections return an error code, and a userInfo object with more information.
      */
@@ -714,9 +1226,75 @@ export default class Purchases {
     static setDebugLogsEnabled(enabled: boolean): Promise<void>;
     /**
      * Gets current purchaser info
+     * @param {GetPurchaserInfoOptions} options Optional options. Set lazy to true to only fetch the larger fields the first
+     * time they're read.
      * @returns {Promise<PurchaserInfo>} A promise of a purchaser info object. Rejections return an error code, and a userInfo object with more information.
      */
-    static getPurchaserInfo(): Promise<PurchaserInfo>;
+    static getPurchaserInfo(options?: GetPurchaserInfoOptions): Promise<PurchaserInfo>;
+    /**
+     * Gets how many calls to getPurchaserInfo, getOfferings and getProducts were given the result of an identical
+     * call that was already in flight, instead of making a new request.
+     * @returns {CoalescedRequestCounts} The number of coalesced calls by method
+     */
+    static getCoalescedRequestCounts(): CoalescedRequestCounts;
+    /**
+     * Enables or disables performance metrics. When enabled, getOfferings, getProducts, getPurchaserInfo, the purchase
+     * methods, restoreTransactions and checkTrialOrIntroductoryPriceEligibility are timed in JS and natively, and the
+     * size of their results is measured. setupPurchases is timed natively. Disabled by default, don't leave it enabled in production.
+     * @param {boolean} enabled Whether performance metrics should be recorded
+     */
+    static setPerformanceMetricsEnabled(enabled: boolean): void;
+    /**
+     * Gets the performance metrics recorded since they were enabled. The time spent on the bridge is roughly
+     * totalMillis minus nativeMillis and resolveMillis.
+     * @returns {PerformanceMetrics} Histograms of the measurements by native method name
+     */
+    static getPerformanceMetrics(): PerformanceMetrics;
+    /**
+     * Sets a function to be called with the updated performance metrics every time a native call is measured
+     * @param {PerformanceMetricsListener} performanceMetricsListener Performance metrics listener
+     */
+    static addPerformanceMetricsListener(performanceMetricsListener: PerformanceMetricsListener): void;
+    /**
+     * Removes a given PerformanceMetricsListener
+     * @param {PerformanceMetricsListener} listenerToRemove PerformanceMetricsListener reference of the listener to remove
+     * @returns {boolean} True if listener was removed, false otherwise
+     */
+    static removePerformanceMetricsListener(listenerToRemove: PerformanceMetricsListener): boolean;
+    /**
+     * Sets how offerings and purchaser info are sent over the bridge. COMPACT avoids repeating every key in large
+     * offerings and transaction histories, and is decoded back into the same objects.
+     * @param {PAYLOAD_ENCODING} encoding The encoding to use, MAP by default
+     */
+    static setPayloadEncoding(encoding: PAYLOAD_ENCODING): void;
+    /**
+     * Sets which fields of purchaser infos getPurchaserInfo, restoreTransactions and purchaser info listeners get.
+     * SUMMARY keeps bridge messages small for users with long transaction histories, getPurchaserInfo with lazy set to
+     * true still has every field.
+     * @param {PURCHASER_INFO_MODE} mode The mode to use, FULL by default
+     */
+    static setPurchaserInfoMode(mode: PURCHASER_INFO_MODE): void;
+    /**
+     * Gets a page of the non subscription transactions of the last purchaser info the native SDK received, fetching
+     * the purchaser info first if there isn't one yet for the current app user.
+     * @param {GetTransactionsOptions} options Optional options, with the cursor to start after and the page size
+     * @returns {Promise<PurchasesTransactionsPage>} A promise of a page of transactions. Rejections return an error
+     * code, and a userInfo object with more information, also when the cursor isn't in the purchaser info anymore.
+     */
+    static getTransactions(options?: GetTransactionsOptions): Promise<PurchasesTransactionsPage>;
+    /**
+     * Gets the last purchaser info received from the native SDK synchronously, without waiting on the bridge.
+     * Not available when debugging remotely, use getPurchaserInfo in that case.
+     * It's cleared by identify, createAlias and reset until the purchaser info of the new app user is received.
+     * @returns {PurchaserInfo | null} The last received purchaser info, or null if none has been received yet
+     */
+    static getCachedPurchaserInfoSync(): PurchaserInfo | null;
+    /**
+     * iOS only. Releases a deferred purchase received in a ShouldPurchasePromoProductListener that won't be made.
+     * The deferredPurchase function can't be called after this.
+     * @param {number} callbackID The callbackID the listener was called with
+     */
+    static releaseDeferredPurchase(callbackID: number): void;
     /**
      * This method will send all the purchases to the RevenueCat backend. Call this when using your own implementation
      * for subscriptions anytime a sync is needed, like after a successful purchase.
@@ -733,6 +1311,11 @@ export default class Purchases {
      * @returns { Promise<boolean> } If the `appUserID` has been generated by RevenueCat or not.
      */
     static isAnonymous(): Promise<boolean>;
+    /**
+     * Same as isAnonymous, but synchronous. Not available when debugging remotely, use isAnonymous in that case.
+     * @returns { boolean } If the `appUserID` has been generated by RevenueCat or not.
+     */
+    static isAnonymousSync(): boolean;
     /**
      *  iOS only. Computes whether or not a user is eligible for the introductory pricing period of a given product.
      *  You should use this method to determine whether or not you show the user the normal product price or the
@@ -750,6 +1333,20 @@ export default class Purchases {
     static checkTrialOrIntroductoryPriceEligibility(productIdentifiers: string[]): Promise<{
         [productId: string]: IntroEligibility;
     }>;
+    /**
+     *  iOS only. Same as checkTrialOrIntroductoryPriceEligibility, but the listener is called with the eligibilities as
+     *  they become known: first the ones cached during this session for the current receipt, then the rest once the
+     *  store has checked them, in a single request. Android calls the listener once, with
+     *  INTRO_ELIGIBILITY_STATUS_UNKNOWN for every product.
+     *
+     *  @param productIdentifiers Array of product identifiers for which you want to compute eligibility
+     *  @param listener Called with the IntroEligibility of some of the products, by product identifier
+     *  @returns { Promise<[productId: string]: IntroEligibility> } A map of IntroEligility per productId, once all of
+     *  them are known
+     */
+    static checkTrialOrIntroductoryPriceEligibilityStreaming(productIdentifiers: string[], listener: IntroEligibilityListener): Promise<{
+        [productId: string]: IntroEligibility;
+    }>;
     /**
      *  iOS only. Use this function to retrieve the `PurchasesPaymentDiscount` for a given `PurchasesPackage`.
      *
@@ -769,6 +1366,38 @@ export default class Purchases {
      * promotional subscription is granted through the RevenueCat dashboard.
      */
     static invalidatePurchaserInfoCache(): void;
+    /**
+     * Sets how much memory the purchaser info and offerings of recently identified app users can take natively. When
+     * identify switches back to one of them, it resolves with their last purchaser info right away and revalidates in
+     * the background, listeners get the purchaser info if it changed. 1 MB by default, estimated as JSON.
+     * @param {number} maxBytes Maximum size of the snapshots in bytes, the least recently identified users are dropped
+     * first. 0 disables the snapshots
+     */
+    static setUserSnapshotCacheLimit(maxBytes: number): void;
+    /**
+     * Sets how long the products fetched by getProducts and getProductsBatch are cached natively, to be served
+     * without going back to the store. 5 minutes by default.
+     * @param {number} ttlSeconds Time to live of the cached products in seconds, 0 disables the cache
+     */
+    static setProductCacheTTL(ttlSeconds: number): void;
+    /**
+     * Removes all the products from the native product cache, so the next getProducts and getProductsBatch calls
+     * fetch them from the store.
+     */
+    static invalidateProductCache(): void;
+    /**
+     * Gets how many product identifiers looked up by getProducts and getProductsBatch were served from the native
+     * product cache, and how many had to be fetched from the store.
+     * @returns {Promise<ProductCacheStats>} A promise of the cache hits and misses since the app started
+     */
+    static getProductCacheStats(): Promise<ProductCacheStats>;
+    /**
+     * Gets how many subscriber attribute, attribution data and syncPurchases calls are waiting to be sent. Calls made
+     * before setup or while the device is offline are kept on disk and sent together once connectivity returns.
+     * They're also sent before the app user changes, so the SDK keeps them for the user they were made for.
+     * @returns {Promise<number>} A promise of the number of queued operations
+     */
+    static getQueuedOperationCount(): Promise<number>;
     /**
      * Subscriber attributes are useful for storing additional, structured information on a user.
      * Since attributes are writable using a public key they should not be used for
@@ -782,6 +1411,13 @@ export default class Purchases {
     static setAttributes(attributes: {
         [key: string]: string | null;
     }): void;
+    /**
+     * Sets several subscriber attributes with a single call to the native SDK. Calls made during the same tick are
+     * merged, with later values for the same attribute replacing earlier ones, and sent together.
+     *
+     * @param batch Subscriber attributes to set. Attributes that are not present are left untouched.
+     */
+    static setAttributesBatch(batch: SubscriberAttributesBatch): void;
     /**
      * Subscriber attribute associated with the email address for the user
      *
@@ -1,6 +1,6 @@
 "use strict";
 Object.defineProperty(exports, "__esModule", { value: true });
-exports.isUTCDateStringFuture = exports.INTRO_ELIGIBILITY_STATUS = exports.PACKAGE_TYPE = exports.PRORATION_MODE = exports.PURCHASE_TYPE = exports.ATTRIBUTION_NETWORK = void 0;
+exports.getActiveEntitlements = exports.isUTCDateStringFuture = exports.RESTORE_PROGRESS_STAGE = exports.PURCHASER_INFO_MODE = exports.PAYLOAD_ENCODING = exports.OFFERINGS_CACHE_POLICY = exports.INTRO_ELIGIBILITY_STATUS = exports.PACKAGE_TYPE = exports.PRORATION_MODE = exports.PURCHASE_TYPE = exports.ATTRIBUTION_NETWORK = void 0;
 // @ts-ignore
 var react_native_1 = require("react-native");
 var RNPurchases = react_native_1.NativeModules.RNPurchases;
@@ -104,24 +104,393 @@ var INTRO_ELIGIBILITY_STATUS;
      */
     INTRO_ELIGIBILITY_STATUS[INTRO_ELIGIBILITY_STATUS["INTRO_ELIGIBILITY_STATUS_ELIGIBLE"] = 2] = "INTRO_ELIGIBILITY_STATUS_ELIGIBLE";
 })(INTRO_ELIGIBILITY_STATUS = exports.INTRO_ELIGIBILITY_STATUS || (exports.INTRO_ELIGIBILITY_STATUS = {}));
-var purchaserInfoUpdateListeners = [];
+var OFFERINGS_CACHE_POLICY;
+(function (OFFERINGS_CACHE_POLICY) {
+    /**
+     * Always fetch the offerings and wait for the response.
+     */
+    OFFERINGS_CACHE_POLICY["FETCH"] = "fetch";
+    /**
+     * Resolve right away with the offerings stored from the last fetch, if there are any, and refresh them in the
+     * background. Refreshed offerings are sent to the listeners added with addOfferingsUpdateListener.
+     */
+    OFFERINGS_CACHE_POLICY["STALE_WHILE_REVALIDATE"] = "staleWhileRevalidate";
+})(OFFERINGS_CACHE_POLICY = exports.OFFERINGS_CACHE_POLICY || (exports.OFFERINGS_CACHE_POLICY = {}));
+var PAYLOAD_ENCODING;
+(function (PAYLOAD_ENCODING) {
+    /**
+     * Offerings and purchaser info are sent over the bridge as maps.
+     */
+    PAYLOAD_ENCODING["MAP"] = "map";
+    /**
+     * Offerings and purchaser info are sent with every key interned, and decoded back into the same objects in JS.
+     * Much smaller bridge messages for large offerings and long transaction histories.
+     */
+    PAYLOAD_ENCODING["COMPACT"] = "compact";
+})(PAYLOAD_ENCODING = exports.PAYLOAD_ENCODING || (exports.PAYLOAD_ENCODING = {}));
+var PURCHASER_INFO_MODE;
+(function (PURCHASER_INFO_MODE) {
+    /**
+     * Purchaser infos are sent with every field.
+     */
+    PURCHASER_INFO_MODE["FULL"] = "full";
+    /**
+     * allExpirationDates, allPurchaseDates and nonSubscriptionTransactions, which grow with every purchase, are sent
+     * empty. isSummary is true and nonSubscriptionTransactionCount has the number of transactions, page through them
+     * with getTransactions.
+     */
+    PURCHASER_INFO_MODE["SUMMARY"] = "summary";
+})(PURCHASER_INFO_MODE = exports.PURCHASER_INFO_MODE || (exports.PURCHASER_INFO_MODE = {}));
+var RESTORE_PROGRESS_STAGE;
+(function (RESTORE_PROGRESS_STAGE) {
+    /**
+     * The restore started, the store history is being synced.
+     */
+    RESTORE_PROGRESS_STAGE["STARTED"] = "started";
+    /**
+     * The SDK restored the purchases, purchasedProductCount is known and the purchaser info is being converted.
+     */
+    RESTORE_PROGRESS_STAGE["RESTORED"] = "restored";
+    /**
+     * The purchaser info was converted, the promise resolves right after.
+     */
+    RESTORE_PROGRESS_STAGE["PROCESSED"] = "processed";
+})(RESTORE_PROGRESS_STAGE = exports.RESTORE_PROGRESS_STAGE || (exports.RESTORE_PROGRESS_STAGE = {}));
+var purchaserInfoUpdateListeners = new Map();
 var shouldPurchasePromoProductListeners = [];
-exports.isUTCDateStringFuture = function (dateString) {
-    var date = new Date(dateString);
-    var dateUtcMillis = date.valueOf();
-    var now = new Date();
-    var nowUtcMillis = Date.UTC(now.getUTCFullYear(), now.getUTCMonth(), now.getUTCDate(), now.getUTCHours(), now.getUTCMinutes(), now.getUTCSeconds(), now.getUTCMilliseconds());
-    return nowUtcMillis < dateUtcMillis;
+var offeringsUpdateListeners = [];
+var identifyFailedListeners = [];
+var inFlightRequests = {};
+var coalescedRequestCounts = {
+    getPurchaserInfo: 0,
+    getOfferings: 0,
+    getProductInfo: 0,
+};
+var pendingAttributesBatch = null;
+var performanceMetricsEnabled = false;
+var performanceMetricsListeners = [];
+var introEligibilityListeners = new Map();
+var lastIntroEligibilityRequestID = 0;
+var restoreProgressListeners = new Map();
+var lastRestoreRequestID = 0;
+var performanceMetrics = {};
+var MILLIS_BUCKET_UPPER_BOUNDS = [1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000];
+var BYTES_BUCKET_UPPER_BOUNDS = [1024, 4096, 16384, 65536, 262144, 1048576];
+var QUEUE_DEPTH_BUCKET_UPPER_BOUNDS = [1, 2, 5, 10, 20, 50, 100, 200, 500, 1000];
+var DEFAULT_TRANSACTIONS_PAGE_SIZE = 50;
+// Date.now() is already UTC, there's no need to build a Date for now
+exports.isUTCDateStringFuture = function (dateString) { return Date.now() < Date.parse(dateString); };
+/**
+ * Evaluates which entitlements are active, comparing every expiration date against a single Date.now(). Unlike
+ * entitlements.active, the result follows the clock instead of reflecting when the purchaser info was fetched.
+ * @param {PurchaserInfo} purchaserInfo The purchaser info to evaluate
+ * @param {number} nowMillis Optional time to evaluate at, in milliseconds since the epoch. Now by default
+ * @returns {{ [key: string]: PurchasesEntitlementInfo }} The entitlements that don't expire or expire after
+ * nowMillis, keyed by entitlement identifier
+ */
+exports.getActiveEntitlements = function (purchaserInfo, nowMillis) {
+    if (nowMillis === void 0) { nowMillis = Date.now(); }
+    var all = purchaserInfo.entitlements.all;
+    var active = {};
+    Object.keys(all).forEach(function (identifier) {
+        var entitlement = all[identifier];
+        var expirationDateMillis = entitlement.expirationDateMillis;
+        if (expirationDateMillis === undefined) {
+            expirationDateMillis = entitlement.expirationDate === null ? null : Date.parse(entitlement.expirationDate);
+        }
+        if (expirationDateMillis === null || expirationDateMillis > nowMillis) {
+            active[identifier] = entitlement;
+        }
+    });
+    return active;
 };
-eventEmitter.addListener("Purchases-PurchaserInfoUpdated", function (purchaserInfo) {
-    purchaserInfoUpdateListeners.forEach(function (listener) { return listener(purchaserInfo); });
-});
-eventEmitter.addListener("Purchases-ShouldPurchasePromoProduct", function (_a) {
+var emptyHistogram = function (bucketUpperBounds) { return ({
+    count: 0,
+    sum: 0,
+    min: 0,
+    max: 0,
+    bucketUpperBounds: bucketUpperBounds,
+    bucketCounts: bucketUpperBounds.map(function () { return 0; }).concat([0]),
+}); };
+var recordMeasurement = function (method, measurement, value) {
+    if (!performanceMetrics[method]) {
+        performanceMetrics[method] = {
+            totalMillis: emptyHistogram(MILLIS_BUCKET_UPPER_BOUNDS),
+            nativeMillis: emptyHistogram(MILLIS_BUCKET_UPPER_BOUNDS),
+            conversionMillis: emptyHistogram(MILLIS_BUCKET_UPPER_BOUNDS),
+            resolveMillis: emptyHistogram(MILLIS_BUCKET_UPPER_BOUNDS),
+            payloadBytes: emptyHistogram(BYTES_BUCKET_UPPER_BOUNDS),
+        };
+    }
+    // the queue depth and main thread time are only measured for some methods, their histograms are added with the
+    // first measurement
+    if (!performanceMetrics[method][measurement]) {
+        performanceMetrics[method][measurement] = emptyHistogram(measurement === "queueDepth" ? QUEUE_DEPTH_BUCKET_UPPER_BOUNDS : MILLIS_BUCKET_UPPER_BOUNDS);
+    }
+    var histogram = performanceMetrics[method][measurement];
+    histogram.min = histogram.count === 0 ? value : Math.min(histogram.min, value);
+    histogram.max = histogram.count === 0 ? value : Math.max(histogram.max, value);
+    histogram.count += 1;
+    histogram.sum += value;
+    var bucket = histogram.bucketUpperBounds.findIndex(function (upperBound) { return value <= upperBound; });
+    histogram.bucketCounts[bucket === -1 ? histogram.bucketUpperBounds.length : bucket] += 1;
+};
+var copyPerformanceMetrics = function () { return JSON.parse(JSON.stringify(performanceMetrics)); };
+// Times the native call from JS when performance metrics are enabled, the native side sends the rest
+var measure = function (method, promise) {
+    if (!performanceMetricsEnabled) {
+        return promise;
+    }
+    var callTime = Date.now();
+    var record = function () { return recordMeasurement(method, "totalMillis", Date.now() - callTime); };
+    promise.then(record, record);
+    return promise;
+};
+// Compact payloads are { compactKeys, compactValue }. In compactValue maps are [0, keyIndex, value, ...] and lists
+// [1, value, ...], with every key replaced by its index in compactKeys
+var COMPACT_MAP = 0;
+var decodeCompactValue = function (value, keys) {
+    if (!Array.isArray(value)) {
+        return value;
+    }
+    if (value[0] === COMPACT_MAP) {
+        var map = {};
+        for (var i = 1; i < value.length; i += 2) {
+            map[keys[value[i]]] = decodeCompactValue(value[i + 1], keys);
+        }
+        return map;
+    }
+    var list = new Array(value.length - 1);
+    for (var j = 1; j < value.length; j++) {
+        list[j - 1] = decodeCompactValue(value[j], keys);
+    }
+    return list;
+};
+var decodePayload = function (payload) {
+    return payload && payload.compactKeys ? decodeCompactValue(payload.compactValue, payload.compactKeys) : payload;
+};
+// Bursts of updates, like the ones during a restore, only reach coalesced listeners with the latest purchaser info
+var createPurchaserInfoUpdateDispatcher = function (listener, options) {
+    var debounceMillis = options && options.debounceMillis;
+    if (!debounceMillis && !(options && options.coalesceToAnimationFrame)) {
+        return { dispatch: listener, cancel: function () { return undefined; } };
+    }
+    var latestPurchaserInfo;
+    var cancelPending = null;
+    var flush = function () {
+        cancelPending = null;
+        listener(latestPurchaserInfo);
+    };
+    var cancel = function () {
+        if (cancelPending) {
+            cancelPending();
+            cancelPending = null;
+        }
+    };
+    return {
+        dispatch: function (purchaserInfo) {
+            latestPurchaserInfo = purchaserInfo;
+            if (debounceMillis) {
+                cancel();
+                var timeout = setTimeout(flush, debounceMillis);
+                cancelPending = function () { return clearTimeout(timeout); };
+            }
+            else if (!cancelPending) {
+                var frame = requestAnimationFrame(flush);
+                cancelPending = function () { return cancelAnimationFrame(frame); };
+            }
+        },
+        cancel: cancel,
+    };
+};
+var requestKey = function (method, args) { return method + ":" + JSON.stringify(args); };
+var trackInFlight = function (key, promise) {
+    inFlightRequests[key] = promise;
+    var clear = function () {
+        if (inFlightRequests[key] === promise) {
+            delete inFlightRequests[key];
+        }
+    };
+    promise.then(clear, clear);
+    return promise;
+};
+// The purchaser info and offerings in flight were requested for the app user being replaced, they aren't shared with
+// the requests made for the next one
+var forgetAppUserRequests = function () {
+    Object.keys(inFlightRequests).forEach(function (key) {
+        if (key.startsWith("getPurchaserInfo:") || key.startsWith("getOfferings:")) {
+            delete inFlightRequests[key];
+        }
+    });
+};
+var changeAppUser = function (change) {
+    forgetAppUserRequests();
+    var changed = change();
+    changed.then(forgetAppUserRequests, forgetAppUserRequests);
+    return changed;
+};
+// Concurrent identical calls share the request already in flight instead of crossing the bridge again
+var singleFlight = function (method, args, request) {
+    var inFlight = inFlightRequests[requestKey(method, args)];
+    if (inFlight) {
+        coalescedRequestCounts[method] += 1;
+        return inFlight;
+    }
+    return trackInFlight(requestKey(method, args), request());
+};
+// Same as the number of handles kept natively by getPurchaserInfoLazy
+var MAX_LAZY_PURCHASER_INFOS = 16;
+// Turns the fields left out by getPurchaserInfoLazy into getters that fetch them from native when first read
+var withLazyFields = function (lazyPurchaserInfo) {
+    var handle = lazyPurchaserInfo.lazyFieldsHandle;
+    var fields = lazyPurchaserInfo.lazyFields;
+    delete lazyPurchaserInfo.lazyFieldsHandle;
+    delete lazyPurchaserInfo.lazyFields;
+    fields.forEach(function (field) {
+        var path = field.split(".");
+        var key = path.pop();
+        var owner = path.reduce(function (object, pathKey) { return object && object[pathKey]; }, lazyPurchaserInfo);
+        if (!owner) {
+            return;
+        }
+        Object.defineProperty(owner, key, {
+            configurable: true,
+            enumerable: true,
+            get: function () {
+                var result = RNPurchases.getPurchaserInfoField(handle, field);
+                if (result.evicted) {
+                    throw new Error(field + " of this lazy purchaser info was released after " + MAX_LAZY_PURCHASER_INFOS + " newer ones were fetched, " +
+                        "read it before calling getPurchaserInfo({lazy: true}) again or get a new purchaser info");
+                }
+                var value = result.value;
+                Object.defineProperty(owner, key, { configurable: true, enumerable: true, value: value });
+                return value;
+            },
+        });
+    });
+    return lazyPurchaserInfo;
+};
+var productIdentifiersInOfferings = function (offerings) {
+    var productIdentifiers = [];
+    Object.keys(offerings.all).forEach(function (offeringIdentifier) {
+        offerings.all[offeringIdentifier].availablePackages.forEach(function (aPackage) {
+            if (!productIdentifiers.includes(aPackage.product.identifier)) {
+                productIdentifiers.push(aPackage.product.identifier);
+            }
+        });
+    });
+    return productIdentifiers;
+};
+var prewarm = function (options) {
+    var productIdentifiers = options.productIdentifiers || [];
+    if (productIdentifiers.length > 0) {
+        trackInFlight(requestKey("getProductInfo", [productIdentifiers, PURCHASE_TYPE.SUBS]), measure("getProductInfo", RNPurchases.getProductInfo(productIdentifiers, PURCHASE_TYPE.SUBS)));
+    }
+    if (options.offerings || options.eligibility) {
+        var offerings = trackInFlight(requestKey("getOfferings", []), measure("getOfferings", RNPurchases.getOfferings().then(decodePayload)));
+        if (options.eligibility) {
+            trackInFlight("checkTrialOrIntroductoryPriceEligibility", offerings.then(function (fetchedOfferings) {
+                var eligibilityProductIdentifiers = productIdentifiersInOfferings(fetchedOfferings);
+                productIdentifiers.forEach(function (productIdentifier) {
+                    if (!eligibilityProductIdentifiers.includes(productIdentifier)) {
+                        eligibilityProductIdentifiers.push(productIdentifier);
+                    }
+                });
+                return measure("checkTrialOrIntroductoryPriceEligibility", RNPurchases.checkTrialOrIntroductoryPriceEligibility(eligibilityProductIdentifiers));
+            }));
+        }
+    }
+};
+var flushAttributesBatch = function () {
+    var batch = pendingAttributesBatch;
+    pendingAttributesBatch = null;
+    RNPurchases.setAttributesBatch(batch);
+};
+// Native events are only subscribed to while something listens to them, so loading the module doesn't register
+// anything with the bridge on screens that never use purchases. Native is told which events are observed so it
+// doesn't convert the others
+var nativeEventSubscriptions = {};
+var setNativeEventSubscribed = function (eventName, handler, subscribed) {
+    var subscription = nativeEventSubscriptions[eventName];
+    if (subscribed && !subscription) {
+        nativeEventSubscriptions[eventName] = eventEmitter.addListener(eventName, handler);
+    }
+    else if (!subscribed && subscription) {
+        subscription.remove();
+        nativeEventSubscriptions[eventName] = undefined;
+    }
+    else {
+        return;
+    }
+    RNPurchases.setEventObserved(eventName, subscribed);
+};
+var onPurchaserInfoUpdated = function (payload) {
+    var purchaserInfo = decodePayload(payload);
+    purchaserInfoUpdateListeners.forEach(function (dispatcher) { return dispatcher.dispatch(purchaserInfo); });
+};
+// Same as the number of deferment blocks kept natively on iOS, the oldest ones are dropped
+var MAX_DEFERRED_PURCHASES = 32;
+var pendingDeferredPurchases = [];
+var removePendingDeferredPurchase = function (callbackID) {
+    var pending = pendingDeferredPurchases.includes(callbackID);
+    pendingDeferredPurchases = pendingDeferredPurchases.filter(function (pendingCallbackID) { return pendingCallbackID !== callbackID; });
+    return pending;
+};
+var makeDeferredPurchase = function (callbackID) {
+    if (!removePendingDeferredPurchase(callbackID)) {
+        return Promise.reject(new Error("The deferred purchase was already made, released or dropped"));
+    }
+    return RNPurchases.makeDeferredPurchase(callbackID);
+};
+var onShouldPurchasePromoProduct = function (_a) {
     var callbackID = _a.callbackID;
+    removePendingDeferredPurchase(callbackID);
+    pendingDeferredPurchases.push(callbackID);
+    if (pendingDeferredPurchases.length > MAX_DEFERRED_PURCHASES) {
+        pendingDeferredPurchases.shift();
+    }
     shouldPurchasePromoProductListeners.forEach(function (listener) {
-        return listener(function () { return RNPurchases.makeDeferredPurchase(callbackID); });
+        return listener(function () { return makeDeferredPurchase(callbackID); }, callbackID);
     });
-});
+};
+var onOfferingsUpdated = function (payload) {
+    var offerings = decodePayload(payload);
+    offeringsUpdateListeners.forEach(function (listener) { return listener(offerings); });
+};
+var onIdentifyFailed = function (_a) {
+    var appUserID = _a.appUserID, error = _a.error;
+    identifyFailedListeners.forEach(function (listener) { return listener(appUserID, error); });
+};
+var onMetricsSample = function (sample) {
+    recordMeasurement(sample.method, "nativeMillis", sample.sdkCompletion - sample.nativeEntry);
+    recordMeasurement(sample.method, "conversionMillis", sample.conversionMillis);
+    recordMeasurement(sample.method, "resolveMillis", sample.resolve - sample.sdkCompletion);
+    recordMeasurement(sample.method, "payloadBytes", sample.payloadBytes);
+    if (sample.queueDepth !== undefined) {
+        recordMeasurement(sample.method, "queueDepth", sample.queueDepth);
+    }
+    if (sample.mainThreadMillis !== undefined) {
+        recordMeasurement(sample.method, "mainThreadMillis", sample.mainThreadMillis);
+    }
+    if (performanceMetricsListeners.length > 0) {
+        var metrics = copyPerformanceMetrics();
+        performanceMetricsListeners.forEach(function (listener) { return listener(metrics); });
+    }
+};
+var onIntroEligibility = function (_a) {
+    var requestID = _a.requestID, eligibilities = _a.eligibilities;
+    var listener = introEligibilityListeners.get(requestID);
+    if (listener) {
+        listener(eligibilities);
+    }
+};
+var onRestoreProgress = function (_a) {
+    var requestID = _a.requestID, stage = _a.stage, processedProductCount = _a.processedProductCount, purchasedProductCount = _a.purchasedProductCount;
+    var listener = restoreProgressListeners.get(requestID);
+    if (listener) {
+        listener({ stage: stage, processedProductCount: processedProductCount, purchasedProductCount: purchasedProductCount });
+    }
+};
 var Purchases = /** @class */ (function () {
     function Purchases() {
     }
@@ -133,14 +502,21 @@ var Purchases = /** @class */ (function () {
      * @param {String?} userDefaultsSuiteName An optional string. iOS-only, will be ignored for Android.
      * Set this if you would like the RevenueCat SDK to store its preferences in a different NSUserDefaults suite, otherwise it will use standardUserDefaults.
      * Default is null, which will make the SDK use standardUserDefaults.
+     * @param {SetupOptions?} options An optional object. Set prewarm to start fetching offerings, products and intro
+     * eligibility right after setup.
      * @returns {Promise<void>} Returns when setup completes
      */
-    Purchases.setup = function (apiKey, appUserID, observerMode, userDefaultsSuiteName) {
+    Purchases.setup = function (apiKey, appUserID, observerMode, userDefaultsSuiteName, options) {
         if (observerMode === void 0) { observerMode = false; }
         if (appUserID !== null && typeof appUserID !== "undefined" && typeof appUserID !== "string") {
             throw new Error("appUserID needs to be a string");
         }
-        return RNPurchases.setupPurchases(apiKey, appUserID, observerMode, userDefaultsSuiteName);
+        var setupPromise = RNPurchases.setupPurchases(apiKey, appUserID, observerMode, userDefaultsSuiteName);
+        // Native calls run in order, so these start right after the SDK is configured
+        if (options && options.prewarm) {
+            prewarm(options.prewarm);
+        }
+        return setupPromise;
     };
     /**
      * @param {Boolean} allowSharing Set this to true if you are passing in an appUserID but it is anonymous, this is true by default if you didn't pass an appUserID
@@ -157,14 +533,31 @@ var Purchases = /** @class */ (function () {
         RNPurchases.setFinishTransactions(finishTransactions);
     };
     /**
-     * Sets a function to be called on updated purchaser info
+     * Sets a function to be called on updated purchaser info. Adding a listener that was already added replaces its
+     * options.
      * @param {PurchaserInfoUpdateListener} purchaserInfoUpdateListener PurchaserInfo update listener
+     * @param {PurchaserInfoUpdateListenerOptions} options Optional options, to only call the listener with the latest
+     * purchaser info once per animation frame or after a debounce
+     * @returns {ListenerSubscription} A subscription to remove the listener with
      */
-    Purchases.addPurchaserInfoUpdateListener = function (purchaserInfoUpdateListener) {
+    Purchases.addPurchaserInfoUpdateListener = function (purchaserInfoUpdateListener, options) {
         if (typeof purchaserInfoUpdateListener !== "function") {
             throw new Error("addPurchaserInfoUpdateListener needs a function");
         }
-        purchaserInfoUpdateListeners.push(purchaserInfoUpdateListener);
+        var previousDispatcher = purchaserInfoUpdateListeners.get(purchaserInfoUpdateListener);
+        if (previousDispatcher) {
+            previousDispatcher.cancel();
+        }
+        var dispatcher = createPurchaserInfoUpdateDispatcher(purchaserInfoUpdateListener, options);
+        purchaserInfoUpdateListeners.set(purchaserInfoUpdateListener, dispatcher);
+        setNativeEventSubscribed("Purchases-PurchaserInfoUpdated", onPurchaserInfoUpdated, true);
+        return {
+            remove: function () {
+                if (purchaserInfoUpdateListeners.get(purchaserInfoUpdateListener) === dispatcher) {
+                    Purchases.removePurchaserInfoUpdateListener(purchaserInfoUpdateListener);
+                }
+            },
+        };
     };
     /**
      * Removes a given PurchaserInfoUpdateListener
@@ -172,8 +565,61 @@ var Purchases = /** @class */ (function () {
      * @returns {boolean} True if listener was removed, false otherwise
      */
     Purchases.removePurchaserInfoUpdateListener = function (listenerToRemove) {
-        if (purchaserInfoUpdateListeners.includes(listenerToRemove)) {
-            purchaserInfoUpdateListeners = purchaserInfoUpdateListeners.filter(function (listener) { return listenerToRemove !== listener; });
+        var dispatcher = purchaserInfoUpdateListeners.get(listenerToRemove);
+        if (!dispatcher) {
+            return false;
+        }
+        dispatcher.cancel();
+        purchaserInfoUpdateListeners.delete(listenerToRemove);
+        setNativeEventSubscribed("Purchases-PurchaserInfoUpdated", onPurchaserInfoUpdated, purchaserInfoUpdateListeners.size > 0);
+        return true;
+    };
+    /**
+     * Sets a function to be called when offerings refreshed in the background are different from the stored ones
+     * @param {OfferingsUpdateListener} offeringsUpdateListener Offerings update listener
+     */
+    Purchases.addOfferingsUpdateListener = function (offeringsUpdateListener) {
+        if (typeof offeringsUpdateListener !== "function") {
+            throw new Error("addOfferingsUpdateListener needs a function");
+        }
+        offeringsUpdateListeners.push(offeringsUpdateListener);
+        setNativeEventSubscribed("Purchases-OfferingsUpdated", onOfferingsUpdated, true);
+    };
+    /**
+     * Removes a given OfferingsUpdateListener
+     * @param {OfferingsUpdateListener} listenerToRemove OfferingsUpdateListener reference of the listener to remove
+     * @returns {boolean} True if listener was removed, false otherwise
+     */
+    Purchases.removeOfferingsUpdateListener = function (listenerToRemove) {
+        if (offeringsUpdateListeners.includes(listenerToRemove)) {
+            offeringsUpdateListeners = offeringsUpdateListeners.filter(function (listener) { return listenerToRemove !== listener; });
+            setNativeEventSubscribed("Purchases-OfferingsUpdated", onOfferingsUpdated, offeringsUpdateListeners.length > 0);
+            return true;
+        }
+        return false;
+    };
+    /**
+     * Sets a function to be called when identify, resolved with a recently identified user's purchaser info, fails to
+     * switch the SDK to that user. Calls made after identify resolved and before it failed were made for the previous
+     * user.
+     * @param {IdentifyFailedListener} identifyFailedListener Identify failed listener
+     */
+    Purchases.addIdentifyFailedListener = function (identifyFailedListener) {
+        if (typeof identifyFailedListener !== "function") {
+            throw new Error("addIdentifyFailedListener needs a function");
+        }
+        identifyFailedListeners.push(identifyFailedListener);
+        setNativeEventSubscribed("Purchases-IdentifyFailed", onIdentifyFailed, true);
+    };
+    /**
+     * Removes a given IdentifyFailedListener
+     * @param {IdentifyFailedListener} listenerToRemove IdentifyFailedListener reference of the listener to remove
+     * @returns {boolean} True if listener was removed, false otherwise
+     */
+    Purchases.removeIdentifyFailedListener = function (listenerToRemove) {
+        if (identifyFailedListeners.includes(listenerToRemove)) {
+            identifyFailedListeners = identifyFailedListeners.filter(function (listener) { return listenerToRemove !== listener; });
+            setNativeEventSubscribed("Purchases-IdentifyFailed", onIdentifyFailed, identifyFailedListeners.length > 0);
             return true;
         }
         return false;
@@ -185,13 +631,15 @@ var Purchases = /** @class */ (function () {
      * the deferredPurchase function. If the app is not in a state to make a purchase: cache the deferredPurchase, then
      * call the deferredPurchase when the app is ready to make the promotional purchase.
      * If the purchase should never be made, you don't need to ever call the deferredPurchase and the app will not
-     * proceed with promotional purchases.
+     * proceed with promotional purchases. Call releaseDeferredPurchase with the callbackID to free it right away,
+     * otherwise it expires after an hour.
      */
     Purchases.addShouldPurchasePromoProductListener = function (shouldPurchasePromoProductListener) {
         if (typeof shouldPurchasePromoProductListener !== "function") {
             throw new Error("addShouldPurchasePromoProductListener needs a function");
         }
         shouldPurchasePromoProductListeners.push(shouldPurchasePromoProductListener);
+        setNativeEventSubscribed("Purchases-ShouldPurchasePromoProduct", onShouldPurchasePromoProduct, true);
     };
     /**
      * Removes a given ShouldPurchasePromoProductListener
@@ -201,6 +649,7 @@ var Purchases = /** @class */ (function () {
     Purchases.removeShouldPurchasePromoProductListener = function (listenerToRemove) {
         if (shouldPurchasePromoProductListeners.includes(listenerToRemove)) {
             shouldPurchasePromoProductListeners = shouldPurchasePromoProductListeners.filter(function (listener) { return listenerToRemove !== listener; });
+            setNativeEventSubscribed("Purchases-ShouldPurchasePromoProduct", onShouldPurchasePromoProduct, shouldPurchasePromoProductListeners.length > 0);
             return true;
         }
         return false;
@@ -218,10 +667,24 @@ var Purchases = /** @class */ (function () {
     };
     /**
      * Gets the map of entitlements -> offerings -> products
+     * @param {GetOfferingsOptions} options Optional options. Set cachePolicy to OFFERINGS_CACHE_POLICY.STALE_WHILE_REVALIDATE
+     * to get the offerings stored from the last fetch right away, and have them refreshed in the background.
      * @returns {Promise<PurchasesOfferings>} Promise of entitlements structure
      */
-    Purchases.getOfferings = function () {
-        return RNPurchases.getOfferings();
+    Purchases.getOfferings = function (options) {
+        if (options && options.cachePolicy === OFFERINGS_CACHE_POLICY.STALE_WHILE_REVALIDATE) {
+            return RNPurchases.getOfferingsStaleWhileRevalidate().then(decodePayload);
+        }
+        return singleFlight("getOfferings", [], function () { return measure("getOfferings", RNPurchases.getOfferings().then(decodePayload)); });
+    };
+    /**
+     * Gets the last offerings fetched by getOfferings synchronously, without waiting on the bridge.
+     * Not available when debugging remotely, use getOfferings in that case.
+     * They're cleared by identify, createAlias and reset until the offerings of the new app user are fetched.
+     * @returns {PurchasesOfferings | null} The last fetched offerings, or null if they haven't been fetched yet
+     */
+    Purchases.getCachedOfferingsSync = function () {
+        return decodePayload(RNPurchases.getCachedOfferingsSync());
     };
     /**
      * Fetch the product info
@@ -232,7 +695,25 @@ var Purchases = /** @class */ (function () {
      */
     Purchases.getProducts = function (productIdentifiers, type) {
         if (type === void 0) { type = PURCHASE_TYPE.SUBS; }
-        return RNPurchases.getProductInfo(productIdentifiers, type);
+        return singleFlight("getProductInfo", [productIdentifiers, type], function () {
+            return measure("getProductInfo", RNPurchases.getProductInfo(productIdentifiers, type));
+        });
+    };
+    /**
+     * Fetch the product info of a large number of products in a single call. The identifiers are split in chunks
+     * sized to the store limits and every type is queried in parallel, then the results are merged and deduplicated
+     * natively.
+     * @param {String[]} productIdentifiers Array of product identifiers
+     * @param {GetProductsBatchOptions} options Optional options, with the types of products to fetch
+     * @returns {Promise<PurchasesProduct[]>} A promise containing an array of products, in the order of the
+     * identifiers. The promise will be rejected if any of the lookups fails. Rejections return an error code, and a
+     * userInfo object with more information.
+     */
+    Purchases.getProductsBatch = function (productIdentifiers, options) {
+        var types = (options && options.types) || [PURCHASE_TYPE.SUBS, PURCHASE_TYPE.INAPP];
+        return singleFlight("getProductInfo", ["batch", productIdentifiers, types], function () {
+            return measure("getProductInfoBatch", RNPurchases.getProductInfoBatch(productIdentifiers, types));
+        });
     };
     /**
      * Make a purchase
@@ -277,7 +758,7 @@ var Purchases = /** @class */ (function () {
      */
     Purchases.purchaseProduct = function (productIdentifier, upgradeInfo, type) {
         if (type === void 0) { type = PURCHASE_TYPE.SUBS; }
-        return RNPurchases.purchaseProduct(productIdentifier, upgradeInfo, type, null).catch(function (error) {
+        return measure("purchaseProduct", RNPurchases.purchaseProduct(productIdentifier, upgradeInfo, type, null)).catch(function (error) {
             error.userCancelled = error.code === "1";
             throw error;
         });
@@ -295,7 +776,7 @@ var Purchases = /** @class */ (function () {
         if (typeof discount === "undefined" || discount == null) {
             throw new Error("A discount is required");
         }
-        return RNPurchases.purchaseProduct(product.identifier, null, null, discount.timestamp.toString()).catch(function (error) {
+        return measure("purchaseProduct", RNPurchases.purchaseProduct(product.identifier, null, null, discount.timestamp.toString())).catch(function (error) {
             error.userCancelled = error.code === "1";
             throw error;
         });
@@ -311,7 +792,7 @@ var Purchases = /** @class */ (function () {
      * a boolean indicating if the user cancelled the purchase, and an object with more information.
      */
     Purchases.purchasePackage = function (aPackage, upgradeInfo) {
-        return RNPurchases.purchasePackage(aPackage.identifier, aPackage.offeringIdentifier, upgradeInfo, null).catch(function (error) {
+        return measure("purchasePackage", RNPurchases.purchasePackage(aPackage.identifier, aPackage.offeringIdentifier, upgradeInfo, null)).catch(function (error) {
             error.userCancelled = error.code === "1";
             throw error;
         });
@@ -329,17 +810,77 @@ var Purchases = /** @class */ (function () {
         if (typeof discount === "undefined" || discount == null) {
             throw new Error("A discount is required");
         }
-        return RNPurchases.purchasePackage(aPackage.identifier, aPackage.offeringIdentifier, null, discount.timestamp.toString()).catch(function (error) {
+        return measure("purchasePackage", RNPurchases.purchasePackage(aPackage.identifier, aPackage.offeringIdentifier, null, discount.timestamp.toString())).catch(function (error) {
+            error.userCancelled = error.code === "1";
+            throw error;
+        });
+    };
+    /**
+     * Looks up the product of a package, and signs a discount for it on iOS, ahead of the purchase, for example when
+     * the paywall is shown. Purchasing the returned PreparedPurchase with purchasePreparedPurchase then goes straight
+     * to the store. Prepared purchases are dropped after 10 minutes and when the app user changes.
+     *
+     * @param {PurchasesPackage} aPackage The Package you wish to purchase. You can get the Packages by calling getOfferings
+     * @param {PurchasesDiscount} discount iOS only. Optional discount to apply to the package, ignored on Android.
+     * @returns {Promise<PreparedPurchase>} A promise of a prepared purchase. Rejections return an error code, and a
+     * userInfo object with more information.
+     */
+    Purchases.preparePurchase = function (aPackage, discount) {
+        return measure("preparePurchase", RNPurchases.preparePurchase(aPackage.identifier, aPackage.offeringIdentifier, discount ? discount.identifier : null));
+    };
+    /**
+     * Purchases a package prepared with preparePurchase, applying its discount if it has one.
+     *
+     * @param {PreparedPurchase} preparedPurchase The prepared purchase. It can't be purchased again after this.
+     * @param {UpgradeInfo} upgradeInfo Android only. Optional UpgradeInfo you wish to upgrade from containing the oldSKU
+     * and the optional prorationMode.
+     * @returns {Promise<{ productIdentifier: string, purchaserInfo: PurchaserInfo }>} A promise of an object containing
+     * a purchaser info object and a product identifier. Rejections return an error code,
+     * a boolean indicating if the user cancelled the purchase, and an object with more information.
+     */
+    Purchases.purchasePreparedPurchase = function (preparedPurchase, upgradeInfo) {
+        return measure("purchasePreparedPurchase", RNPurchases.purchasePreparedPurchase(preparedPurchase.handle, upgradeInfo)).catch(function (error) {
             error.userCancelled = error.code === "1";
             throw error;
         });
     };
+    /**
+     * Releases a prepared purchase that won't be purchased. It can't be purchased after this.
+     *
+     * @param {PreparedPurchase} preparedPurchase The prepared purchase returned by preparePurchase
+     */
+    Purchases.releasePreparedPurchase = function (preparedPurchase) {
+        RNPurchases.releasePreparedPurchase(preparedPurchase.handle);
+    };
     /**
      * Restores a user's previous purchases and links their appUserIDs to any user's also using those purchases.
      * @returns {Promise<PurchaserInfo>} A promise of a purchaser info object. Rejections return an error code, and a userInfo object with more information.
      */
     Purchases.restoreTransactions = function () {
-        return RNPurchases.restoreTransactions();
+        return measure("restoreTransactions", RNPurchases.restoreTransactions().then(decodePayload));
+    };
+    /**
+     * Same as restoreTransactions, but the listener is called as the restore goes through its stages, so a long
+     * restore can show its progress instead of holding the UI until it resolves.
+     * @param {RestoreProgressListener} listener Called with the RestoreProgress of every stage
+     * @returns {Promise<PurchaserInfo>} A promise of a purchaser info object. Rejections return an error code, and a userInfo object with more information.
+     */
+    Purchases.restoreTransactionsWithProgress = function (listener) {
+        if (typeof listener !== "function") {
+            throw new Error("restoreTransactionsWithProgress needs a function");
+        }
+        lastRestoreRequestID += 1;
+        var requestID = lastRestoreRequestID;
+        restoreProgressListeners.set(requestID, listener);
+        setNativeEventSubscribed("Purchases-RestoreProgress", onRestoreProgress, true);
+        var purchaserInfo = measure("restoreTransactionsWithProgress", RNPurchases.restoreTransactionsWithProgress(requestID).then(decodePayload));
+        // the events of a request are all sent before it resolves
+        var removeListener = function () {
+            restoreProgressListeners.delete(requestID);
+            setNativeEventSubscribed("Purchases-RestoreProgress", onRestoreProgress, restoreProgressListeners.size > 0);
+        };
+        purchaserInfo.then(removeListener, removeListener);
+        return purchaserInfo;
     };
     /**
      * Get the appUserID
@@ -348,6 +889,14 @@ var Purchases = /** @class */ (function () {
     Purchases.getAppUserID = function () {
         return RNPurchases.getAppUserID();
     };
+    /**
+     * Get the appUserID synchronously, without waiting on the bridge.
+     * Not available when debugging remotely, use getAppUserID in that case.
+     * @returns {string} The app user id
+     */
+    Purchases.getAppUserIDSync = function () {
+        return RNPurchases.getAppUserIDSync();
+    };
     /**
      * This function will alias two appUserIDs together.
      * @param {String} newAppUserID The new appUserID that should be linked to the currently identified appUserID. Needs to be a string.
@@ -358,10 +907,13 @@ var Purchases = /** @class */ (function () {
         if (typeof newAppUserID !== "string") {
             throw new Error("newAppUserID needs to be a string");
         }
-        return RNPurchases.createAlias(newAppUserID);
+        return changeAppUser(function () { return RNPurchases.createAlias(newAppUserID); }).then(decodePayload);
     };
     /**
-     * This function will identify the current user with an appUserID. Typically this would be used after a logout to identify a new user without calling configure
+     * This function will identify the current user with an appUserID. Typically this would be used after a logout to identify a new user without calling configure.
+     * Switching back to a recently identified user resolves with their last purchaser info, see setUserSnapshotCacheLimit.
+     * The SDK then switches to the user in the background, see addIdentifyFailedListener. Until it has, purchases, restores
+     * and subscriber attributes still go to the previous user: wait for getAppUserID to return the new one before making them.
      * @param {String} newAppUserID The appUserID that should be linked to the currently user
      * @returns {Promise<PurchaserInfo>} A promise of a purchaser info object. Rejections return an error code, and a userInfo object with more information.
      */
@@ -370,14 +922,14 @@ var Purchases = /** @class */ (function () {
         if (typeof newAppUserID !== "string") {
             throw new Error("newAppUserID needs to be a string");
         }
-        return RNPurchases.identify(newAppUserID);
+        return changeAppUser(function () { return RNPurchases.identify(newAppUserID); }).then(decodePayload);
     };
     /**
      * Resets the Purchases client clearing the saved appUserID. This will generate a random user id and save it in the cache.
      * @returns {Promise<PurchaserInfo>} A promise of a purchaser info object. Rejections return an error code, and a userInfo object with more information.
      */
     Purchases.reset = function () {
-        return RNPurchases.reset();
+        return changeAppUser(function () { return RNPurchases.reset(); }).then(decodePayload);
     };
     /**
      * Enables/Disables debugs logs
@@ -388,10 +940,121 @@ var Purchases = /** @class */ (function () {
     };
     /**
      * Gets current purchaser info
+     * @param {GetPurchaserInfoOptions} options Optional options. Set lazy to true to only fetch the larger fields the first
+     * time they're read.
      * @returns {Promise<PurchaserInfo>} A promise of a purchaser info object. Rejections return an error code, and a userInfo object with more information.
      */
-    Purchases.getPurchaserInfo = function () {
-        return RNPurchases.getPurchaserInfo();
+    Purchases.getPurchaserInfo = function (options) {
+        if (options && options.lazy) {
+            return singleFlight("getPurchaserInfo", ["lazy"], function () {
+                return measure("getPurchaserInfoLazy", RNPurchases.getPurchaserInfoLazy()).then(withLazyFields);
+            });
+        }
+        return singleFlight("getPurchaserInfo", [], function () { return measure("getPurchaserInfo", RNPurchases.getPurchaserInfo().then(decodePayload)); });
+    };
+    /**
+     * Gets how many calls to getPurchaserInfo, getOfferings and getProducts were given the result of an identical
+     * call that was already in flight, instead of making a new request.
+     * @returns {CoalescedRequestCounts} The number of coalesced calls by method
+     */
+    Purchases.getCoalescedRequestCounts = function () {
+        return {
+            getPurchaserInfo: coalescedRequestCounts.getPurchaserInfo,
+            getOfferings: coalescedRequestCounts.getOfferings,
+            getProductInfo: coalescedRequestCounts.getProductInfo,
+        };
+    };
+    /**
+     * Enables or disables performance metrics. When enabled, getOfferings, getProducts, getPurchaserInfo, the purchase
+     * methods, restoreTransactions and checkTrialOrIntroductoryPriceEligibility are timed in JS and natively, and the
+     * size of their results is measured. setupPurchases is timed natively. Disabled by default, don't leave it enabled in production.
+     * @param {boolean} enabled Whether performance metrics should be recorded
+     */
+    Purchases.setPerformanceMetricsEnabled = function (enabled) {
+        performanceMetricsEnabled = enabled;
+        setNativeEventSubscribed("Purchases-Metrics", onMetricsSample, enabled);
+        RNPurchases.setPerformanceMetricsEnabled(enabled);
+    };
+    /**
+     * Gets the performance metrics recorded since they were enabled. The time spent on the bridge is roughly
+     * totalMillis minus nativeMillis and resolveMillis.
+     * @returns {PerformanceMetrics} Histograms of the measurements by native method name
+     */
+    Purchases.getPerformanceMetrics = function () {
+        return copyPerformanceMetrics();
+    };
+    /**
+     * Sets a function to be called with the updated performance metrics every time a native call is measured
+     * @param {PerformanceMetricsListener} performanceMetricsListener Performance metrics listener
+     */
+    Purchases.addPerformanceMetricsListener = function (performanceMetricsListener) {
+        if (typeof performanceMetricsListener !== "function") {
+            throw new Error("addPerformanceMetricsListener needs a function");
+        }
+        performanceMetricsListeners.push(performanceMetricsListener);
+    };
+    /**
+     * Removes a given PerformanceMetricsListener
+     * @param {PerformanceMetricsListener} listenerToRemove PerformanceMetricsListener reference of the listener to remove
+     * @returns {boolean} True if listener was removed, false otherwise
+     */
+    Purchases.removePerformanceMetricsListener = function (listenerToRemove) {
+        if (performanceMetricsListeners.includes(listenerToRemove)) {
+            performanceMetricsListeners = performanceMetricsListeners.filter(function (listener) { return listenerToRemove !== listener; });
+            return true;
+        }
+        return false;
+    };
+    /**
+     * Sets how offerings and purchaser info are sent over the bridge. COMPACT avoids repeating every key in large
+     * offerings and transaction histories, and is decoded back into the same objects.
+     * @param {PAYLOAD_ENCODING} encoding The encoding to use, MAP by default
+     */
+    Purchases.setPayloadEncoding = function (encoding) {
+        RNPurchases.setPayloadEncoding(encoding);
+    };
+    /**
+     * Sets which fields of purchaser infos getPurchaserInfo, restoreTransactions and purchaser info listeners get.
+     * SUMMARY keeps bridge messages small for users with long transaction histories, getPurchaserInfo with lazy set to
+     * true still has every field.
+     * @param {PURCHASER_INFO_MODE} mode The mode to use, FULL by default
+     */
+    Purchases.setPurchaserInfoMode = function (mode) {
+        RNPurchases.setPurchaserInfoMode(mode);
+    };
+    /**
+     * Gets a page of the non subscription transactions of the last purchaser info the native SDK received, fetching
+     * the purchaser info first if there isn't one yet for the current app user.
+     * @param {GetTransactionsOptions} options Optional options, with the cursor to start after and the page size
+     * @returns {Promise<PurchasesTransactionsPage>} A promise of a page of transactions. Rejections return an error
+     * code, and a userInfo object with more information, also when the cursor isn't in the purchaser info anymore.
+     */
+    Purchases.getTransactions = function (options) {
+        var limit = options && options.limit !== undefined ? options.limit : DEFAULT_TRANSACTIONS_PAGE_SIZE;
+        if (!(limit >= 1)) {
+            return Promise.reject(new Error("limit needs to be at least 1"));
+        }
+        return measure("getTransactions", RNPurchases.getTransactions((options && options.after) || null, Math.floor(limit)));
+    };
+    /**
+     * Gets the last purchaser info received from the native SDK synchronously, without waiting on the bridge.
+     * Not available when debugging remotely, use getPurchaserInfo in that case.
+     * It's cleared by identify, createAlias and reset until the purchaser info of the new app user is received.
+     * @returns {PurchaserInfo | null} The last received purchaser info, or null if none has been received yet
+     */
+    Purchases.getCachedPurchaserInfoSync = function () {
+        return decodePayload(RNPurchases.getCachedPurchaserInfoSync());
+    };
+    /**
+     * iOS only. Releases a deferred purchase received in a ShouldPurchasePromoProductListener that won't be made.
+     * The deferredPurchase function can't be called after this.
+     * @param {number} callbackID The callbackID the listener was called with
+     */
+    Purchases.releaseDeferredPurchase = function (callbackID) {
+        removePendingDeferredPurchase(callbackID);
+        if (react_native_1.Platform.OS === "ios") {
+            RNPurchases.releaseDeferredPurchase(callbackID);
+        }
     };
     /**
      * This method will send all the purchases to the RevenueCat backend. Call this when using your own implementation
@@ -419,6 +1082,13 @@ var Purchases = /** @class */ (function () {
     Purchases.isAnonymous = function () {
         return RNPurchases.isAnonymous();
     };
+    /**
+     * Same as isAnonymous, but synchronous. Not available when debugging remotely, use isAnonymous in that case.
+     * @returns { boolean } If the `appUserID` has been generated by RevenueCat or not.
+     */
+    Purchases.isAnonymousSync = function () {
+        return RNPurchases.isAnonymousSync();
+    };
     /**
      *  iOS only. Computes whether or not a user is eligible for the introductory pricing period of a given product.
      *  You should use this method to determine whether or not you show the user the normal product price or the
@@ -434,7 +1104,49 @@ var Purchases = /** @class */ (function () {
      *  @returns { Promise<[productId: string]: IntroEligibility> } A map of IntroEligility per productId
      */
     Purchases.checkTrialOrIntroductoryPriceEligibility = function (productIdentifiers) {
-        return RNPurchases.checkTrialOrIntroductoryPriceEligibility(productIdentifiers);
+        var prewarmedEligibility = inFlightRequests.checkTrialOrIntroductoryPriceEligibility;
+        if (prewarmedEligibility) {
+            var checkEligibility = function () { return measure("checkTrialOrIntroductoryPriceEligibility", RNPurchases.checkTrialOrIntroductoryPriceEligibility(productIdentifiers)); };
+            return prewarmedEligibility.then(function (eligibilities) {
+                if (!productIdentifiers.every(function (productIdentifier) { return productIdentifier in eligibilities; })) {
+                    return checkEligibility();
+                }
+                var requestedEligibilities = {};
+                productIdentifiers.forEach(function (productIdentifier) {
+                    requestedEligibilities[productIdentifier] = eligibilities[productIdentifier];
+                });
+                return requestedEligibilities;
+            }, checkEligibility);
+        }
+        return measure("checkTrialOrIntroductoryPriceEligibility", RNPurchases.checkTrialOrIntroductoryPriceEligibility(productIdentifiers));
+    };
+    /**
+     *  iOS only. Same as checkTrialOrIntroductoryPriceEligibility, but the listener is called with the eligibilities as
+     *  they become known: first the ones cached during this session for the current receipt, then the rest once the
+     *  store has checked them, in a single request. Android calls the listener once, with
+     *  INTRO_ELIGIBILITY_STATUS_UNKNOWN for every product.
+     *
+     *  @param productIdentifiers Array of product identifiers for which you want to compute eligibility
+     *  @param listener Called with the IntroEligibility of some of the products, by product identifier
+     *  @returns { Promise<[productId: string]: IntroEligibility> } A map of IntroEligility per productId, once all of
+     *  them are known
+     */
+    Purchases.checkTrialOrIntroductoryPriceEligibilityStreaming = function (productIdentifiers, listener) {
+        if (typeof listener !== "function") {
+            throw new Error("checkTrialOrIntroductoryPriceEligibilityStreaming needs a function");
+        }
+        lastIntroEligibilityRequestID += 1;
+        var requestID = lastIntroEligibilityRequestID;
+        introEligibilityListeners.set(requestID, listener);
+        setNativeEventSubscribed("Purchases-IntroEligibility", onIntroEligibility, true);
+        var eligibilities = measure("checkTrialOrIntroductoryPriceEligibilityStreaming", RNPurchases.checkTrialOrIntroductoryPriceEligibilityStreaming(productIdentifiers, requestID));
+        // the events of a request are all sent before it resolves
+        var removeListener = function () {
+            introEligibilityListeners.delete(requestID);
+            setNativeEventSubscribed("Purchases-IntroEligibility", onIntroEligibility, introEligibilityListeners.size > 0);
+        };
+        eligibilities.then(removeListener, removeListener);
+        return eligibilities;
     };
     /**
      *  iOS only. Use this function to retrieve the `PurchasesPaymentDiscount` for a given `PurchasesPackage`.
@@ -465,6 +1177,48 @@ var Purchases = /** @class */ (function () {
     Purchases.invalidatePurchaserInfoCache = function () {
         RNPurchases.invalidatePurchaserInfoCache();
     };
+    /**
+     * Sets how much memory the purchaser info and offerings of recently identified app users can take natively. When
+     * identify switches back to one of them, it resolves with their last purchaser info right away and revalidates in
+     * the background, listeners get the purchaser info if it changed. 1 MB by default, estimated as JSON.
+     * @param {number} maxBytes Maximum size of the snapshots in bytes, the least recently identified users are dropped
+     * first. 0 disables the snapshots
+     */
+    Purchases.setUserSnapshotCacheLimit = function (maxBytes) {
+        RNPurchases.setUserSnapshotCacheLimit(maxBytes);
+    };
+    /**
+     * Sets how long the products fetched by getProducts and getProductsBatch are cached natively, to be served
+     * without going back to the store. 5 minutes by default.
+     * @param {number} ttlSeconds Time to live of the cached products in seconds, 0 disables the cache
+     */
+    Purchases.setProductCacheTTL = function (ttlSeconds) {
+        RNPurchases.setProductCacheTTL(ttlSeconds);
+    };
+    /**
+     * Removes all the products from the native product cache, so the next getProducts and getProductsBatch calls
+     * fetch them from the store.
+     */
+    Purchases.invalidateProductCache = function () {
+        RNPurchases.invalidateProductCache();
+    };
+    /**
+     * Gets how many product identifiers looked up by getProducts and getProductsBatch were served from the native
+     * product cache, and how many had to be fetched from the store.
+     * @returns {Promise<ProductCacheStats>} A promise of the cache hits and misses since the app started
+     */
+    Purchases.getProductCacheStats = function () {
+        return RNPurchases.getProductCacheStats();
+    };
+    /**
+     * Gets how many subscriber attribute, attribution data and syncPurchases calls are waiting to be sent. Calls made
+     * before setup or while the device is offline are kept on disk and sent together once connectivity returns.
+     * They're also sent before the app user changes, so the SDK keeps them for the user they were made for.
+     * @returns {Promise<number>} A promise of the number of queued operations
+     */
+    Purchases.getQueuedOperationCount = function () {
+        return RNPurchases.getQueuedOperationCount();
+    };
     /**
      * Subscriber attributes are useful for storing additional, structured information on a user.
      * Since attributes are writable using a public key they should not be used for
@@ -478,6 +1232,43 @@ var Purchases = /** @class */ (function () {
     Purchases.setAttributes = function (attributes) {
         RNPurchases.setAttributes(attributes);
     };
+    /**
+     * Sets several subscriber attributes with a single call to the native SDK. Calls made during the same tick are
+     * merged, with later values for the same attribute replacing earlier ones, and sent together.
+     *
+     * @param batch Subscriber attributes to set. Attributes that are not present are left untouched.
+     */
+    Purchases.setAttributesBatch = function (batch) {
+        var isFirstInTick = pendingAttributesBatch === null;
+        var pending = pendingAttributesBatch || {};
+        Object.keys(batch).forEach(function (key) {
+            var value = batch[key];
+            if (typeof value === "undefined") {
+                return;
+            }
+            if (key === "attributes") {
+                // nothing to merge, attributes are removed with a null value for their key instead
+                if (value === null) {
+                    return;
+                }
+                var attributes_1 = pending.attributes || {};
+                Object.keys(value).forEach(function (name) {
+                    attributes_1[name] = value[name];
+                });
+                pending.attributes = attributes_1;
+            }
+            else if (key === "collectDeviceIdentifiers") {
+                pending.collectDeviceIdentifiers = pending.collectDeviceIdentifiers || value;
+            }
+            else {
+                pending[key] = value;
+            }
+        });
+        pendingAttributesBatch = pending;
+        if (isFirstInTick) {
+            Promise.resolve().then(flushAttributesBatch);
+        }
+    };
     /**
      * Subscriber attribute associated with the email address for the user
      *
@@ -654,6 +1445,30 @@ var Purchases = /** @class */ (function () {
      * @enum {number}
      */
     Purchases.INTRO_ELIGIBILITY_STATUS = INTRO_ELIGIBILITY_STATUS;
+    /**
+     * Cache policies that can be used when getting offerings.
+     * @readonly
+     * @enum {string}
+     */
+    Purchases.OFFERINGS_CACHE_POLICY = OFFERINGS_CACHE_POLICY;
+    /**
+     * Encodings that can be used to send offerings and purchaser info over the bridge.
+     * @readonly
+     * @enum {string}
+     */
+    Purchases.PAYLOAD_ENCODING = PAYLOAD_ENCODING;
+    /**
+     * Modes that can be used to send purchaser infos over the bridge.
+     * @readonly
+     * @enum {string}
+     */
+    Purchases.PURCHASER_INFO_MODE = PURCHASER_INFO_MODE;
+    /**
+     * Stages reported by restoreTransactionsWithProgress.
+     * @readonly
+     * @enum {string}
+     */
+    Purchases.RESTORE_PROGRESS_STAGE = RESTORE_PROGRESS_STAGE;
     return Purchases;
 }());
 exports.default = Purchases;
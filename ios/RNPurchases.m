@@ -6,28 +6,424 @@
 
 #import "RNPurchases.h"
 
+#if __has_include("RCTUtils.h")
+#import "RCTUtils.h"
+#else
+#import <React/RCTUtils.h>
+#endif
+
 @import StoreKit;
+@import SystemConfiguration;
+@import UIKit;
+
+#import <CommonCrypto/CommonDigest.h>
+#import <netinet/in.h>
+
+// Signposts show the native calls in Instruments. They're only compiled into debug builds, add
+// RNPURCHASES_SIGNPOSTS_ENABLED=1 to the preprocessor macros to profile a release build.
+#ifndef RNPURCHASES_SIGNPOSTS_ENABLED
+#if DEBUG
+#define RNPURCHASES_SIGNPOSTS_ENABLED 1
+#else
+#define RNPURCHASES_SIGNPOSTS_ENABLED 0
+#endif
+#endif
+
+#if RNPURCHASES_SIGNPOSTS_ENABLED
+#import <os/signpost.h>
+
+typedef struct {
+    uint64_t signpostID;
+    const char *name;
+} RNPurchasesSignpostInterval;
+
+static os_log_t RNPurchasesSignpostLog(void) API_AVAILABLE(ios(12.0)) {
+    static os_log_t log;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        log = os_log_create("com.revenuecat.purchases.react", "RNPurchases");
+    });
+    return log;
+}
+
+static RNPurchasesSignpostInterval RNPurchasesSignpostBegin(const char *name) {
+    RNPurchasesSignpostInterval interval = {0, name};
+    if (@available(iOS 12.0, *)) {
+        interval.signpostID = os_signpost_id_generate(RNPurchasesSignpostLog());
+        os_signpost_interval_begin(RNPurchasesSignpostLog(), interval.signpostID, "RNPurchases", "%{public}s", name);
+    }
+    return interval;
+}
+
+static void RNPurchasesSignpostEnd(RNPurchasesSignpostInterval *interval) {
+    if (@available(iOS 12.0, *)) {
+        os_signpost_interval_end(RNPurchasesSignpostLog(), interval->signpostID, "RNPurchases", "%{public}s", interval->name);
+    }
+}
+
+// The interval ends when the enclosing scope exits, early returns included
+#define RNPURCHASES_SIGNPOST_SCOPE(name) \
+    __attribute__((cleanup(RNPurchasesSignpostEnd), unused)) RNPurchasesSignpostInterval _signpostInterval = RNPurchasesSignpostBegin(name)
+#else
+#define RNPURCHASES_SIGNPOST_SCOPE(name)
+#endif
 
 
 @interface RNPurchases () <RCPurchasesDelegate>
 
-@property(nonatomic, retain) NSMutableArray<RCDeferredPromotionalPurchaseBlock> *defermentBlocks;
+@property(nonatomic, retain) NSMutableDictionary<NSNumber *, RCDeferredPromotionalPurchaseBlock> *defermentBlocks;
+@property(nonatomic) NSInteger lastDefermentBlockID;
+@property(nonatomic, retain) NSMutableDictionary<NSNumber *, NSDictionary *> *preparedPurchases;
+@property(nonatomic) NSInteger lastPreparedPurchaseHandle;
+@property(atomic, copy, nullable) NSDictionary *lastPurchaserInfo;
+// The app user lastPurchaserInfo belongs to, only touched on the methodQueue
+@property(nonatomic, copy, nullable) NSString *lastPurchaserInfoAppUserID;
+@property(atomic, copy, nullable) NSDictionary *lastOfferings;
+// The offerings snapshot on disk, only read from the file the first time. Only touched on the methodQueue
+@property(nonatomic, copy, nullable) NSDictionary *offeringsSnapshot;
+@property(nonatomic, copy, nullable) NSDictionary *lastEmittedPurchaserInfo;
+@property(nonatomic, retain) NSMutableDictionary<NSString *, NSMutableArray<NSArray *> *> *pendingPromises;
+@property(nonatomic, retain) NSMutableDictionary<NSNumber *, NSDictionary *> *lazyPurchaserInfos;
+@property(nonatomic) NSInteger lastLazyPurchaserInfoHandle;
+@property(atomic) BOOL performanceMetricsEnabled;
+@property(atomic) BOOL compactPayloads;
+@property(atomic) BOOL summaryPurchaserInfos;
+@property(nonatomic, retain) NSMutableDictionary<NSString *, NSDictionary *> *productCache;
+@property(nonatomic, copy, nullable) NSNumber *productCacheTTL;
+@property(nonatomic) NSUInteger productCacheHits;
+@property(nonatomic) NSUInteger productCacheMisses;
+// Only touched on the methodQueue, same as the reachability callbacks
+@property(nonatomic, nullable) SCNetworkReachabilityRef reachability;
+@property(nonatomic) BOOL reachable;
+// Set once setupPurchases configured the SDK, RCCommonFunctionality can't be used before
+@property(nonatomic) BOOL configured;
+@property(nonatomic, copy, nullable) NSNumber *queuedOperationCount;
+@property(nonatomic, retain, nullable) NSMutableDictionary<NSString *, NSDictionary *> *introEligibilityCache;
+@property(nonatomic, copy, nullable) NSString *introEligibilityReceiptFingerprint;
+// Only touched on the methodQueue. userSnapshotOrder has the least recently used app user first
+@property(nonatomic, retain, nullable) NSMutableDictionary<NSString *, NSDictionary *> *userSnapshots;
+@property(nonatomic, retain, nullable) NSMutableArray<NSString *> *userSnapshotOrder;
+@property(nonatomic) NSUInteger userSnapshotBytes;
+@property(nonatomic, copy, nullable) NSNumber *userSnapshotLimit;
+// Set on the methodQueue by startObserving and stopObserving, nothing is serialized for JS while it's NO
+@property(atomic) BOOL hasListeners;
+// Set on the methodQueue by setEventObserved, events JS doesn't listen to aren't converted or sent
+@property(atomic, copy, nullable) NSSet<NSString *> *observedEvents;
+// Only touched on the methodQueue. While in the background only the latest payload of each event is kept
+@property(nonatomic) BOOL inBackground;
+@property(nonatomic, retain, nullable) NSMutableDictionary<NSString *, NSDictionary *> *pendingEvents;
+
+- (void)reachabilityDidChangeWithFlags:(SCNetworkReachabilityFlags)flags;
 
 @end
 
 NSString *RNPurchasesPurchaserInfoUpdatedEvent = @"Purchases-PurchaserInfoUpdated";
 NSString *RNPurchasesShouldPurchasePromoProductEvent = @"Purchases-ShouldPurchasePromoProduct";
+NSString *RNPurchasesOfferingsUpdatedEvent = @"Purchases-OfferingsUpdated";
+NSString *RNPurchasesMetricsEvent = @"Purchases-Metrics";
+NSString *RNPurchasesIntroEligibilityEvent = @"Purchases-IntroEligibility";
+NSString *RNPurchasesRestoreProgressEvent = @"Purchases-RestoreProgress";
+NSString *RNPurchasesIdentifyFailedEvent = @"Purchases-IdentifyFailed";
+
+// Bump when the format of the persisted offerings snapshot changes, older snapshots are ignored
+static NSInteger const RNPurchasesOfferingsSnapshotVersion = 1;
+
+// Deferment blocks hold on to the StoreKit payment, unused ones are dropped after a while or when there are too many
+static NSTimeInterval const RNPurchasesDefermentBlockTTL = 60 * 60;
+static NSInteger const RNPurchasesMaxDefermentBlocks = 32;
+
+// Prepared purchases can carry a signed discount for the current app user, unused ones are dropped after a while,
+// when there are too many, or when the app user changes
+static NSTimeInterval const RNPurchasesPreparedPurchaseTTL = 10 * 60;
+static NSInteger const RNPurchasesMaxPreparedPurchases = 8;
+
+// Purchaser infos from getPurchaserInfoLazy kept around for getPurchaserInfoField, the oldest ones are dropped
+static NSInteger const RNPurchasesMaxLazyPurchaserInfos = 16;
+
+// How long products are served from productCache unless setProductCacheTTL is called, 0 or less disables it
+static NSTimeInterval const RNPurchasesDefaultProductCacheTTL = 5 * 60;
+
+// How many bytes of purchaser info and offerings, estimated as JSON, are kept for recently identified app users unless
+// setUserSnapshotCacheLimit is called
+static NSUInteger const RNPurchasesDefaultUserSnapshotLimit = 1024 * 1024;
+
+// INTRO_ELIGIBILITY_STATUS_UNKNOWN, which isn't cached since it can change once the SDK has more information
+static NSInteger const RNPurchasesIntroEligibilityStatusUnknown = 0;
+
+static double RNPurchasesNowMillis(void) {
+    return NSDate.date.timeIntervalSince1970 * 1000;
+}
+
+static NSString *RNPurchasesSHA256String(NSData *data) {
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(data.bytes, (CC_LONG)data.length, digest);
+    NSMutableString *string = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+        [string appendFormat:@"%02x", digest[i]];
+    }
+    return string;
+}
+
+// Dates get epoch millis next to them as <date key>Millis, so JS can compare numbers instead of parsing strings
+static NSNumber *_Nullable RNPurchasesMillisFromISO8601String(NSString *dateString) {
+    static NSArray<NSDateFormatter *> *formatters;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableArray<NSDateFormatter *> *dateFormatters = [NSMutableArray array];
+        for (NSString *dateFormat in @[@"yyyy-MM-dd'T'HH:mm:ssXXXXX", @"yyyy-MM-dd'T'HH:mm:ss.SSSXXXXX"]) {
+            NSDateFormatter *formatter = [[NSDateFormatter alloc] init];
+            formatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+            formatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+            formatter.dateFormat = dateFormat;
+            [dateFormatters addObject:formatter];
+        }
+        formatters = dateFormatters;
+    });
+    for (NSDateFormatter *formatter in formatters) {
+        NSDate *date = [formatter dateFromString:dateString];
+        if (date) {
+            return @(date.timeIntervalSince1970 * 1000);
+        }
+    }
+    return nil;
+}
+
+static void RNPurchasesAddDateMillis(NSMutableDictionary *dictionary, NSArray<NSString *> *dateKeys) {
+    for (NSString *key in dateKeys) {
+        NSString *millisKey = [key stringByAppendingString:@"Millis"];
+        id date = dictionary[key];
+        if (!date || dictionary[millisKey]) {
+            continue;
+        }
+        if ([date isKindOfClass:NSString.class]) {
+            // unparsable dates get no millis, JS falls back to parsing the string
+            dictionary[millisKey] = RNPurchasesMillisFromISO8601String(date);
+        } else {
+            dictionary[millisKey] = NSNull.null;
+        }
+    }
+}
+
+static NSDictionary *RNPurchasesPurchaserInfoWithDateMillis(NSDictionary *purchaserInfo) {
+    NSMutableDictionary *result = [purchaserInfo mutableCopy];
+    RNPurchasesAddDateMillis(result, @[@"latestExpirationDate", @"firstSeen", @"originalPurchaseDate", @"requestDate"]);
+    NSDictionary *entitlements = purchaserInfo[@"entitlements"];
+    if (![entitlements isKindOfClass:NSDictionary.class]) {
+        return result;
+    }
+    NSArray<NSString *> *entitlementDateKeys = @[@"latestPurchaseDate", @"originalPurchaseDate", @"expirationDate",
+                                                 @"unsubscribeDetectedAt", @"billingIssueDetectedAt"];
+    NSMutableDictionary *resultEntitlements = [entitlements mutableCopy];
+    [entitlements enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSDictionary *entitlementInfos, BOOL *stop) {
+        if (![entitlementInfos isKindOfClass:NSDictionary.class]) {
+            return;
+        }
+        NSMutableDictionary *resultEntitlementInfos = [NSMutableDictionary dictionaryWithCapacity:entitlementInfos.count];
+        [entitlementInfos enumerateKeysAndObjectsUsingBlock:^(NSString *identifier, NSDictionary *entitlementInfo, BOOL *stopInfos) {
+            if ([entitlementInfo isKindOfClass:NSDictionary.class]) {
+                NSMutableDictionary *resultEntitlementInfo = [entitlementInfo mutableCopy];
+                RNPurchasesAddDateMillis(resultEntitlementInfo, entitlementDateKeys);
+                resultEntitlementInfos[identifier] = resultEntitlementInfo;
+            } else {
+                resultEntitlementInfos[identifier] = entitlementInfo;
+            }
+        }];
+        resultEntitlements[key] = resultEntitlementInfos;
+    }];
+    result[@"entitlements"] = resultEntitlements;
+    return result;
+}
+
+// PURCHASER_INFO_MODE.SUMMARY sends the fields that grow with every purchase empty, JS pages the transactions with
+// getTransactions
+static NSDictionary *RNPurchasesPurchaserInfoSummary(NSDictionary *purchaserInfo) {
+    NSMutableDictionary *summary = [purchaserInfo mutableCopy];
+    for (NSString *key in @[@"allExpirationDates", @"allExpirationDatesMillis", @"allPurchaseDates", @"allPurchaseDatesMillis"]) {
+        if (summary[key]) {
+            summary[key] = @{};
+        }
+    }
+    NSArray *transactions = purchaserInfo[@"nonSubscriptionTransactions"];
+    summary[@"nonSubscriptionTransactions"] = @[];
+    summary[@"nonSubscriptionTransactionCount"] = @([transactions isKindOfClass:NSArray.class] ? transactions.count : 0);
+    summary[@"isSummary"] = @YES;
+    return summary;
+}
+
+// Purchase results have the purchaser info under purchaserInfo, offerings and other results are returned as they are
+static NSDictionary *RNPurchasesResultWithDateMillis(NSDictionary *result) {
+    if ([result[@"entitlements"] isKindOfClass:NSDictionary.class]) {
+        return RNPurchasesPurchaserInfoWithDateMillis(result);
+    }
+    NSDictionary *purchaserInfo = result[@"purchaserInfo"];
+    if ([purchaserInfo isKindOfClass:NSDictionary.class]) {
+        NSMutableDictionary *resultWithDateMillis = [result mutableCopy];
+        resultWithDateMillis[@"purchaserInfo"] = RNPurchasesPurchaserInfoWithDateMillis(purchaserInfo);
+        return resultWithDateMillis;
+    }
+    return result;
+}
+
+// PAYLOAD_ENCODING.COMPACT interns every key: dictionaries become @[@0, keyIndex, value, ...] and arrays
+// @[@1, value, ...], with each key sent once in compactKeys. Decoded in JS by decodePayload
+static id RNPurchasesCompactValue(id value, NSMutableDictionary<NSString *, NSNumber *> *keyIndexes, NSMutableArray<NSString *> *keys) {
+    if ([value isKindOfClass:NSDictionary.class]) {
+        NSDictionary *dictionary = value;
+        NSMutableArray *compactDictionary = [NSMutableArray arrayWithCapacity:dictionary.count * 2 + 1];
+        [compactDictionary addObject:@0];
+        [dictionary enumerateKeysAndObjectsUsingBlock:^(NSString *key, id object, BOOL *stop) {
+            NSNumber *keyIndex = keyIndexes[key];
+            if (!keyIndex) {
+                keyIndex = @(keys.count);
+                keyIndexes[key] = keyIndex;
+                [keys addObject:key];
+            }
+            [compactDictionary addObject:keyIndex];
+            [compactDictionary addObject:RNPurchasesCompactValue(object, keyIndexes, keys)];
+        }];
+        return compactDictionary;
+    }
+    if ([value isKindOfClass:NSArray.class]) {
+        NSArray *array = value;
+        NSMutableArray *compactArray = [NSMutableArray arrayWithCapacity:array.count + 1];
+        [compactArray addObject:@1];
+        for (id object in array) {
+            [compactArray addObject:RNPurchasesCompactValue(object, keyIndexes, keys)];
+        }
+        return compactArray;
+    }
+    return value;
+}
+
+// Roughly the length of the value as JSON, without serializing it: escapes and number formatting are ignored
+static NSUInteger RNPurchasesEstimatedJSONLength(id value) {
+    if ([value isKindOfClass:NSDictionary.class]) {
+        __block NSUInteger length = 1;
+        [(NSDictionary *)value enumerateKeysAndObjectsUsingBlock:^(id key, id object, BOOL *stop) {
+            length += [key description].length + 4 + RNPurchasesEstimatedJSONLength(object);
+        }];
+        return length;
+    }
+    if ([value isKindOfClass:NSArray.class]) {
+        NSUInteger length = 1;
+        for (id object in (NSArray *)value) {
+            length += RNPurchasesEstimatedJSONLength(object) + 1;
+        }
+        return length;
+    }
+    if ([value isKindOfClass:NSString.class]) {
+        return [(NSString *)value length] + 2;
+    }
+    if (!value || value == [NSNull null]) {
+        return 4;
+    }
+    return [value description].length;
+}
+
+// The module stops monitoring in dealloc, so it's not retained by the reachability
+static void RNPurchasesReachabilityCallback(SCNetworkReachabilityRef target, SCNetworkReachabilityFlags flags, void *info) {
+    [(__bridge RNPurchases *)info reachabilityDidChangeWithFlags:flags];
+}
 
 @implementation RNPurchases
 
+- (void)dealloc
+{
+    [NSNotificationCenter.defaultCenter removeObserver:self];
+    if (_reachability) {
+        SCNetworkReachabilitySetCallback(_reachability, NULL, NULL);
+        SCNetworkReachabilitySetDispatchQueue(_reachability, NULL);
+        CFRelease(_reachability);
+    }
+}
+
+// Nothing is set up in init and there are no constants, so the module can be created off the main thread, when
+// JS first uses it
++ (BOOL)requiresMainQueueSetup
+{
+    return NO;
+}
+
 - (dispatch_queue_t)methodQueue
 {
-    return dispatch_get_main_queue();
+    static dispatch_queue_t methodQueue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        methodQueue = dispatch_queue_create("com.revenuecat.purchases.react.RNPurchases", DISPATCH_QUEUE_SERIAL);
+    });
+    return methodQueue;
 }
 
 - (NSArray<NSString *> *)supportedEvents
 {
-    return @[RNPurchasesPurchaserInfoUpdatedEvent, RNPurchasesShouldPurchasePromoProductEvent];
+    return @[RNPurchasesPurchaserInfoUpdatedEvent,
+             RNPurchasesShouldPurchasePromoProductEvent,
+             RNPurchasesOfferingsUpdatedEvent,
+             RNPurchasesMetricsEvent,
+             RNPurchasesIntroEligibilityEvent,
+             RNPurchasesRestoreProgressEvent,
+             RNPurchasesIdentifyFailedEvent];
+}
+
+// Called on the methodQueue when JS adds its first listener and removes its last one
+- (void)startObserving
+{
+    self.hasListeners = YES;
+    NSNotificationCenter *notificationCenter = NSNotificationCenter.defaultCenter;
+    [notificationCenter addObserver:self
+                           selector:@selector(applicationDidEnterBackground)
+                               name:UIApplicationDidEnterBackgroundNotification
+                             object:nil];
+    [notificationCenter addObserver:self
+                           selector:@selector(applicationWillEnterForeground)
+                               name:UIApplicationWillEnterForegroundNotification
+                             object:nil];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        BOOL inBackground = UIApplication.sharedApplication.applicationState == UIApplicationStateBackground;
+        dispatch_async(self.methodQueue, ^{
+            self.inBackground = inBackground;
+        });
+    });
+}
+
+- (void)stopObserving
+{
+    self.hasListeners = NO;
+    [NSNotificationCenter.defaultCenter removeObserver:self
+                                                  name:UIApplicationDidEnterBackgroundNotification
+                                                object:nil];
+    [NSNotificationCenter.defaultCenter removeObserver:self
+                                                  name:UIApplicationWillEnterForegroundNotification
+                                                object:nil];
+    self.pendingEvents = nil;
+    // the next listener gets the purchaser info it missed
+    self.lastEmittedPurchaserInfo = nil;
+}
+
+- (BOOL)isObservingEvent:(NSString *)eventName
+{
+    return self.hasListeners && [self.observedEvents containsObject:eventName];
+}
+
+- (void)applicationDidEnterBackground
+{
+    dispatch_async(self.methodQueue, ^{
+        self.inBackground = YES;
+    });
+}
+
+- (void)applicationWillEnterForeground
+{
+    dispatch_async(self.methodQueue, ^{
+        self.inBackground = NO;
+        NSDictionary<NSString *, NSDictionary *> *pendingEvents = self.pendingEvents;
+        self.pendingEvents = nil;
+        for (NSString *eventName in self.supportedEvents) {
+            if (pendingEvents[eventName]) {
+                [self sendLatestEventWithName:eventName dictionary:pendingEvents[eventName]];
+            }
+        }
+    });
 }
 
 RCT_EXPORT_MODULE();
@@ -39,24 +435,41 @@ RCT_EXPORT_METHOD(setupPurchases:(NSString *)apiKey
                   resolve:(RCTPromiseResolveBlock)resolve
                   reject:(RCTPromiseRejectBlock)reject)
 {
-    [RCPurchases configureWithAPIKey:apiKey
-                           appUserID:appUserID
-                        observerMode:observerMode
-               userDefaultsSuiteName:userDefaultsSuiteName
-                      platformFlavor:self.platformFlavor
-               platformFlavorVersion:self.platformFlavorVersion];
-    RCPurchases.sharedPurchases.delegate = self;
-    [RCCommonFunctionality configure];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"setupPurchases"];
+    // The SDK adds its StoreKit transaction observer while configuring, which is done from the main queue. methodQueue
+    // waits for it, so the calls JS makes without awaiting setup find the SDK configured
+    double mainThreadStart = RNPurchasesNowMillis();
+    RCTUnsafeExecuteOnMainQueueSync(^{
+        RNPURCHASES_SIGNPOST_SCOPE("main queue");
+        [RCPurchases configureWithAPIKey:apiKey
+                               appUserID:appUserID
+                            observerMode:observerMode
+                   userDefaultsSuiteName:userDefaultsSuiteName
+                          platformFlavor:self.platformFlavor
+                   platformFlavorVersion:self.platformFlavorVersion];
+        RCPurchases.sharedPurchases.delegate = self;
+        [RCCommonFunctionality configure];
+    });
+    self.configured = YES;
+    metrics[@"mainThreadMillis"] = @(RNPurchasesNowMillis() - mainThreadStart);
+    metrics[@"sdkCompletion"] = @(RNPurchasesNowMillis());
+    // the operations queued while offline are replayed once connectivity returns, or right away if online
+    [self startMonitoringReachability];
+    [self flushOperationQueue];
     resolve(nil);
+    [self sendMetrics:metrics result:nil];
 }
 
 RCT_EXPORT_METHOD(setAllowSharingStoreAccount:(BOOL)allowSharingStoreAccount)
 {
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
     [RCCommonFunctionality setAllowSharingStoreAccount:allowSharingStoreAccount];
 }
 
 RCT_EXPORT_METHOD(setFinishTransactions:(BOOL)finishTransactions)
 {
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
     [RCCommonFunctionality setFinishTransactions:finishTransactions];
 }
 
@@ -64,14 +477,63 @@ RCT_EXPORT_METHOD(addAttributionData:(NSDictionary *)data
                   forNetwork:(NSInteger)network
                   forNetworkUserId:(nullable NSString *)networkUserId)
 {
-    [RCCommonFunctionality addAttributionData:data network:network networkUserId:networkUserId];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSDictionary *operation = @{
+        @"type": @"attribution",
+        @"payload": @{@"data": data, @"network": @(network), @"networkUserId": networkUserId ?: NSNull.null}
+    };
+    if (![self submitQueuedOperation:operation]) {
+        [RCCommonFunctionality addAttributionData:data network:network networkUserId:networkUserId];
+    }
 }
 
 RCT_REMAP_METHOD(getOfferings,
                  getOfferingsWithResolve:(RCTPromiseResolveBlock)resolve
                  reject:(RCTPromiseRejectBlock)reject)
 {
-    [RCCommonFunctionality getOfferingsWithCompletionBlock:[self getResponseCompletionBlockWithResolve:resolve reject:reject]];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"getOfferings"];
+    // keyed by app user, so a request made after the user changed doesn't get the previous user's result
+    NSString *requestKey = [@"getOfferings:" stringByAppendingString:[RCCommonFunctionality appUserID] ?: @""];
+    if (![self addPendingPromiseForRequestKey:requestKey resolve:resolve reject:reject]) {
+        return;
+    }
+    [RCCommonFunctionality getOfferingsWithCompletionBlock:[self getResponseCompletionBlockWithResolve:[self payloadResolveBlockWithResolve:[self pendingResolveForRequestKey:requestKey]]
+                                                                                                 reject:[self pendingRejectForRequestKey:requestKey]
+                                                                                              onSuccess:^(NSDictionary *offerings) {
+        [self didReceiveOfferings:offerings];
+    }
+                                                                                                metrics:metrics]];
+}
+
+RCT_REMAP_METHOD(getOfferingsStaleWhileRevalidate,
+                 getOfferingsStaleWhileRevalidateWithResolve:(RCTPromiseResolveBlock)resolve
+                 reject:(RCTPromiseRejectBlock)reject)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSString *appUserID = [RCCommonFunctionality appUserID];
+    NSDictionary *snapshot = appUserID
+        ? [self userSnapshotForAppUserID:appUserID][@"offerings"] ?: [self offeringsSnapshotForAppUserID:appUserID]
+        : nil;
+    if (snapshot) {
+        resolve([self payloadWithDictionary:snapshot]);
+    }
+    [RCCommonFunctionality getOfferingsWithCompletionBlock:^(NSDictionary *_Nullable offerings, RCErrorContainer *_Nullable error) {
+        dispatch_async(self.methodQueue, ^{
+            if (offerings) {
+                [self didReceiveOfferings:offerings];
+            }
+            if (snapshot) {
+                // already resolved with the snapshot, listeners get the refreshed offerings
+                return;
+            }
+            if (error) {
+                reject([NSString stringWithFormat: @"%ld", (long)error.code], error.message, error.error);
+            } else {
+                resolve([self payloadWithDictionary:offerings]);
+            }
+        });
+    }];
 }
 
 RCT_EXPORT_METHOD(getProductInfo:(NSArray *)products
@@ -79,11 +541,87 @@ RCT_EXPORT_METHOD(getProductInfo:(NSArray *)products
                   resolve:(RCTPromiseResolveBlock)resolve
                   reject:(RCTPromiseRejectBlock)reject)
 {
-    [RCCommonFunctionality getProductInfo:products completionBlock:^(NSArray<NSDictionary *> *productObjects) {
-        resolve(productObjects);
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"getProductInfo"];
+    NSMutableArray<NSDictionary *> *cachedProducts = [NSMutableArray array];
+    NSArray<NSString *> *uncachedIdentifiers = [self uncachedProductIdentifiers:products cachedProducts:cachedProducts];
+    if (uncachedIdentifiers.count == 0) {
+        metrics[@"sdkCompletion"] = @(RNPurchasesNowMillis());
+        NSArray<NSDictionary *> *result = [self productsWithIdentifiers:products fromProducts:cachedProducts];
+        resolve(result);
+        [self sendMetrics:metrics result:result];
+        return;
+    }
+    NSString *requestKey = [NSString stringWithFormat:@"getProductInfo:%@:%@", type, [products componentsJoinedByString:@","]];
+    if (![self addPendingPromiseForRequestKey:requestKey resolve:resolve reject:reject]) {
+        return;
+    }
+    RCTPromiseResolveBlock pendingResolve = [self pendingResolveForRequestKey:requestKey];
+    [RCCommonFunctionality getProductInfo:uncachedIdentifiers completionBlock:^(NSArray<NSDictionary *> *productObjects) {
+        metrics[@"sdkCompletion"] = @(RNPurchasesNowMillis());
+        dispatch_async(self.methodQueue, ^{
+            [self cacheProducts:productObjects];
+            NSArray<NSDictionary *> *result = productObjects;
+            if (cachedProducts.count > 0) {
+                result = [self productsWithIdentifiers:products
+                                          fromProducts:[cachedProducts arrayByAddingObjectsFromArray:productObjects]];
+            }
+            pendingResolve(result);
+            [self sendMetrics:metrics result:result];
+        });
+    }];
+}
+
+RCT_EXPORT_METHOD(getProductInfoBatch:(NSArray *)products
+                  types:(NSArray *)types
+                  resolve:(RCTPromiseResolveBlock)resolve
+                  reject:(RCTPromiseRejectBlock)reject)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"getProductInfoBatch"];
+    // StoreKit has no product types nor a limit on the identifiers of a request, so everything goes in a single one
+    NSArray<NSString *> *identifiers = [NSOrderedSet orderedSetWithArray:products].array;
+    NSMutableArray<NSDictionary *> *cachedProducts = [NSMutableArray array];
+    NSArray<NSString *> *uncachedIdentifiers = [self uncachedProductIdentifiers:identifiers cachedProducts:cachedProducts];
+    if (uncachedIdentifiers.count == 0) {
+        metrics[@"sdkCompletion"] = @(RNPurchasesNowMillis());
+        NSArray<NSDictionary *> *result = [self productsWithIdentifiers:identifiers fromProducts:cachedProducts];
+        resolve(result);
+        [self sendMetrics:metrics result:result];
+        return;
+    }
+    [RCCommonFunctionality getProductInfo:uncachedIdentifiers completionBlock:^(NSArray<NSDictionary *> *productObjects) {
+        metrics[@"sdkCompletion"] = @(RNPurchasesNowMillis());
+        dispatch_async(self.methodQueue, ^{
+            [self cacheProducts:productObjects];
+            NSArray<NSDictionary *> *result = [self productsWithIdentifiers:identifiers
+                                                               fromProducts:[cachedProducts arrayByAddingObjectsFromArray:productObjects]];
+            resolve(result);
+            [self sendMetrics:metrics result:result];
+        });
     }];
 }
 
+RCT_EXPORT_METHOD(setProductCacheTTL:(double)ttlSeconds)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    self.productCacheTTL = @(ttlSeconds);
+}
+
+RCT_EXPORT_METHOD(invalidateProductCache)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self.productCache removeAllObjects];
+}
+
+RCT_REMAP_METHOD(getProductCacheStats,
+                 getProductCacheStatsWithResolve:(RCTPromiseResolveBlock)resolve
+                 reject:(RCTPromiseRejectBlock)reject)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    resolve(@{@"hits": @(self.productCacheHits), @"misses": @(self.productCacheMisses)});
+}
+
 RCT_REMAP_METHOD(purchaseProduct,
                  purchaseProduct:(NSString *)productIdentifier
                  upgradeInfo:(NSDictionary *)upgradeInfo
@@ -92,9 +630,19 @@ RCT_REMAP_METHOD(purchaseProduct,
                  resolve:(RCTPromiseResolveBlock)resolve
                  reject:(RCTPromiseRejectBlock)reject)
 {
-    [RCCommonFunctionality purchaseProduct:productIdentifier
-                   signedDiscountTimestamp:signedDiscountTimestamp
-                           completionBlock:[self getResponseCompletionBlockWithResolve:resolve reject:reject]];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"purchaseProduct"];
+    // StoreKit payments are started from the main queue, everything else stays on methodQueue
+    [self runOnMainQueue:^{
+        [RCCommonFunctionality purchaseProduct:productIdentifier
+                       signedDiscountTimestamp:signedDiscountTimestamp
+                               completionBlock:[self getResponseCompletionBlockWithResolve:resolve
+                                                                                    reject:reject
+                                                                                 onSuccess:nil
+                                                                                   metrics:metrics]];
+    }
+                 metrics:metrics
+              completion:nil];
 }
 
 
@@ -106,59 +654,314 @@ RCT_REMAP_METHOD(purchasePackage,
                  resolve:(RCTPromiseResolveBlock)resolve
                  reject:(RCTPromiseRejectBlock)reject)
 {
-    [RCCommonFunctionality purchasePackage:packageIdentifier
-                                  offering:offeringIdentifier
-                   signedDiscountTimestamp:signedDiscountTimestamp
-                           completionBlock:[self getResponseCompletionBlockWithResolve:resolve reject:reject]];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"purchasePackage"];
+    [self runOnMainQueue:^{
+        [RCCommonFunctionality purchasePackage:packageIdentifier
+                                      offering:offeringIdentifier
+                       signedDiscountTimestamp:signedDiscountTimestamp
+                               completionBlock:[self getResponseCompletionBlockWithResolve:resolve
+                                                                                    reject:reject
+                                                                                 onSuccess:nil
+                                                                                   metrics:metrics]];
+    }
+                 metrics:metrics
+              completion:nil];
+}
+
+RCT_REMAP_METHOD(preparePurchase,
+                 preparePurchase:(NSString *)packageIdentifier
+                 offeringIdentifier:(NSString *)offeringIdentifier
+                 discountIdentifier:(nullable NSString *)discountIdentifier
+                 resolve:(RCTPromiseResolveBlock)resolve
+                 reject:(RCTPromiseRejectBlock)reject)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"preparePurchase"];
+    // The SDK keeps the offerings and their SKProducts once fetched, so the purchase finds them without a request
+    [RCCommonFunctionality getOfferingsWithCompletionBlock:[self getResponseCompletionBlockWithResolve:^(NSDictionary *offerings) {
+        NSString *productIdentifier = [self productIdentifierForPackage:packageIdentifier
+                                                               offering:offeringIdentifier
+                                                              offerings:offerings];
+        if (!productIdentifier) {
+            NSString *message = [NSString stringWithFormat:@"Couldn't find package %@ in offering %@", packageIdentifier, offeringIdentifier];
+            [self rejectPromiseWithBlock:reject error:[NSError errorWithDomain:RCPurchasesErrorDomain
+                                                                          code:RCProductNotAvailableForPurchaseError
+                                                                      userInfo:@{NSLocalizedDescriptionKey: message}]];
+            [self sendMetrics:metrics result:nil];
+            return;
+        }
+        NSMutableDictionary *preparedPurchase = [@{
+            @"packageIdentifier": packageIdentifier,
+            @"offeringIdentifier": offeringIdentifier,
+            @"productIdentifier": productIdentifier,
+        } mutableCopy];
+        if (!discountIdentifier) {
+            metrics[@"sdkCompletion"] = @(RNPurchasesNowMillis());
+            NSDictionary *result = [self addPreparedPurchase:preparedPurchase];
+            resolve(result);
+            [self sendMetrics:metrics result:result];
+            return;
+        }
+        // Signing the discount is a request to the backend, the result is what getPaymentDiscount resolves with
+        [RCCommonFunctionality paymentDiscountForProductIdentifier:productIdentifier
+                                                          discount:discountIdentifier
+                                                   completionBlock:[self getResponseCompletionBlockWithResolve:^(NSDictionary *paymentDiscount) {
+            preparedPurchase[@"paymentDiscount"] = paymentDiscount;
+            resolve([self addPreparedPurchase:preparedPurchase]);
+        }
+                                                                                                        reject:reject
+                                                                                                     onSuccess:nil
+                                                                                                       metrics:metrics]];
+    }
+                                                                                                reject:reject
+                                                                                             onSuccess:nil
+                                                                                               metrics:nil]];
+}
+
+RCT_REMAP_METHOD(purchasePreparedPurchase,
+                 purchasePreparedPurchase:(nonnull NSNumber *)handle
+                 upgradeInfo:(NSDictionary *)upgradeInfo
+                 resolve:(RCTPromiseResolveBlock)resolve
+                 reject:(RCTPromiseRejectBlock)reject)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSDictionary *preparedPurchase = self.preparedPurchases[handle];
+    if (!preparedPurchase) {
+        NSString *message = @"The prepared purchase was already made, released or has expired";
+        [self rejectPromiseWithBlock:reject error:[NSError errorWithDomain:RCPurchasesErrorDomain
+                                                                      code:RCUnknownError
+                                                                  userInfo:@{NSLocalizedDescriptionKey: message}]];
+        return;
+    }
+    [self.preparedPurchases removeObjectForKey:handle];
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"purchasePreparedPurchase"];
+    NSNumber *discountTimestamp = preparedPurchase[@"paymentDiscount"][@"timestamp"];
+    [self runOnMainQueue:^{
+        [RCCommonFunctionality purchasePackage:preparedPurchase[@"packageIdentifier"]
+                                      offering:preparedPurchase[@"offeringIdentifier"]
+                       signedDiscountTimestamp:discountTimestamp.stringValue
+                               completionBlock:[self getResponseCompletionBlockWithResolve:resolve
+                                                                                    reject:reject
+                                                                                 onSuccess:nil
+                                                                                   metrics:metrics]];
+    }
+                 metrics:metrics
+              completion:nil];
+}
+
+RCT_EXPORT_METHOD(releasePreparedPurchase:(nonnull NSNumber *)handle)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self.preparedPurchases removeObjectForKey:handle];
 }
 
 RCT_REMAP_METHOD(restoreTransactions,
                  restoreTransactionsWithResolve:(RCTPromiseResolveBlock)resolve
                  reject:(RCTPromiseRejectBlock)reject) {
-    [RCCommonFunctionality restoreTransactionsWithCompletionBlock:[self getResponseCompletionBlockWithResolve:resolve reject:reject]];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"restoreTransactions"];
+    [RCCommonFunctionality restoreTransactionsWithCompletionBlock:[self getResponseCompletionBlockWithResolve:[self payloadResolveBlockWithResolve:resolve]
+                                                                                                       reject:reject
+                                                                                                    onSuccess:nil
+                                                                                                      metrics:metrics]];
+}
+
+// The SDK refreshes the receipt and posts it in a single call, so the stages are around that call. The purchaser info
+// is encoded once, after the SDK merged everything it restored
+RCT_REMAP_METHOD(restoreTransactionsWithProgress,
+                 restoreTransactionsWithProgressWithRequestID:(nonnull NSNumber *)requestID
+                 resolve:(RCTPromiseResolveBlock)resolve
+                 reject:(RCTPromiseRejectBlock)reject) {
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"restoreTransactionsWithProgress"];
+    [self sendRestoreProgressWithRequestID:requestID stage:@"started" processedProductCount:0 purchasedProductCount:0];
+    RCTPromiseResolveBlock resolveWithProgress = ^(NSDictionary *purchaserInfo) {
+        NSUInteger purchasedProductCount = [purchaserInfo[@"allPurchasedProductIdentifiers"] count];
+        [self sendRestoreProgressWithRequestID:requestID
+                                         stage:@"restored"
+                         processedProductCount:0
+                         purchasedProductCount:purchasedProductCount];
+        id payload = [self payloadWithDictionary:purchaserInfo];
+        [self sendRestoreProgressWithRequestID:requestID
+                                         stage:@"processed"
+                         processedProductCount:purchasedProductCount
+                         purchasedProductCount:purchasedProductCount];
+        resolve(payload);
+    };
+    [RCCommonFunctionality restoreTransactionsWithCompletionBlock:[self getResponseCompletionBlockWithResolve:resolveWithProgress
+                                                                                                       reject:reject
+                                                                                                    onSuccess:nil
+                                                                                                      metrics:metrics]];
 }
 
 RCT_REMAP_METHOD(getAppUserID,
                  getAppUserIDWithResolve:(RCTPromiseResolveBlock)resolve
                  reject:(RCTPromiseRejectBlock)reject)
 {
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
     resolve([RCCommonFunctionality appUserID]);
 }
 
+RCT_EXPORT_BLOCKING_SYNCHRONOUS_METHOD(getAppUserIDSync)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    return [RCCommonFunctionality appUserID];
+}
+
 RCT_EXPORT_METHOD(createAlias:(nullable NSString *)newAppUserID
                   resolve:(RCTPromiseResolveBlock)resolve
                   reject:(RCTPromiseRejectBlock)reject)
 {
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self willChangeAppUser];
     [RCCommonFunctionality createAlias:newAppUserID
-                       completionBlock:[self getResponseCompletionBlockWithResolve:resolve reject:reject]];
+                       completionBlock:[self getResponseCompletionBlockWithResolve:[self payloadResolveBlockWithResolve:resolve]
+                                                                            reject:reject
+                                                                         onSuccess:^(NSDictionary *purchaserInfo) {
+        [self didReceivePurchaserInfo:purchaserInfo];
+    }
+                                                                           metrics:nil]];
 }
 
 RCT_EXPORT_METHOD(identify:(nullable NSString *)appUserID
                   resolve:(RCTPromiseResolveBlock)resolve
                   reject:(RCTPromiseRejectBlock)reject) {
-    [RCCommonFunctionality identify:appUserID
-                    completionBlock:[self getResponseCompletionBlockWithResolve:resolve reject:reject]];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self willChangeAppUser];
+    void (^onSuccess)(NSDictionary *) = ^(NSDictionary *purchaserInfo) {
+        [self didReceivePurchaserInfo:purchaserInfo appUserID:appUserID];
+    };
+    NSDictionary *snapshot = appUserID ? [self userSnapshotForAppUserID:appUserID] : nil;
+    if (!snapshot[@"purchaserInfo"]) {
+        [RCCommonFunctionality identify:appUserID
+                        completionBlock:[self getResponseCompletionBlockWithResolve:[self payloadResolveBlockWithResolve:resolve]
+                                                                             reject:reject
+                                                                          onSuccess:onSuccess
+                                                                            metrics:nil]];
+        return;
+    }
+    // Served from the snapshot, identify still switches the SDK to the user and listeners get its purchaser info
+    // if it changed. Until then the SDK is still on the previous user, if switching fails JS is told with an
+    // RNPurchasesIdentifyFailedEvent.
+    NSDictionary *snapshotPurchaserInfo = snapshot[@"purchaserInfo"];
+    NSDictionary *snapshotOfferings = snapshot[@"offerings"];
+    self.lastPurchaserInfo = snapshotPurchaserInfo;
+    self.lastPurchaserInfoAppUserID = appUserID;
+    if (snapshotOfferings) {
+        self.lastOfferings = snapshotOfferings;
+    }
+    resolve([self payloadWithDictionary:snapshotPurchaserInfo]);
+    [RCCommonFunctionality identify:appUserID completionBlock:^(NSDictionary *_Nullable purchaserInfo,
+                                                                RCErrorContainer *_Nullable error) {
+        dispatch_async(self.methodQueue, ^{
+            RNPURCHASES_SIGNPOST_SCOPE("completion");
+            if (!error) {
+                if (purchaserInfo) {
+                    onSuccess(RNPurchasesResultWithDateMillis(purchaserInfo));
+                }
+                return;
+            }
+            NSLog(@"[RNPurchases] Error identifying %@: %@", appUserID, error.message);
+            // the snapshot of the user that couldn't be switched to isn't the current one
+            if ([self.lastPurchaserInfo isEqual:snapshotPurchaserInfo]) {
+                self.lastPurchaserInfo = nil;
+                self.lastPurchaserInfoAppUserID = nil;
+            }
+            if (snapshotOfferings && [self.lastOfferings isEqual:snapshotOfferings]) {
+                self.lastOfferings = nil;
+            }
+            if ([self isObservingEvent:RNPurchasesIdentifyFailedEvent]) {
+                [self sendEventWithName:RNPurchasesIdentifyFailedEvent body:@{@"appUserID": appUserID,
+                                                                              @"error": error.info ?: @{}}];
+            }
+        });
+    }];
+}
+
+RCT_EXPORT_METHOD(setUserSnapshotCacheLimit:(double)maxBytes)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    self.userSnapshotLimit = @(MAX(maxBytes, 0));
+    [self trimUserSnapshots];
 }
 
 RCT_REMAP_METHOD(reset,
                  resetWithResolve:(RCTPromiseResolveBlock)resolve
                  reject:(RCTPromiseRejectBlock)reject) {
-    [RCCommonFunctionality resetWithCompletionBlock:[self getResponseCompletionBlockWithResolve:resolve reject:reject]];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self willChangeAppUser];
+    [RCCommonFunctionality resetWithCompletionBlock:[self getResponseCompletionBlockWithResolve:[self payloadResolveBlockWithResolve:resolve]
+                                                                                         reject:reject
+                                                                                      onSuccess:^(NSDictionary *purchaserInfo) {
+        [self didReceivePurchaserInfo:purchaserInfo];
+    }
+                                                                                        metrics:nil]];
 }
 
 RCT_REMAP_METHOD(setDebugLogsEnabled,
                  debugLogsEnabled:(BOOL)enabled) {
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
     [RCCommonFunctionality setDebugLogsEnabled:enabled];
 }
 
 RCT_REMAP_METHOD(getPurchaserInfo,
                    purchaserInfoWithResolve:(RCTPromiseResolveBlock)resolve
                    reject:(RCTPromiseRejectBlock)reject) {
-    [RCCommonFunctionality getPurchaserInfoWithCompletionBlock:[self getResponseCompletionBlockWithResolve:resolve reject:reject]];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"getPurchaserInfo"];
+    // keyed by app user, so a request made after the user changed doesn't get the previous user's result
+    NSString *appUserID = [RCCommonFunctionality appUserID];
+    NSString *requestKey = [@"getPurchaserInfo:" stringByAppendingString:appUserID ?: @""];
+    if (![self addPendingPromiseForRequestKey:requestKey resolve:resolve reject:reject]) {
+        return;
+    }
+    [RCCommonFunctionality getPurchaserInfoWithCompletionBlock:[self getResponseCompletionBlockWithResolve:[self payloadResolveBlockWithResolve:[self pendingResolveForRequestKey:requestKey]]
+                                                                                                     reject:[self pendingRejectForRequestKey:requestKey]
+                                                                                                  onSuccess:^(NSDictionary *purchaserInfo) {
+        [self didReceivePurchaserInfo:purchaserInfo appUserID:appUserID];
+    }
+                                                                                                    metrics:metrics]];
+}
+
+RCT_REMAP_METHOD(getPurchaserInfoLazy,
+                 lazyPurchaserInfoWithResolve:(RCTPromiseResolveBlock)resolve
+                 reject:(RCTPromiseRejectBlock)reject) {
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"getPurchaserInfoLazy"];
+    NSString *appUserID = [RCCommonFunctionality appUserID];
+    [RCCommonFunctionality getPurchaserInfoWithCompletionBlock:[self getResponseCompletionBlockWithResolve:^(NSDictionary *purchaserInfo) {
+        [self didReceivePurchaserInfo:purchaserInfo appUserID:appUserID];
+        resolve([self lazyPurchaserInfoWithPurchaserInfo:purchaserInfo]);
+    }
+                                                                                                     reject:reject
+                                                                                                  onSuccess:nil
+                                                                                                    metrics:metrics]];
+}
+
+RCT_EXPORT_BLOCKING_SYNCHRONOUS_METHOD(getPurchaserInfoField:(nonnull NSNumber *)handle
+                                       field:(NSString *)field)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSDictionary *purchaserInfo;
+    @synchronized (self) {
+        purchaserInfo = self.lazyPurchaserInfos[handle];
+    }
+    if (!purchaserInfo) {
+        // only the last RNPurchasesMaxLazyPurchaserInfos handles are kept
+        return @{@"evicted": @YES};
+    }
+    id value = purchaserInfo;
+    for (NSString *key in [field componentsSeparatedByString:@"."]) {
+        value = [value isKindOfClass:NSDictionary.class] ? value[key] : nil;
+    }
+    // wrapped the same way as on Android, where synchronous methods can't return arbitrary values
+    return @{@"value": value ?: [NSNull null]};
 }
 
 RCT_EXPORT_METHOD(setAutomaticAppleSearchAdsAttributionCollection:(BOOL)automaticAppleSearchAdsAttributionCollection)
 {
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
     [RCCommonFunctionality setAutomaticAppleSearchAdsAttributionCollection:automaticAppleSearchAdsAttributionCollection];
 }
 
@@ -166,25 +969,121 @@ RCT_REMAP_METHOD(isAnonymous,
                  isAnonymousWithResolve:(RCTPromiseResolveBlock)resolve
                  reject:(RCTPromiseRejectBlock)reject)
 {
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
     resolve(@([RCCommonFunctionality isAnonymous]));
 }
 
+RCT_EXPORT_BLOCKING_SYNCHRONOUS_METHOD(isAnonymousSync)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    return @([RCCommonFunctionality isAnonymous]);
+}
+
+RCT_EXPORT_BLOCKING_SYNCHRONOUS_METHOD(getCachedPurchaserInfoSync)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSDictionary *purchaserInfo = self.lastPurchaserInfo;
+    return purchaserInfo ? [self payloadWithDictionary:purchaserInfo] : nil;
+}
+
+RCT_EXPORT_BLOCKING_SYNCHRONOUS_METHOD(getCachedOfferingsSync)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSDictionary *offerings = self.lastOfferings;
+    return offerings ? [self payloadWithDictionary:offerings] : nil;
+}
+
 RCT_EXPORT_METHOD(makeDeferredPurchase:(nonnull NSNumber *)callbackID
                   resolve:(RCTPromiseResolveBlock)resolve
                   reject:(RCTPromiseRejectBlock)reject)
 {
-    RCDeferredPromotionalPurchaseBlock defermentBlock = [self.defermentBlocks objectAtIndex:[callbackID integerValue]];
-    [RCCommonFunctionality makeDeferredPurchase:defermentBlock
-                                completionBlock:[self getResponseCompletionBlockWithResolve:resolve reject:reject]];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    RCDeferredPromotionalPurchaseBlock defermentBlock = self.defermentBlocks[callbackID];
+    if (!defermentBlock) {
+        NSString *message = @"The deferred purchase was already made, released or has expired";
+        [self rejectPromiseWithBlock:reject error:[NSError errorWithDomain:RCPurchasesErrorDomain
+                                                                      code:RCUnknownError
+                                                                  userInfo:@{NSLocalizedDescriptionKey: message}]];
+        return;
+    }
+    [self.defermentBlocks removeObjectForKey:callbackID];
+    [self runOnMainQueue:^{
+        [RCCommonFunctionality makeDeferredPurchase:defermentBlock
+                                    completionBlock:[self getResponseCompletionBlockWithResolve:resolve reject:reject]];
+    }
+                 metrics:nil
+              completion:nil];
+}
+
+RCT_EXPORT_METHOD(releaseDeferredPurchase:(nonnull NSNumber *)callbackID)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self.defermentBlocks removeObjectForKey:callbackID];
 }
 
 RCT_EXPORT_METHOD(checkTrialOrIntroductoryPriceEligibility:(NSArray *)products
                   resolve:(RCTPromiseResolveBlock)resolve
                   reject:(RCTPromiseRejectBlock)reject)
 {
-    [RCCommonFunctionality checkTrialOrIntroductoryPriceEligibility:products
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"checkTrialOrIntroductoryPriceEligibility"];
+    NSMutableDictionary *eligibilities = [NSMutableDictionary dictionary];
+    NSArray<NSString *> *uncachedProducts = [self uncachedIntroEligibilityProducts:products
+                                                               cachedEligibilities:eligibilities];
+    if (uncachedProducts.count == 0) {
+        metrics[@"sdkCompletion"] = @(RNPurchasesNowMillis());
+        resolve(eligibilities);
+        [self sendMetrics:metrics result:eligibilities];
+        return;
+    }
+    [RCCommonFunctionality checkTrialOrIntroductoryPriceEligibility:uncachedProducts
+                                                    completionBlock:^(NSDictionary<NSString *,RCIntroEligibility *> * _Nonnull responseDictionary) {
+        metrics[@"sdkCompletion"] = @(RNPurchasesNowMillis());
+        dispatch_async(self.methodQueue, ^{
+            [self cacheIntroEligibilities:responseDictionary];
+            [eligibilities addEntriesFromDictionary:responseDictionary];
+            resolve(eligibilities);
+            [self sendMetrics:metrics result:eligibilities];
+        });
+    }];
+}
+
+// Resolves like checkTrialOrIntroductoryPriceEligibility, after sending a Purchases-IntroEligibility event with the
+// cached eligibilities right away and one with the rest as soon as the SDK has checked them
+RCT_EXPORT_METHOD(checkTrialOrIntroductoryPriceEligibilityStreaming:(NSArray *)products
+                  requestID:(nonnull NSNumber *)requestID
+                  resolve:(RCTPromiseResolveBlock)resolve
+                  reject:(RCTPromiseRejectBlock)reject)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"checkTrialOrIntroductoryPriceEligibilityStreaming"];
+    NSMutableDictionary *eligibilities = [NSMutableDictionary dictionary];
+    NSArray<NSString *> *uncachedProducts = [self uncachedIntroEligibilityProducts:products
+                                                               cachedEligibilities:eligibilities];
+    if (eligibilities.count > 0 && [self isObservingEvent:RNPurchasesIntroEligibilityEvent]) {
+        [self sendEventWithName:RNPurchasesIntroEligibilityEvent
+                           body:@{@"requestID": requestID, @"eligibilities": [eligibilities copy]}];
+    }
+    if (uncachedProducts.count == 0) {
+        metrics[@"sdkCompletion"] = @(RNPurchasesNowMillis());
+        resolve(eligibilities);
+        [self sendMetrics:metrics result:eligibilities];
+        return;
+    }
+    // a single SDK call, each one parses the receipt and posts it to the backend
+    [RCCommonFunctionality checkTrialOrIntroductoryPriceEligibility:uncachedProducts
                                                     completionBlock:^(NSDictionary<NSString *,RCIntroEligibility *> * _Nonnull responseDictionary) {
-        resolve([NSDictionary dictionaryWithDictionary:responseDictionary]);
+        metrics[@"sdkCompletion"] = @(RNPurchasesNowMillis());
+        dispatch_async(self.methodQueue, ^{
+            [self cacheIntroEligibilities:responseDictionary];
+            [eligibilities addEntriesFromDictionary:responseDictionary];
+            if ([self isObservingEvent:RNPurchasesIntroEligibilityEvent]) {
+                [self sendEventWithName:RNPurchasesIntroEligibilityEvent
+                                   body:@{@"requestID": requestID, @"eligibilities": responseDictionary}];
+            }
+            resolve(eligibilities);
+            [self sendMetrics:metrics result:eligibilities];
+        });
     }];
 }
 
@@ -194,145 +1093,955 @@ RCT_REMAP_METHOD(getPaymentDiscount,
                  resolve:(RCTPromiseResolveBlock)resolve
                  reject:(RCTPromiseRejectBlock)reject)
 {
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
     [RCCommonFunctionality paymentDiscountForProductIdentifier:productIdentifier
                                                       discount:discountIdentifier
                                                completionBlock:[self getResponseCompletionBlockWithResolve:resolve reject:reject]];
 }
 
+RCT_EXPORT_METHOD(setEventObserved:(NSString *)eventName observed:(BOOL)observed)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSMutableSet<NSString *> *observedEvents = [self.observedEvents mutableCopy] ?: [NSMutableSet set];
+    if (observed) {
+        [observedEvents addObject:eventName];
+    } else {
+        [observedEvents removeObject:eventName];
+        [self.pendingEvents removeObjectForKey:eventName];
+        if ([eventName isEqualToString:RNPurchasesPurchaserInfoUpdatedEvent]) {
+            // the next listener gets the purchaser info it missed
+            self.lastEmittedPurchaserInfo = nil;
+        }
+    }
+    self.observedEvents = observedEvents;
+}
+
+RCT_EXPORT_METHOD(setPurchaserInfoMode:(NSString *)mode)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    self.summaryPurchaserInfos = [mode isEqualToString:@"summary"];
+}
+
+RCT_REMAP_METHOD(getTransactions,
+                 getTransactionsAfter:(nullable NSString *)after
+                 limit:(NSInteger)limit
+                 resolve:(RCTPromiseResolveBlock)resolve
+                 reject:(RCTPromiseRejectBlock)reject)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    NSDictionary *purchaserInfo = self.lastPurchaserInfo;
+    NSString *appUserID = [RCCommonFunctionality appUserID];
+    // it's refetched when the SDK switched to another app user since it was received
+    if (purchaserInfo && [self.lastPurchaserInfoAppUserID isEqualToString:appUserID]) {
+        [self resolveTransactionsOfPurchaserInfo:purchaserInfo after:after limit:limit resolve:resolve reject:reject];
+        return;
+    }
+    [RCCommonFunctionality getPurchaserInfoWithCompletionBlock:[self getResponseCompletionBlockWithResolve:^(NSDictionary *fetchedPurchaserInfo) {
+        [self didReceivePurchaserInfo:fetchedPurchaserInfo appUserID:appUserID];
+        [self resolveTransactionsOfPurchaserInfo:fetchedPurchaserInfo after:after limit:limit resolve:resolve reject:reject];
+    }
+                                                                                                     reject:reject
+                                                                                                  onSuccess:nil
+                                                                                                    metrics:nil]];
+}
+
+RCT_EXPORT_METHOD(setPayloadEncoding:(NSString *)encoding)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    self.compactPayloads = [encoding isEqualToString:@"compact"];
+}
+
+RCT_EXPORT_METHOD(setPerformanceMetricsEnabled:(BOOL)enabled)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    self.performanceMetricsEnabled = enabled;
+}
+
 RCT_EXPORT_METHOD(invalidatePurchaserInfoCache)
 {
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
     [RCCommonFunctionality invalidatePurchaserInfoCache];
 }
 
+RCT_REMAP_METHOD(getQueuedOperationCount,
+                 getQueuedOperationCountWithResolve:(RCTPromiseResolveBlock)resolve
+                 reject:(RCTPromiseRejectBlock)reject)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    resolve(@(self.operationQueueDepth));
+}
+
 #pragma mark - Subscriber Attributes
 
 RCT_EXPORT_METHOD(setProxyURLString:(nullable NSString *)proxyURLString)
 {
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
     [RCCommonFunctionality setProxyURLString:proxyURLString];
 }
 
 RCT_EXPORT_METHOD(setAttributes:(NSDictionary *)attributes)
 {
-    [RCCommonFunctionality setAttributes:attributes];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"attributes": attributes}];
+}
+
+RCT_EXPORT_METHOD(setAttributesBatch:(NSDictionary *)batch)
+{
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:batch];
 }
 
 RCT_EXPORT_METHOD(setEmail:(NSString *)email)
 {
-    [RCCommonFunctionality setEmail:email];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"email": email ?: NSNull.null}];
 }
 
 RCT_EXPORT_METHOD(setPhoneNumber:(NSString *)phoneNumber)
 {
-    [RCCommonFunctionality setPhoneNumber:phoneNumber];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"phoneNumber": phoneNumber ?: NSNull.null}];
 }
 
 RCT_EXPORT_METHOD(setDisplayName:(NSString *)displayName)
 {
-    [RCCommonFunctionality setDisplayName:displayName];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"displayName": displayName ?: NSNull.null}];
 }
 
 RCT_EXPORT_METHOD(setPushToken:(NSString *)pushToken)
 {
-    [RCCommonFunctionality setPushToken:pushToken];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"pushToken": pushToken ?: NSNull.null}];
 }
 
 # pragma mark Attribution IDs
 
 RCT_EXPORT_METHOD(collectDeviceIdentifiers)
 {
-    [RCCommonFunctionality collectDeviceIdentifiers];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"collectDeviceIdentifiers": @YES}];
 }
 
 RCT_EXPORT_METHOD(setAdjustID:(NSString *)adjustID)
 {
-    [RCCommonFunctionality setAdjustID:adjustID];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"adjustID": adjustID ?: NSNull.null}];
 }
 
 RCT_EXPORT_METHOD(setAppsflyerID:(NSString *)appsflyerID)
 {
-    [RCCommonFunctionality setAppsflyerID:appsflyerID];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"appsflyerID": appsflyerID ?: NSNull.null}];
 }
 
 RCT_EXPORT_METHOD(setFBAnonymousID:(NSString *)fbAnonymousID)
 {
-    [RCCommonFunctionality setFBAnonymousID:fbAnonymousID];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"fbAnonymousID": fbAnonymousID ?: NSNull.null}];
 }
 
 RCT_EXPORT_METHOD(setMparticleID:(NSString *)mparticleID)
 {
-    [RCCommonFunctionality setMparticleID:mparticleID];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"mparticleID": mparticleID ?: NSNull.null}];
 }
 
 RCT_EXPORT_METHOD(setOnesignalID:(NSString *)onesignalID)
 {
-    [RCCommonFunctionality setOnesignalID:onesignalID];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"onesignalID": onesignalID ?: NSNull.null}];
 }
 
 # pragma mark Campaign parameters
 
 RCT_EXPORT_METHOD(setMediaSource:(NSString *)mediaSource)
 {
-    [RCCommonFunctionality setMediaSource:mediaSource];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"mediaSource": mediaSource ?: NSNull.null}];
 }
 
 RCT_EXPORT_METHOD(setCampaign:(NSString *)campaign)
 {
-    [RCCommonFunctionality setCampaign:campaign];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"campaign": campaign ?: NSNull.null}];
 }
 
 RCT_EXPORT_METHOD(setAdGroup:(NSString *)adGroup)
 {
-    [RCCommonFunctionality setAdGroup:adGroup];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"adGroup": adGroup ?: NSNull.null}];
 }
 
 RCT_EXPORT_METHOD(setAd:(NSString *)ad)
 {
-    [RCCommonFunctionality setAd:ad];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"ad": ad ?: NSNull.null}];
 }
 
 RCT_EXPORT_METHOD(setKeyword:(NSString *)keyword)
 {
-    [RCCommonFunctionality setKeyword:keyword];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"keyword": keyword ?: NSNull.null}];
 }
 
 RCT_EXPORT_METHOD(setCreative:(NSString *)creative)
 {
-    [RCCommonFunctionality setCreative:creative];
+    RNPURCHASES_SIGNPOST_SCOPE(__PRETTY_FUNCTION__);
+    [self submitAttributesBatch:@{@"creative": creative ?: NSNull.null}];
 }
 
     
 #pragma mark -
 #pragma mark Delegate Methods
 - (void)purchases:(RCPurchases *)purchases didReceiveUpdatedPurchaserInfo:(RCPurchaserInfo *)purchaserInfo {
-    [self sendEventWithName:RNPurchasesPurchaserInfoUpdatedEvent body:purchaserInfo.dictionary];
+    NSDictionary *purchaserInfoDictionary = RNPurchasesPurchaserInfoWithDateMillis(purchaserInfo.dictionary);
+    // the SDK sends the purchaser info of its current user, which can change before methodQueue gets to it
+    NSString *appUserID = [RCCommonFunctionality appUserID];
+    // lastEmittedPurchaserInfo is only accessed from methodQueue
+    dispatch_async(self.methodQueue, ^{
+        [self didReceivePurchaserInfo:purchaserInfoDictionary appUserID:appUserID];
+        if (![self isObservingEvent:RNPurchasesPurchaserInfoUpdatedEvent]
+            || [self isPurchaserInfo:purchaserInfoDictionary equalToPurchaserInfo:self.lastEmittedPurchaserInfo]) {
+            return;
+        }
+        self.lastEmittedPurchaserInfo = purchaserInfoDictionary;
+        [self sendLatestEventWithName:RNPurchasesPurchaserInfoUpdatedEvent dictionary:purchaserInfoDictionary];
+    });
 }
 
 - (void)purchases:(RCPurchases *)purchases shouldPurchasePromoProduct:(SKProduct *)product defermentBlock:(RCDeferredPromotionalPurchaseBlock)makeDeferredPurchase {
-    if (!self.defermentBlocks) {
-        self.defermentBlocks = [NSMutableArray array];
-    }
-    [self.defermentBlocks addObject:makeDeferredPurchase];
-    NSInteger position = [self.defermentBlocks count]-1;
-    [self sendEventWithName:RNPurchasesShouldPurchasePromoProductEvent body:@{@"callbackID": @(position)}];
+    // defermentBlocks is only accessed from methodQueue
+    dispatch_async(self.methodQueue, ^{
+        if (!self.defermentBlocks) {
+            self.defermentBlocks = [NSMutableDictionary dictionary];
+        }
+        self.lastDefermentBlockID += 1;
+        NSNumber *callbackID = @(self.lastDefermentBlockID);
+        self.defermentBlocks[callbackID] = makeDeferredPurchase;
+        [self.defermentBlocks removeObjectForKey:@(self.lastDefermentBlockID - RNPurchasesMaxDefermentBlocks)];
+        __weak typeof(self) weakSelf = self;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(RNPurchasesDefermentBlockTTL * NSEC_PER_SEC)), self.methodQueue, ^{
+            [weakSelf.defermentBlocks removeObjectForKey:callbackID];
+        });
+        [self sendEventWithName:RNPurchasesShouldPurchasePromoProductEvent body:@{@"callbackID": callbackID}];
+    });
 }
 
 #pragma mark -
 #pragma mark Helper Methods
 
+- (NSURL *)offeringsSnapshotURL {
+    NSURL *cachesURL = [[NSFileManager.defaultManager URLsForDirectory:NSCachesDirectory
+                                                             inDomains:NSUserDomainMask] firstObject];
+    return [cachesURL URLByAppendingPathComponent:@"RNPurchasesOfferingsSnapshot.json"];
+}
+
+- (nullable NSDictionary *)offeringsSnapshotForAppUserID:(nullable NSString *)appUserID {
+    if (!self.offeringsSnapshot) {
+        NSData *data = [NSData dataWithContentsOfURL:self.offeringsSnapshotURL];
+        NSDictionary *snapshot = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+        // an empty snapshot stands for no usable file, so it's not read again
+        self.offeringsSnapshot = [snapshot isKindOfClass:NSDictionary.class] ? snapshot : @{};
+    }
+    NSDictionary *snapshot = self.offeringsSnapshot;
+    if (![snapshot[@"version"] isEqual:@(RNPurchasesOfferingsSnapshotVersion)]
+        || ![snapshot[@"appUserID"] isEqual:appUserID]) {
+        return nil;
+    }
+    return snapshot[@"offerings"];
+}
+
+// Keeps the offerings in memory and on disk, and lets JS know if they changed since the last snapshot
+- (void)didReceiveOfferings:(NSDictionary *)offerings {
+    self.lastOfferings = offerings;
+    NSString *appUserID = [RCCommonFunctionality appUserID];
+    if (appUserID) {
+        [self storeUserSnapshotValue:offerings forKey:@"offerings" appUserID:appUserID];
+    }
+    NSDictionary *previousOfferings = [self offeringsSnapshotForAppUserID:appUserID];
+    if ([offerings isEqualToDictionary:previousOfferings]) {
+        return;
+    }
+    if (appUserID) {
+        NSDictionary *snapshot = @{
+            @"version": @(RNPurchasesOfferingsSnapshotVersion),
+            @"appUserID": appUserID,
+            @"offerings": offerings
+        };
+        if ([NSJSONSerialization isValidJSONObject:snapshot]) {
+            NSData *data = [NSJSONSerialization dataWithJSONObject:snapshot options:0 error:nil];
+            if ([data writeToURL:self.offeringsSnapshotURL atomically:YES]) {
+                self.offeringsSnapshot = snapshot;
+            }
+        }
+    }
+    if (previousOfferings && [self isObservingEvent:RNPurchasesOfferingsUpdatedEvent]) {
+        [self sendLatestEventWithName:RNPurchasesOfferingsUpdatedEvent dictionary:offerings];
+    }
+}
+
+// On the methodQueue. In the background the dictionary replaces any pending one of the same event, and is only
+// encoded once the app is back in the foreground
+- (void)sendLatestEventWithName:(NSString *)eventName dictionary:(NSDictionary *)dictionary {
+    if (self.inBackground) {
+        if (!self.pendingEvents) {
+            self.pendingEvents = [NSMutableDictionary dictionary];
+        }
+        self.pendingEvents[eventName] = dictionary;
+        return;
+    }
+    // anything still pending is older than this dictionary
+    [self.pendingEvents removeObjectForKey:eventName];
+    [self sendEventWithName:eventName body:[self payloadWithDictionary:dictionary]];
+}
+
+// The page of nonSubscriptionTransactions after the transaction with the revenueCatId after, from the start without one
+- (void)resolveTransactionsOfPurchaserInfo:(NSDictionary *)purchaserInfo
+                                     after:(nullable NSString *)after
+                                     limit:(NSInteger)limit
+                                   resolve:(RCTPromiseResolveBlock)resolve
+                                    reject:(RCTPromiseRejectBlock)reject {
+    NSArray<NSDictionary *> *transactions = purchaserInfo[@"nonSubscriptionTransactions"];
+    if (![transactions isKindOfClass:NSArray.class]) {
+        transactions = @[];
+    }
+    NSUInteger start = 0;
+    if (after) {
+        NSUInteger index = [transactions indexOfObjectPassingTest:^BOOL(NSDictionary *transaction, NSUInteger idx, BOOL *stop) {
+            return [transaction[@"revenueCatId"] isEqual:after];
+        }];
+        if (index == NSNotFound) {
+            NSString *message = [NSString stringWithFormat:@"Transaction %@ isn't in the purchaser info anymore", after];
+            [self rejectPromiseWithBlock:reject error:[NSError errorWithDomain:RCPurchasesErrorDomain
+                                                                          code:RCUnknownError
+                                                                      userInfo:@{NSLocalizedDescriptionKey: message}]];
+            return;
+        }
+        start = index + 1;
+    }
+    NSUInteger end = MIN(transactions.count, start + (NSUInteger)MAX(limit, 1));
+    NSArray *page = [transactions subarrayWithRange:NSMakeRange(start, end - start)];
+    resolve(@{
+        @"transactions": page,
+        @"nextCursor": (end < transactions.count ? page.lastObject[@"revenueCatId"] : nil) ?: [NSNull null],
+        @"totalCount": @(transactions.count),
+    });
+}
+
+// Must be called from methodQueue. Prepared purchases can carry a signed discount, and the cached purchaser info,
+// offerings and queued operations belong to the app user being replaced
+- (void)willChangeAppUser {
+    if (self.configured) {
+        [self flushOperationQueueOffline:YES];
+    }
+    [self.preparedPurchases removeAllObjects];
+    self.lastPurchaserInfo = nil;
+    self.lastPurchaserInfoAppUserID = nil;
+    self.lastOfferings = nil;
+}
+
+// Must be called from methodQueue. For the results of app user changes, which belong to the user the SDK switched to
+- (void)didReceivePurchaserInfo:(NSDictionary *)purchaserInfo {
+    [self didReceivePurchaserInfo:purchaserInfo appUserID:[RCCommonFunctionality appUserID]];
+}
+
+// Must be called from methodQueue. appUserID is the user the request was made for, the SDK may have switched to
+// another one since. Its purchaser info is still kept in its snapshot, but it doesn't replace the cached one of the
+// current user
+- (void)didReceivePurchaserInfo:(NSDictionary *)purchaserInfo appUserID:(nullable NSString *)appUserID {
+    if (!appUserID) {
+        return;
+    }
+    if ([appUserID isEqualToString:[RCCommonFunctionality appUserID]]) {
+        self.lastPurchaserInfo = purchaserInfo;
+        self.lastPurchaserInfoAppUserID = appUserID;
+    }
+    [self storeUserSnapshotValue:purchaserInfo forKey:@"purchaserInfo" appUserID:appUserID];
+}
+
+// userSnapshots is only accessed from methodQueue. Marks the app user as the most recently used
+- (nullable NSDictionary *)userSnapshotForAppUserID:(NSString *)appUserID {
+    NSDictionary *snapshot = self.userSnapshots[appUserID];
+    if (snapshot) {
+        [self.userSnapshotOrder removeObject:appUserID];
+        [self.userSnapshotOrder addObject:appUserID];
+    }
+    return snapshot;
+}
+
+// key is purchaserInfo or offerings, snapshots keep <key>Bytes next to each value
+- (void)storeUserSnapshotValue:(NSDictionary *)value forKey:(NSString *)key appUserID:(NSString *)appUserID {
+    if (!self.userSnapshots) {
+        self.userSnapshots = [NSMutableDictionary dictionary];
+        self.userSnapshotOrder = [NSMutableArray array];
+    }
+    NSString *bytesKey = [key stringByAppendingString:@"Bytes"];
+    NSUInteger bytes = RNPurchasesEstimatedJSONLength(value);
+    NSMutableDictionary *snapshot = [[self userSnapshotForAppUserID:appUserID] mutableCopy] ?: [NSMutableDictionary dictionary];
+    self.userSnapshotBytes = self.userSnapshotBytes + bytes - [snapshot[bytesKey] unsignedIntegerValue];
+    snapshot[key] = value;
+    snapshot[bytesKey] = @(bytes);
+    self.userSnapshots[appUserID] = snapshot;
+    if (![self.userSnapshotOrder containsObject:appUserID]) {
+        [self.userSnapshotOrder addObject:appUserID];
+    }
+    [self trimUserSnapshots];
+}
+
+- (void)trimUserSnapshots {
+    NSUInteger limit = self.userSnapshotLimit ? self.userSnapshotLimit.unsignedIntegerValue : RNPurchasesDefaultUserSnapshotLimit;
+    while (self.userSnapshotBytes > limit && self.userSnapshotOrder.count > 0) {
+        NSString *appUserID = self.userSnapshotOrder.firstObject;
+        NSDictionary *snapshot = self.userSnapshots[appUserID];
+        self.userSnapshotBytes -= [snapshot[@"purchaserInfoBytes"] unsignedIntegerValue] + [snapshot[@"offeringsBytes"] unsignedIntegerValue];
+        [self.userSnapshots removeObjectForKey:appUserID];
+        [self.userSnapshotOrder removeObjectAtIndex:0];
+    }
+}
+
+// requestDate changes on every fetch, so it's not taken into account when looking for changes
+- (BOOL)isPurchaserInfo:(NSDictionary *)purchaserInfo equalToPurchaserInfo:(nullable NSDictionary *)otherPurchaserInfo {
+    if (!otherPurchaserInfo) {
+        return NO;
+    }
+    NSArray<NSString *> *ignoredKeys = @[@"requestDate", @"requestDateMillis"];
+    NSMutableDictionary *comparable = [purchaserInfo mutableCopy];
+    NSMutableDictionary *otherComparable = [otherPurchaserInfo mutableCopy];
+    [comparable removeObjectsForKeys:ignoredKeys];
+    [otherComparable removeObjectsForKeys:ignoredKeys];
+    return [comparable isEqualToDictionary:otherComparable];
+}
+
+// pendingPromises is only accessed from methodQueue. Returns NO when an identical request is already in flight,
+// the promise is then settled with the result of that request.
+- (BOOL)addPendingPromiseForRequestKey:(NSString *)requestKey
+                               resolve:(RCTPromiseResolveBlock)resolve
+                                reject:(RCTPromiseRejectBlock)reject {
+    if (!self.pendingPromises) {
+        self.pendingPromises = [NSMutableDictionary dictionary];
+    }
+    NSMutableArray<NSArray *> *promises = self.pendingPromises[requestKey];
+    BOOL isNewRequest = promises == nil;
+    if (isNewRequest) {
+        promises = [NSMutableArray array];
+        self.pendingPromises[requestKey] = promises;
+    }
+    [promises addObject:@[resolve, reject]];
+    return isNewRequest;
+}
+
+- (NSArray<NSArray *> *)removePendingPromisesForRequestKey:(NSString *)requestKey {
+    NSArray<NSArray *> *promises = self.pendingPromises[requestKey] ?: @[];
+    [self.pendingPromises removeObjectForKey:requestKey];
+    return promises;
+}
+
++ (NSArray<NSString *> *)lazyPurchaserInfoFields {
+    return @[@"allPurchasedProductIdentifiers",
+             @"allExpirationDates",
+             @"allExpirationDatesMillis",
+             @"allPurchaseDates",
+             @"allPurchaseDatesMillis",
+             @"nonSubscriptionTransactions",
+             @"entitlements.all"];
+}
+
+// Keeps the full purchaser info for getPurchaserInfoField, and sends JS everything but the lazy fields
+- (NSDictionary *)lazyPurchaserInfoWithPurchaserInfo:(NSDictionary *)purchaserInfo {
+    NSNumber *handle;
+    @synchronized (self) {
+        if (!self.lazyPurchaserInfos) {
+            self.lazyPurchaserInfos = [NSMutableDictionary dictionary];
+        }
+        self.lastLazyPurchaserInfoHandle += 1;
+        handle = @(self.lastLazyPurchaserInfoHandle);
+        self.lazyPurchaserInfos[handle] = purchaserInfo;
+        [self.lazyPurchaserInfos removeObjectForKey:@(self.lastLazyPurchaserInfoHandle - RNPurchasesMaxLazyPurchaserInfos)];
+    }
+    NSMutableDictionary *lazyPurchaserInfo = [purchaserInfo mutableCopy];
+    NSMutableDictionary *entitlements = [purchaserInfo[@"entitlements"] mutableCopy];
+    [entitlements removeObjectForKey:@"all"];
+    lazyPurchaserInfo[@"entitlements"] = entitlements;
+    [lazyPurchaserInfo removeObjectsForKeys:RNPurchases.lazyPurchaserInfoFields];
+    lazyPurchaserInfo[@"lazyFieldsHandle"] = handle;
+    lazyPurchaserInfo[@"lazyFields"] = RNPurchases.lazyPurchaserInfoFields;
+    return lazyPurchaserInfo;
+}
+
+// productCache is only accessed from methodQueue. Counts a hit for every identifier with a valid entry and a miss for
+// every other one, and returns the identifiers that have to be fetched
+- (NSArray<NSString *> *)uncachedProductIdentifiers:(NSArray<NSString *> *)identifiers
+                                      cachedProducts:(NSMutableArray<NSDictionary *> *)cachedProducts {
+    NSTimeInterval now = NSProcessInfo.processInfo.systemUptime;
+    NSTimeInterval ttl = self.productCacheTTL ? self.productCacheTTL.doubleValue : RNPurchasesDefaultProductCacheTTL;
+    NSMutableArray<NSString *> *uncachedIdentifiers = [NSMutableArray array];
+    for (NSString *identifier in identifiers) {
+        NSDictionary *entry = self.productCache[identifier];
+        if (entry && now - [entry[@"cachedAt"] doubleValue] < ttl) {
+            [cachedProducts addObject:entry[@"product"]];
+            self.productCacheHits += 1;
+        } else {
+            [self.productCache removeObjectForKey:identifier];
+            [uncachedIdentifiers addObject:identifier];
+            self.productCacheMisses += 1;
+        }
+    }
+    return uncachedIdentifiers;
+}
+
+// Eligibility only changes with the receipt, so it's cached for as long as the receipt stays the same. Hashing the
+// receipt is much cheaper than the SDK parsing it and asking the backend.
+- (NSMutableDictionary<NSString *, NSDictionary *> *)introEligibilityCacheForCurrentReceipt {
+    NSURL *receiptURL = NSBundle.mainBundle.appStoreReceiptURL;
+    NSData *receipt = receiptURL ? [NSData dataWithContentsOfURL:receiptURL] : nil;
+    NSString *fingerprint = receipt ? RNPurchasesSHA256String(receipt) : @"";
+    if (!self.introEligibilityCache || ![fingerprint isEqualToString:self.introEligibilityReceiptFingerprint]) {
+        self.introEligibilityCache = [NSMutableDictionary dictionary];
+        self.introEligibilityReceiptFingerprint = fingerprint;
+    }
+    return self.introEligibilityCache;
+}
+
+- (NSArray<NSString *> *)uncachedIntroEligibilityProducts:(NSArray<NSString *> *)products
+                                      cachedEligibilities:(NSMutableDictionary *)cachedEligibilities {
+    NSMutableDictionary<NSString *, NSDictionary *> *cache = [self introEligibilityCacheForCurrentReceipt];
+    NSMutableArray<NSString *> *uncachedProducts = [NSMutableArray array];
+    for (NSString *product in products) {
+        NSDictionary *eligibility = cache[product];
+        if (eligibility) {
+            cachedEligibilities[product] = eligibility;
+        } else if (![uncachedProducts containsObject:product]) {
+            [uncachedProducts addObject:product];
+        }
+    }
+    return uncachedProducts;
+}
+
+- (void)cacheIntroEligibilities:(NSDictionary *)eligibilities {
+    NSMutableDictionary<NSString *, NSDictionary *> *cache = self.introEligibilityCache;
+    [eligibilities enumerateKeysAndObjectsUsingBlock:^(NSString *product, id eligibility, BOOL *stop) {
+        if ([eligibility isKindOfClass:NSDictionary.class]
+            && [eligibility[@"status"] integerValue] != RNPurchasesIntroEligibilityStatusUnknown) {
+            cache[product] = eligibility;
+        }
+    }];
+}
+
+- (void)cacheProducts:(NSArray<NSDictionary *> *)products {
+    NSTimeInterval ttl = self.productCacheTTL ? self.productCacheTTL.doubleValue : RNPurchasesDefaultProductCacheTTL;
+    if (ttl <= 0) {
+        return;
+    }
+    if (!self.productCache) {
+        self.productCache = [NSMutableDictionary dictionary];
+    }
+    NSNumber *cachedAt = @(NSProcessInfo.processInfo.systemUptime);
+    for (NSDictionary *product in products) {
+        NSString *identifier = product[@"identifier"];
+        if (identifier) {
+            self.productCache[identifier] = @{@"product": product, @"cachedAt": cachedAt};
+        }
+    }
+}
+
+// The first product for each identifier, in the order of the identifiers
+- (NSArray<NSDictionary *> *)productsWithIdentifiers:(NSArray<NSString *> *)identifiers
+                                        fromProducts:(NSArray<NSDictionary *> *)products {
+    NSMutableDictionary<NSString *, NSDictionary *> *productsByIdentifier = [NSMutableDictionary dictionary];
+    for (NSDictionary *product in products) {
+        NSString *identifier = product[@"identifier"];
+        if (identifier && !productsByIdentifier[identifier]) {
+            productsByIdentifier[identifier] = product;
+        }
+    }
+    NSMutableArray<NSDictionary *> *result = [NSMutableArray arrayWithCapacity:productsByIdentifier.count];
+    for (NSString *identifier in [NSOrderedSet orderedSetWithArray:identifiers]) {
+        NSDictionary *product = productsByIdentifier[identifier];
+        if (product) {
+            [result addObject:product];
+        }
+    }
+    return result;
+}
+
+- (nullable NSString *)productIdentifierForPackage:(NSString *)packageIdentifier
+                                          offering:(NSString *)offeringIdentifier
+                                         offerings:(NSDictionary *)offerings {
+    NSDictionary *offering = offerings[@"all"][offeringIdentifier];
+    for (NSDictionary *package in offering[@"availablePackages"]) {
+        if ([package[@"identifier"] isEqualToString:packageIdentifier]) {
+            return package[@"product"][@"identifier"];
+        }
+    }
+    return nil;
+}
+
+// preparedPurchases is only accessed from methodQueue. Returns what preparePurchase resolves with
+- (NSDictionary *)addPreparedPurchase:(NSDictionary *)preparedPurchase {
+    if (!self.preparedPurchases) {
+        self.preparedPurchases = [NSMutableDictionary dictionary];
+    }
+    self.lastPreparedPurchaseHandle += 1;
+    NSNumber *handle = @(self.lastPreparedPurchaseHandle);
+    self.preparedPurchases[handle] = preparedPurchase;
+    [self.preparedPurchases removeObjectForKey:@(self.lastPreparedPurchaseHandle - RNPurchasesMaxPreparedPurchases)];
+    __weak typeof(self) weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(RNPurchasesPreparedPurchaseTTL * NSEC_PER_SEC)), self.methodQueue, ^{
+        [weakSelf.preparedPurchases removeObjectForKey:handle];
+    });
+    return @{
+        @"handle": handle,
+        @"productIdentifier": preparedPurchase[@"productIdentifier"],
+        @"paymentDiscount": preparedPurchase[@"paymentDiscount"] ?: [NSNull null],
+    };
+}
+
+// The returned block must be called from methodQueue
+- (RCTPromiseResolveBlock)pendingResolveForRequestKey:(NSString *)requestKey {
+    return ^(id result) {
+        for (NSArray *promise in [self removePendingPromisesForRequestKey:requestKey]) {
+            ((RCTPromiseResolveBlock)promise[0])(result);
+        }
+    };
+}
+
+// The returned block must be called from methodQueue
+- (RCTPromiseRejectBlock)pendingRejectForRequestKey:(NSString *)requestKey {
+    return ^(NSString *code, NSString *message, NSError *error) {
+        for (NSArray *promise in [self removePendingPromisesForRequestKey:requestKey]) {
+            ((RCTPromiseRejectBlock)promise[1])(code, message, error);
+        }
+    };
+}
+
+// Keys and values are the ones of setAttributesBatch
+- (void)applyAttributesBatch:(NSDictionary *)batch {
+    NSDictionary *attributes = batch[@"attributes"];
+    if ([attributes isKindOfClass:NSDictionary.class]) {
+        [RCCommonFunctionality setAttributes:attributes];
+    }
+    [self applyBatchValueForKey:@"email" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setEmail:value]; }];
+    [self applyBatchValueForKey:@"phoneNumber" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setPhoneNumber:value]; }];
+    [self applyBatchValueForKey:@"displayName" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setDisplayName:value]; }];
+    [self applyBatchValueForKey:@"pushToken" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setPushToken:value]; }];
+    [self applyBatchValueForKey:@"adjustID" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setAdjustID:value]; }];
+    [self applyBatchValueForKey:@"appsflyerID" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setAppsflyerID:value]; }];
+    [self applyBatchValueForKey:@"fbAnonymousID" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setFBAnonymousID:value]; }];
+    [self applyBatchValueForKey:@"mparticleID" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setMparticleID:value]; }];
+    [self applyBatchValueForKey:@"onesignalID" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setOnesignalID:value]; }];
+    [self applyBatchValueForKey:@"mediaSource" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setMediaSource:value]; }];
+    [self applyBatchValueForKey:@"campaign" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setCampaign:value]; }];
+    [self applyBatchValueForKey:@"adGroup" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setAdGroup:value]; }];
+    [self applyBatchValueForKey:@"ad" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setAd:value]; }];
+    [self applyBatchValueForKey:@"keyword" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setKeyword:value]; }];
+    [self applyBatchValueForKey:@"creative" batch:batch setter:^(NSString *value) { [RCCommonFunctionality setCreative:value]; }];
+    if ([batch[@"collectDeviceIdentifiers"] boolValue]) {
+        [RCCommonFunctionality collectDeviceIdentifiers];
+    }
+}
+
+- (void)submitAttributesBatch:(NSDictionary *)batch {
+    if (![self submitQueuedOperation:@{@"type": @"attributes", @"payload": batch}]) {
+        [self applyAttributesBatch:batch];
+    }
+}
+
+- (NSURL *)operationQueueURL {
+    NSURL *applicationSupportURL = [[NSFileManager.defaultManager URLsForDirectory:NSApplicationSupportDirectory
+                                                                         inDomains:NSUserDomainMask] firstObject];
+    return [applicationSupportURL URLByAppendingPathComponent:@"RNPurchasesOperationQueue.jsonl"];
+}
+
+// One JSON operation per line, lines cut short by the app being killed while writing are skipped
+- (NSArray<NSDictionary *> *)readQueuedOperations {
+    NSData *data = [NSData dataWithContentsOfURL:self.operationQueueURL];
+    NSString *contents = data ? [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding] : nil;
+    NSMutableArray<NSDictionary *> *operations = [NSMutableArray array];
+    for (NSString *line in [contents componentsSeparatedByString:@"\n"]) {
+        NSData *lineData = [line dataUsingEncoding:NSUTF8StringEncoding];
+        id operation = lineData.length > 0 ? [NSJSONSerialization JSONObjectWithData:lineData options:0 error:nil] : nil;
+        if ([operation isKindOfClass:NSDictionary.class]) {
+            [operations addObject:operation];
+        }
+    }
+    return operations;
+}
+
+- (NSUInteger)operationQueueDepth {
+    if (!self.queuedOperationCount) {
+        self.queuedOperationCount = @(self.readQueuedOperations.count);
+    }
+    return self.queuedOperationCount.unsignedIntegerValue;
+}
+
+// Queues the operation when offline or before setupPurchases, along with the user it was made for. Returns NO if the
+// caller has to perform the operation right away.
+- (BOOL)submitQueuedOperation:(NSDictionary *)operation {
+    if (self.reachable || ![NSJSONSerialization isValidJSONObject:operation]) {
+        return NO;
+    }
+    NSUInteger depth = self.operationQueueDepth;
+    NSMutableDictionary *queuedOperation = [operation mutableCopy];
+    // nil before setupPurchases, those operations are replayed for the configured user
+    queuedOperation[@"appUserID"] = self.configured ? [RCCommonFunctionality appUserID] : nil;
+    NSMutableData *line = [[NSJSONSerialization dataWithJSONObject:queuedOperation options:0 error:nil] mutableCopy];
+    [line appendBytes:"\n" length:1];
+    NSURL *url = self.operationQueueURL;
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingToURL:url error:nil];
+    if (fileHandle) {
+        @try {
+            [fileHandle seekToEndOfFile];
+            [fileHandle writeData:line];
+        } @catch (NSException *exception) {
+            return NO;
+        } @finally {
+            [fileHandle closeFile];
+        }
+    } else {
+        [NSFileManager.defaultManager createDirectoryAtURL:url.URLByDeletingLastPathComponent
+                               withIntermediateDirectories:YES
+                                                attributes:nil
+                                                     error:nil];
+        if (![line writeToURL:url atomically:YES]) {
+            return NO;
+        }
+    }
+    self.queuedOperationCount = @(depth + 1);
+    return YES;
+}
+
+- (void)flushOperationQueue {
+    [self flushOperationQueueOffline:NO];
+}
+
+// Replays the queued operations in one go: the latest value for each attribute key, and the latest attribution data
+// for each network. Operations made for another user than the current one are dropped, the SDK can only write to the
+// current user. Offline, they're only replayed before the app user changes: the SDK keeps the attributes it couldn't
+// sync for the user they were set for.
+- (void)flushOperationQueueOffline:(BOOL)offline {
+    if (!(offline || self.reachable) || self.operationQueueDepth == 0) {
+        return;
+    }
+    NSMutableDictionary *metrics = [self startMetricsForMethod:@"flushOperationQueue"];
+    NSArray<NSDictionary *> *operations = [self readQueuedOperations];
+    [NSFileManager.defaultManager removeItemAtURL:self.operationQueueURL error:nil];
+    self.queuedOperationCount = @0;
+
+    NSMutableDictionary *attributesBatch = [NSMutableDictionary dictionary];
+    NSMutableDictionary *customAttributes = [NSMutableDictionary dictionary];
+    NSMutableDictionary<NSNumber *, NSDictionary *> *attributionsByNetwork = [NSMutableDictionary dictionary];
+    NSMutableArray<NSNumber *> *networks = [NSMutableArray array];
+    NSString *currentAppUserID = [RCCommonFunctionality appUserID];
+    NSUInteger droppedOperationCount = 0;
+    for (NSDictionary *operation in operations) {
+        NSDictionary *payload = operation[@"payload"];
+        if (![payload isKindOfClass:NSDictionary.class]) {
+            continue;
+        }
+        NSString *appUserID = operation[@"appUserID"];
+        if ([appUserID isKindOfClass:NSString.class] && ![appUserID isEqualToString:currentAppUserID]) {
+            droppedOperationCount += 1;
+            continue;
+        }
+        if ([operation[@"type"] isEqual:@"attributes"]) {
+            [payload enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+                if ([key isEqualToString:@"attributes"]) {
+                    if ([value isKindOfClass:NSDictionary.class]) {
+                        [customAttributes addEntriesFromDictionary:value];
+                    }
+                } else if ([key isEqualToString:@"collectDeviceIdentifiers"]) {
+                    attributesBatch[key] = @([value boolValue] || [attributesBatch[key] boolValue]);
+                } else {
+                    attributesBatch[key] = value;
+                }
+            }];
+        } else if ([operation[@"type"] isEqual:@"attribution"] && payload[@"network"]) {
+            NSNumber *network = payload[@"network"];
+            [networks removeObject:network];
+            [networks addObject:network];
+            attributionsByNetwork[network] = payload;
+        }
+    }
+    if (customAttributes.count > 0) {
+        attributesBatch[@"attributes"] = customAttributes;
+    }
+    if (droppedOperationCount > 0) {
+        NSLog(@"[RNPurchases] Dropped %lu queued operations made before the app user changed",
+              (unsigned long)droppedOperationCount);
+    }
+
+    [self applyAttributesBatch:attributesBatch];
+    for (NSNumber *network in networks) {
+        NSDictionary *attribution = attributionsByNetwork[network];
+        id networkUserId = attribution[@"networkUserId"];
+        [RCCommonFunctionality addAttributionData:attribution[@"data"]
+                                          network:network.integerValue
+                                    networkUserId:networkUserId == NSNull.null ? nil : networkUserId];
+    }
+    metrics[@"sdkCompletion"] = @(RNPurchasesNowMillis());
+    metrics[@"queueDepth"] = @(operations.count);
+    [self sendMetrics:metrics result:nil];
+}
+
+- (void)startMonitoringReachability {
+    if (self.reachability) {
+        return;
+    }
+    struct sockaddr_in address;
+    bzero(&address, sizeof(address));
+    address.sin_len = sizeof(address);
+    address.sin_family = AF_INET;
+    SCNetworkReachabilityRef reachability =
+        SCNetworkReachabilityCreateWithAddress(kCFAllocatorDefault, (const struct sockaddr *)&address);
+    if (!reachability) {
+        self.reachable = YES;
+        return;
+    }
+    self.reachability = reachability;
+    SCNetworkReachabilityFlags flags = 0;
+    self.reachable = !SCNetworkReachabilityGetFlags(reachability, &flags) || [self isReachableWithFlags:flags];
+    SCNetworkReachabilityContext context = {0, (__bridge void *)self, NULL, NULL, NULL};
+    SCNetworkReachabilitySetCallback(reachability, RNPurchasesReachabilityCallback, &context);
+    SCNetworkReachabilitySetDispatchQueue(reachability, self.methodQueue);
+}
+
+- (BOOL)isReachableWithFlags:(SCNetworkReachabilityFlags)flags {
+    return (flags & kSCNetworkReachabilityFlagsReachable) && !(flags & kSCNetworkReachabilityFlagsConnectionRequired);
+}
+
+- (void)reachabilityDidChangeWithFlags:(SCNetworkReachabilityFlags)flags {
+    self.reachable = [self isReachableWithFlags:flags];
+    [self flushOperationQueue];
+}
+
+- (void)applyBatchValueForKey:(NSString *)key
+                        batch:(NSDictionary *)batch
+                       setter:(void (^)(NSString *_Nullable value))setter {
+    id value = batch[key];
+    if (value) {
+        setter(value == [NSNull null] ? nil : value);
+    }
+}
+
+// Calls that touch StoreKit run the block on the main queue, and only the block. The time it keeps the main thread
+// busy is recorded as mainThreadMillis, to compare with the whole call running there before methodQueue moved off
+// main. completion runs on methodQueue afterwards, with mainThreadMillis already in metrics
+- (void)runOnMainQueue:(dispatch_block_t)block
+               metrics:(nullable NSMutableDictionary *)metrics
+            completion:(nullable dispatch_block_t)completion {
+    dispatch_async(dispatch_get_main_queue(), ^{
+        RNPURCHASES_SIGNPOST_SCOPE("main queue");
+        double start = RNPurchasesNowMillis();
+        block();
+        double mainThreadMillis = RNPurchasesNowMillis() - start;
+        dispatch_async(self.methodQueue, ^{
+            metrics[@"mainThreadMillis"] = @(mainThreadMillis);
+            if (completion) {
+                completion();
+            }
+        });
+    });
+}
+
+// Returns nil when performance metrics are disabled. Timestamps are in milliseconds since 1970, same as Date.now()
+- (nullable NSMutableDictionary *)startMetricsForMethod:(NSString *)method {
+    if (!self.performanceMetricsEnabled) {
+        return nil;
+    }
+    return [NSMutableDictionary dictionaryWithDictionary:@{@"method": method,
+                                                           @"nativeEntry": @(RNPurchasesNowMillis()),
+                                                           @"conversionMillis": @0}];
+}
+
+// On the methodQueue, before the restore resolves so JS still has the listener of the request
+- (void)sendRestoreProgressWithRequestID:(NSNumber *)requestID
+                                   stage:(NSString *)stage
+                   processedProductCount:(NSUInteger)processedProductCount
+                   purchasedProductCount:(NSUInteger)purchasedProductCount {
+    if (![self isObservingEvent:RNPurchasesRestoreProgressEvent]) {
+        return;
+    }
+    [self sendEventWithName:RNPurchasesRestoreProgressEvent body:@{@"requestID": requestID,
+                                                                   @"stage": stage,
+                                                                   @"processedProductCount": @(processedProductCount),
+                                                                   @"purchasedProductCount": @(purchasedProductCount)}];
+}
+
+// Called right after resolving, the payload is measured afterwards so it doesn't delay the result
+- (void)sendMetrics:(nullable NSMutableDictionary *)metrics result:(nullable id)result {
+    if (!metrics || ![self isObservingEvent:RNPurchasesMetricsEvent]) {
+        return;
+    }
+    metrics[@"resolve"] = @(RNPurchasesNowMillis());
+    NSData *payload = result && [NSJSONSerialization isValidJSONObject:result]
+        ? [NSJSONSerialization dataWithJSONObject:result options:0 error:nil]
+        : nil;
+    metrics[@"payloadBytes"] = @(payload.length);
+    [self sendEventWithName:RNPurchasesMetricsEvent body:metrics];
+}
+
+// Offerings and purchaser infos go through here, in the encoding set with setPayloadEncoding
+- (nullable NSDictionary *)payloadWithDictionary:(nullable NSDictionary *)dictionary {
+    if (self.summaryPurchaserInfos && dictionary[@"entitlements"]) {
+        dictionary = RNPurchasesPurchaserInfoSummary(dictionary);
+    }
+    if (!self.compactPayloads || !dictionary) {
+        return dictionary;
+    }
+    NSMutableArray<NSString *> *keys = [NSMutableArray array];
+    id compactValue = RNPurchasesCompactValue(dictionary, [NSMutableDictionary dictionary], keys);
+    return @{@"compactKeys": keys, @"compactValue": compactValue};
+}
+
+- (RCTPromiseResolveBlock)payloadResolveBlockWithResolve:(RCTPromiseResolveBlock)resolve {
+    return ^(NSDictionary *result) {
+        resolve([self payloadWithDictionary:result]);
+    };
+}
+
 - (void)rejectPromiseWithBlock:(RCTPromiseRejectBlock)reject error:(NSError *)error {
     reject([NSString stringWithFormat: @"%ld", (long)error.code], error.localizedDescription, error);
 }
 
 - (void (^)(NSDictionary *, RCErrorContainer *))getResponseCompletionBlockWithResolve:(RCTPromiseResolveBlock)resolve reject:(RCTPromiseRejectBlock)reject
 {
+    return [self getResponseCompletionBlockWithResolve:resolve reject:reject onSuccess:nil metrics:nil];
+}
+
+- (void (^)(NSDictionary *, RCErrorContainer *))getResponseCompletionBlockWithResolve:(RCTPromiseResolveBlock)resolve
+                                                                              reject:(RCTPromiseRejectBlock)reject
+                                                                           onSuccess:(nullable void (^)(NSDictionary *responseDictionary))onSuccess
+                                                                             metrics:(nullable NSMutableDictionary *)metrics
+{
+    // The SDK calls back on the main queue, hop back to methodQueue so conversion doesn't block the UI
     return ^(NSDictionary *_Nullable responseDictionary, RCErrorContainer *_Nullable error) {
-        if (error) {
-            reject([NSString stringWithFormat: @"%ld", (long)error.code], error.message, error.error);
-        } else if (responseDictionary) {
-            resolve([NSDictionary dictionaryWithDictionary:responseDictionary]);
-        } else {
-            resolve(nil);
-        }
+        metrics[@"sdkCompletion"] = @(RNPurchasesNowMillis());
+        dispatch_async(self.methodQueue, ^{
+            RNPURCHASES_SIGNPOST_SCOPE("completion");
+            if (error) {
+                reject([NSString stringWithFormat: @"%ld", (long)error.code], error.message, error.error);
+                [self sendMetrics:metrics result:nil];
+            } else if (responseDictionary) {
+                // PurchasesHybridCommon builds a new dictionary for every response and doesn't hold on to it,
+                // so it's handed to the bridge as is instead of being copied, and only purchaser infos get date millis
+                double conversionStart = RNPurchasesNowMillis();
+                NSDictionary *result = RNPurchasesResultWithDateMillis(responseDictionary);
+                double conversionMillis = RNPurchasesNowMillis() - conversionStart;
+                if (onSuccess) {
+                    onSuccess(result);
+                }
+                // resolve blocks from payloadResolveBlockWithResolve: apply the summary and compact encoding, same
+                // as Android's conversion
+                conversionStart = RNPurchasesNowMillis();
+                resolve(result);
+                metrics[@"conversionMillis"] = @(conversionMillis + RNPurchasesNowMillis() - conversionStart);
+                [self sendMetrics:metrics result:result];
+            } else {
+                resolve(nil);
+                [self sendMetrics:metrics result:nil];
+            }
+        });
     };
 }
 
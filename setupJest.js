@@ -672,31 +672,58 @@ global.paymentDiscountStub = {
 }
 
 NativeModules.RNPurchases = {
+  addListener: jest.fn(),
+  removeListeners: jest.fn(),
   setupPurchases: jest.fn(),
   setAllowSharingStoreAccount: jest.fn(),
   addAttributionData: jest.fn(),
   getOfferings: jest.fn(),
+  getOfferingsStaleWhileRevalidate: jest.fn(),
   getProductInfo: jest.fn(),
+  getProductInfoBatch: jest.fn(),
+  setProductCacheTTL: jest.fn(),
+  setUserSnapshotCacheLimit: jest.fn(),
+  invalidateProductCache: jest.fn(),
+  getProductCacheStats: jest.fn(),
+  getQueuedOperationCount: jest.fn(),
   makePurchase: jest.fn(),
   restoreTransactions: jest.fn(),
+  restoreTransactionsWithProgress: jest.fn(),
   getAppUserID: jest.fn(),
+  getAppUserIDSync: jest.fn(),
   createAlias: jest.fn(),
   identify: jest.fn(),
   setDebugLogsEnabled: jest.fn(),
   getPurchaserInfo: jest.fn(),
+  getPurchaserInfoLazy: jest.fn(),
+  getPurchaserInfoField: jest.fn(),
+  getCachedPurchaserInfoSync: jest.fn(),
+  getCachedOfferingsSync: jest.fn(),
   reset: jest.fn(),
   syncPurchases: jest.fn(),
   setFinishTransactions: jest.fn(),
   purchaseProduct: jest.fn(),
   purchasePackage: jest.fn(),
+  preparePurchase: jest.fn(),
+  purchasePreparedPurchase: jest.fn(),
+  releasePreparedPurchase: jest.fn(),
   isAnonymous: jest.fn(),
+  isAnonymousSync: jest.fn(),
   makeDeferredPurchase: jest.fn(),
+  releaseDeferredPurchase: jest.fn(),
+  setPerformanceMetricsEnabled: jest.fn(),
+  setPayloadEncoding: jest.fn(),
+  setPurchaserInfoMode: jest.fn(),
+  setEventObserved: jest.fn(),
+  getTransactions: jest.fn(),
   checkTrialOrIntroductoryPriceEligibility: jest.fn(),
+  checkTrialOrIntroductoryPriceEligibilityStreaming: jest.fn(),
   purchaseDiscountedPackage: jest.fn(),
   purchaseDiscountedProduct: jest.fn(),
   getPaymentDiscount: jest.fn(),
   invalidatePurchaserInfoCache: jest.fn(),
   setAttributes: jest.fn(),
+  setAttributesBatch: jest.fn(),
   setEmail: jest.fn(),
   setPhoneNumber: jest.fn(),
   setDisplayName: jest.fn(),
@@ -118,6 +118,58 @@ export enum INTRO_ELIGIBILITY_STATUS {
   INTRO_ELIGIBILITY_STATUS_ELIGIBLE
 }
 
+export enum OFFERINGS_CACHE_POLICY {
+  /**
+   * Always fetch the offerings and wait for the response.
+   */
+  FETCH = "fetch",
+  /**
+   * Resolve right away with the offerings stored from the last fetch, if there are any, and refresh them in the
+   * background. Refreshed offerings are sent to the listeners added with addOfferingsUpdateListener.
+   */
+  STALE_WHILE_REVALIDATE = "staleWhileRevalidate",
+}
+
+export enum PAYLOAD_ENCODING {
+  /**
+   * Offerings and purchaser info are sent over the bridge as maps.
+   */
+  MAP = "map",
+  /**
+   * Offerings and purchaser info are sent with every key interned, and decoded back into the same objects in JS.
+   * Much smaller bridge messages for large offerings and long transaction histories.
+   */
+  COMPACT = "compact",
+}
+
+export enum PURCHASER_INFO_MODE {
+  /**
+   * Purchaser infos are sent with every field.
+   */
+  FULL = "full",
+  /**
+   * allExpirationDates, allPurchaseDates and nonSubscriptionTransactions, which grow with every purchase, are sent
+   * empty. isSummary is true and nonSubscriptionTransactionCount has the number of transactions, page through them
+   * with getTransactions.
+   */
+  SUMMARY = "summary",
+}
+
+export enum RESTORE_PROGRESS_STAGE {
+  /**
+   * The restore started, the store history is being synced.
+   */
+  STARTED = "started",
+  /**
+   * The SDK restored the purchases, purchasedProductCount is known and the purchaser info is being converted.
+   */
+  RESTORED = "restored",
+  /**
+   * The purchaser info was converted, the promise resolves right after.
+   */
+  PROCESSED = "processed",
+}
+
 /**
  * The EntitlementInfo object gives you access to all of the information about the status of a user entitlement.
  */
@@ -143,15 +195,30 @@ export interface PurchasesEntitlementInfo {
    * The latest purchase or renewal date for the entitlement.
    */
   readonly latestPurchaseDate: string;
+  /**
+   * latestPurchaseDate in milliseconds since the epoch, to compare without parsing the date string.
+   * Missing only if the native date couldn't be parsed.
+   */
+  readonly latestPurchaseDateMillis?: number;
   /**
    * The first date this entitlement was purchased.
    */
   readonly originalPurchaseDate: string;
+  /**
+   * originalPurchaseDate in milliseconds since the epoch, to compare without parsing the date string.
+   * Missing only if the native date couldn't be parsed.
+   */
+  readonly originalPurchaseDateMillis?: number;
   /**
    * The expiration date for the entitlement, can be `null` for lifetime access. If the `periodType` is `trial`,
    * this is the trial expiration date.
    */
   readonly expirationDate: string | null;
+  /**
+   * expirationDate in milliseconds since the epoch, to compare without parsing the date string.
+   * Missing only if the native date couldn't be parsed.
+   */
+  readonly expirationDateMillis?: number | null;
   /**
    * The store where this entitlement was unlocked from. Either: appStore, macAppStore, playStore, stripe,
    * promotional, unknownStore
@@ -171,12 +238,22 @@ export interface PurchasesEntitlementInfo {
    * @note: Entitlement may still be active even if user has unsubscribed. Check the `isActive` property.
    */
   readonly unsubscribeDetectedAt: string | null;
+  /**
+   * unsubscribeDetectedAt in milliseconds since the epoch, to compare without parsing the date string.
+   * Missing only if the native date couldn't be parsed.
+   */
+  readonly unsubscribeDetectedAtMillis?: number | null;
   /**
    * The date a billing issue was detected. Can be `null` if there is no billing issue or an issue has been resolved
    *
    * @note: Entitlement may still be active even if there is a billing issue. Check the `isActive` property.
    */
   readonly billingIssueDetectedAt: string | null;
+  /**
+   * billingIssueDetectedAt in milliseconds since the epoch, to compare without parsing the date string.
+   * Missing only if the native date couldn't be parsed.
+   */
+  readonly billingIssueDetectedAtMillis?: number | null;
 }
 
 /**
@@ -210,10 +287,20 @@ export interface PurchaserInfo {
    * The latest expiration date of all purchased skus
    */
   readonly latestExpirationDate: string | null;
+  /**
+   * latestExpirationDate in milliseconds since the epoch, to compare without parsing the date string.
+   * Missing only if the native date couldn't be parsed.
+   */
+  readonly latestExpirationDateMillis?: number | null;
   /**
    * The date this user was first seen in RevenueCat.
    */
   readonly firstSeen: string;
+  /**
+   * firstSeen in milliseconds since the epoch, to compare without parsing the date string.
+   * Missing only if the native date couldn't be parsed.
+   */
+  readonly firstSeenMillis?: number;
   /**
    * The original App User Id recorded for this user.
    */
@@ -222,6 +309,11 @@ export interface PurchaserInfo {
    * Date when this info was requested
    */
   readonly requestDate: string;
+  /**
+   * requestDate in milliseconds since the epoch, to compare without parsing the date string.
+   * Missing only if the native date couldn't be parsed.
+   */
+  readonly requestDateMillis?: number;
   /**
    * Map of skus to expiration dates
    */
@@ -245,6 +337,11 @@ export interface PurchaserInfo {
    * Use this for grandfathering users when migrating to subscriptions.
    */
   readonly originalPurchaseDate: string | null;
+  /**
+   * originalPurchaseDate in milliseconds since the epoch, to compare without parsing the date string.
+   * Missing only if the native date couldn't be parsed.
+   */
+  readonly originalPurchaseDateMillis?: number | null;
   /**
    * URL to manage the active subscription of the user. If this user has an active iOS
    * subscription, this will point to the App Store, if the user has an active Play Store subscription
@@ -258,6 +355,14 @@ export interface PurchaserInfo {
    * non-subscription purchases
    */
   readonly nonSubscriptionTransactions: [PurchasesTransaction];
+  /**
+   * True when the purchaser info was sent in PURCHASER_INFO_MODE.SUMMARY, see setPurchaserInfoMode.
+   */
+  readonly isSummary?: boolean;
+  /**
+   * Number of non subscription transactions, only sent in PURCHASER_INFO_MODE.SUMMARY.
+   */
+  readonly nonSubscriptionTransactionCount?: number;
 }
 
 export interface PurchasesTransaction {
@@ -489,6 +594,197 @@ export interface PurchasesOfferings {
   readonly current: PurchasesOffering | null;
 }
 
+/**
+ * Options for getOfferings
+ */
+export interface GetOfferingsOptions {
+  /**
+   * The [OFFERINGS_CACHE_POLICY] to use. FETCH by default.
+   */
+  readonly cachePolicy?: OFFERINGS_CACHE_POLICY;
+}
+
+/**
+ * Options for getProductsBatch
+ */
+export interface GetProductsBatchOptions {
+  /**
+   * Types of products to look the identifiers up as, in parallel. Subs and inapp by default. Ignored on iOS.
+   */
+  readonly types?: PURCHASE_TYPE[];
+}
+
+/**
+ * Options for getPurchaserInfo
+ */
+export interface GetPurchaserInfoOptions {
+  /**
+   * Leave allPurchasedProductIdentifiers, allExpirationDates, allPurchaseDates, nonSubscriptionTransactions and
+   * entitlements.all out of the bridge call, and fetch each of them synchronously the first time it's read.
+   * Not available when debugging remotely. Only the last 16 lazy purchaser infos keep their fields, reading a field
+   * that wasn't read yet on an older one throws. False by default.
+   */
+  readonly lazy?: boolean;
+}
+
+/**
+ * Options for getTransactions
+ */
+export interface GetTransactionsOptions {
+  /**
+   * nextCursor of the previous page. The first page by default.
+   */
+  readonly after?: string | null;
+  /**
+   * Maximum number of transactions in the page, 50 by default.
+   */
+  readonly limit?: number;
+}
+
+/**
+ * A page of the non subscription transactions of the purchaser info, in the order the SDK lists them.
+ */
+export interface PurchasesTransactionsPage {
+  readonly transactions: PurchasesTransaction[];
+  /**
+   * Pass as after to get the next page, null on the last page.
+   */
+  readonly nextCursor: string | null;
+  /**
+   * Number of non subscription transactions of the purchaser info.
+   */
+  readonly totalCount: number;
+}
+
+/**
+ * Options for addPurchaserInfoUpdateListener. Without any, the listener is called on every update.
+ */
+export interface PurchaserInfoUpdateListenerOptions {
+  /**
+   * Call the listener at most once per animation frame, with the latest purchaser info.
+   */
+  readonly coalesceToAnimationFrame?: boolean;
+  /**
+   * Call the listener with the latest purchaser info once no update has arrived for this many milliseconds.
+   * Takes precedence over coalesceToAnimationFrame.
+   */
+  readonly debounceMillis?: number;
+}
+
+/**
+ * Returned when adding a listener
+ */
+export interface ListenerSubscription {
+  /**
+   * Removes the listener, same as calling the matching remove method with it
+   */
+  remove(): void;
+}
+
+/**
+ * Lookups of product identifiers by getProducts and getProductsBatch that were served from the native product
+ * cache, and the ones that had to go to the store
+ */
+export interface ProductCacheStats {
+  readonly hits: number;
+  readonly misses: number;
+}
+
+/**
+ * Number of calls that were given the result of an identical request already in flight, by method
+ */
+export interface CoalescedRequestCounts {
+  readonly getPurchaserInfo: number;
+  readonly getOfferings: number;
+  readonly getProductInfo: number;
+}
+
+/**
+ * Distribution of a performance measurement
+ */
+export interface PerformanceHistogram {
+  readonly count: number;
+  readonly sum: number;
+  readonly min: number;
+  readonly max: number;
+  /**
+   * Inclusive upper bounds of the buckets. bucketCounts has one more entry, for the values above the last bound.
+   */
+  readonly bucketUpperBounds: number[];
+  readonly bucketCounts: number[];
+}
+
+/**
+ * Performance measurements of a native method
+ */
+export interface MethodPerformanceMetrics {
+  /**
+   * From the JS call to the promise settling, in milliseconds.
+   */
+  readonly totalMillis: PerformanceHistogram;
+  /**
+   * From the native module receiving the call to the SDK calling back, in milliseconds.
+   */
+  readonly nativeMillis: PerformanceHistogram;
+  /**
+   * Converting the result to send it over the bridge, in milliseconds. Always 0 on iOS, where the result is passed to
+   * the bridge as it is.
+   */
+  readonly conversionMillis: PerformanceHistogram;
+  /**
+   * From the SDK calling back to the native module resolving the promise, conversion included, in milliseconds.
+   */
+  readonly resolveMillis: PerformanceHistogram;
+  /**
+   * Size of the result serialized as JSON, in bytes.
+   */
+  readonly payloadBytes: PerformanceHistogram;
+  /**
+   * Operations replayed by each flush of the queue of operations made offline. Only measured for
+   * flushOperationQueue, where nativeMillis is how long the flush took.
+   */
+  readonly queueDepth?: PerformanceHistogram;
+  /**
+   * iOS only. Time the call kept the main thread busy, in milliseconds. Only measured for setupPurchases and the
+   * purchase methods, the only parts of a call that still run on the main queue.
+   */
+  readonly mainThreadMillis?: PerformanceHistogram;
+}
+
+/**
+ * Performance measurements by native method name
+ */
+export type PerformanceMetrics = { [method: string]: MethodPerformanceMetrics };
+
+/**
+ * Requests to start as soon as Purchases is set up
+ */
+export interface PrewarmOptions {
+  /**
+   * Fetch the offerings.
+   */
+  readonly offerings?: boolean;
+  /**
+   * Fetch the subscription products with these identifiers.
+   */
+  readonly productIdentifiers?: string[];
+  /**
+   * Check the intro eligibility of the products in the offerings and in productIdentifiers. Implies offerings.
+   */
+  readonly eligibility?: boolean;
+}
+
+/**
+ * Options for setup
+ */
+export interface SetupOptions {
+  /**
+   * Requests to start right after setup. Calls to getOfferings, getProducts and
+   * checkTrialOrIntroductoryPriceEligibility made while they are in flight wait for them instead of making new ones.
+   */
+  readonly prewarm?: PrewarmOptions;
+}
+
 export interface PurchasesError {
   code: number;
   message: string;
@@ -524,6 +820,21 @@ export interface IntroEligibility {
   readonly description: string;
 }
 
+/**
+ * Progress of restoreTransactionsWithProgress
+ */
+export interface RestoreProgress {
+  readonly stage: RESTORE_PROGRESS_STAGE;
+  /**
+   * Number of purchased products processed so far, all of them once PROCESSED
+   */
+  readonly processedProductCount: number;
+  /**
+   * Number of products the purchaser info has purchases of, 0 until RESTORED
+   */
+  readonly purchasedProductCount: number;
+}
+
 export interface PurchasesPaymentDiscount {
   readonly identifier: string;
   readonly keyIdentifier: string;
@@ -532,49 +843,521 @@ export interface PurchasesPaymentDiscount {
   readonly timestamp: number;
 }
 
+/**
+ * A package whose product, and discount if any, were looked up ahead of time by preparePurchase, so
+ * purchasePreparedPurchase goes straight to the store.
+ */
+export interface PreparedPurchase {
+  /**
+   * Identifies the prepared purchase natively. It can be purchased once, and expires after 10 minutes.
+   */
+  readonly handle: number;
+  readonly productIdentifier: string;
+  /**
+   * iOS only. The signed discount, when preparePurchase was called with one.
+   */
+  readonly paymentDiscount: PurchasesPaymentDiscount | null;
+}
+
+/**
+ * Subscriber attributes to set with a single call to setAttributesBatch. Attributes that are not present are left
+ * untouched. Empty Strings or null will delete the subscriber attribute.
+ */
+export interface SubscriberAttributesBatch {
+  /**
+   * Map of custom attributes by key. Same as calling setAttributes.
+   */
+  readonly attributes?: { [key: string]: string | null };
+  readonly email?: string | null;
+  readonly phoneNumber?: string | null;
+  readonly displayName?: string | null;
+  readonly pushToken?: string | null;
+  readonly adjustID?: string | null;
+  readonly appsflyerID?: string | null;
+  readonly fbAnonymousID?: string | null;
+  readonly mparticleID?: string | null;
+  readonly onesignalID?: string | null;
+  readonly mediaSource?: string | null;
+  readonly campaign?: string | null;
+  readonly adGroup?: string | null;
+  readonly ad?: string | null;
+  readonly keyword?: string | null;
+  readonly creative?: string | null;
+  /**
+   * Set to true to also collect the device identifiers. Same as calling collectDeviceIdentifiers.
+   */
+  readonly collectDeviceIdentifiers?: boolean;
+}
+
 /**
  * Listener used on updated purchaser info
  * @callback PurchaserInfoUpdateListener
  * @param {Object} purchaserInfo Object containing info for the purchaser
  */
 export type PurchaserInfoUpdateListener = (purchaserInfo: PurchaserInfo) => void;
-export type ShouldPurchasePromoProductListener = (deferredPurchase: () => MakePurchasePromise) => void;
+/**
+ * Listener used on promotional purchases initiated from the App Store
+ * @callback ShouldPurchasePromoProductListener
+ * @param {Function} deferredPurchase Makes the promotional purchase. Rejects if the purchase was already made,
+ * released, expired after an hour, or was dropped after 32 newer promotional purchases.
+ * @param {number} callbackID Identifies the deferred purchase, pass it to releaseDeferredPurchase if the purchase won't
+ * be made. Listeners that only take deferredPurchase can leave it out.
+ */
+export type ShouldPurchasePromoProductListener = (
+  deferredPurchase: () => MakePurchasePromise,
+  callbackID: number
+) => void;
+/**
+ * Listener used on updated offerings
+ * @callback OfferingsUpdateListener
+ * @param {Object} offerings Object containing the refreshed offerings
+ */
+export type OfferingsUpdateListener = (offerings: PurchasesOfferings) => void;
+/**
+ * Listener used when identify, resolved with a recently identified user's purchaser info, failed to switch the SDK to
+ * that user. The SDK stays on the previous user.
+ * @callback IdentifyFailedListener
+ * @param {String} appUserID The appUserID that couldn't be switched to
+ * @param {Object} error The error of the identify call
+ */
+export type IdentifyFailedListener = (appUserID: string, error: PurchasesError) => void;
+/**
+ * Listener used on updated performance metrics
+ * @callback PerformanceMetricsListener
+ * @param {Object} metrics Performance measurements by native method name
+ */
+export type PerformanceMetricsListener = (metrics: PerformanceMetrics) => void;
+/**
+ * Listener used on eligibilities streamed by checkTrialOrIntroductoryPriceEligibilityStreaming
+ * @callback IntroEligibilityListener
+ * @param {Object} eligibilities IntroEligibility of some of the requested products, by product identifier
+ */
+export type IntroEligibilityListener = (eligibilities: { [productId: string]: IntroEligibility }) => void;
+/**
+ * Listener used on the progress of restoreTransactionsWithProgress
+ * @callback RestoreProgressListener
+ * @param {Object} progress RestoreProgress with the stage the restore got to
+ */
+export type RestoreProgressListener = (progress: RestoreProgress) => void;
+type NativeMetricsSample = {
+  method: string;
+  nativeEntry: number;
+  sdkCompletion: number;
+  conversionMillis: number;
+  resolve: number;
+  payloadBytes: number;
+  queueDepth?: number;
+  mainThreadMillis?: number;
+};
+type HistogramData = {
+  count: number;
+  sum: number;
+  min: number;
+  max: number;
+  bucketUpperBounds: number[];
+  bucketCounts: number[];
+};
 type MakePurchasePromise = Promise<{ productIdentifier: string; purchaserInfo: PurchaserInfo; }>;
+type PurchaserInfoUpdateDispatcher = {
+  dispatch: PurchaserInfoUpdateListener;
+  cancel: () => void;
+};
 
-let purchaserInfoUpdateListeners: PurchaserInfoUpdateListener[] = [];
+const purchaserInfoUpdateListeners = new Map<PurchaserInfoUpdateListener, PurchaserInfoUpdateDispatcher>();
 let shouldPurchasePromoProductListeners: ShouldPurchasePromoProductListener[] = [];
+let offeringsUpdateListeners: OfferingsUpdateListener[] = [];
+let identifyFailedListeners: IdentifyFailedListener[] = [];
+const inFlightRequests: { [key: string]: Promise<any> | undefined } = {};
+const coalescedRequestCounts: { [method: string]: number } = {
+  getPurchaserInfo: 0,
+  getOfferings: 0,
+  getProductInfo: 0,
+};
+let pendingAttributesBatch: { [key: string]: any } | null = null;
+let performanceMetricsEnabled = false;
+let performanceMetricsListeners: PerformanceMetricsListener[] = [];
+const introEligibilityListeners = new Map<number, IntroEligibilityListener>();
+let lastIntroEligibilityRequestID = 0;
+const restoreProgressListeners = new Map<number, RestoreProgressListener>();
+let lastRestoreRequestID = 0;
+const performanceMetrics: { [method: string]: { [measurement: string]: HistogramData } } = {};
+const MILLIS_BUCKET_UPPER_BOUNDS = [1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000];
+const BYTES_BUCKET_UPPER_BOUNDS = [1024, 4096, 16384, 65536, 262144, 1048576];
+const QUEUE_DEPTH_BUCKET_UPPER_BOUNDS = [1, 2, 5, 10, 20, 50, 100, 200, 500, 1000];
+const DEFAULT_TRANSACTIONS_PAGE_SIZE = 50;
+
+// Date.now() is already UTC, there's no need to build a Date for now
+export const isUTCDateStringFuture = (dateString: string) => Date.now() < Date.parse(dateString);
 
-export const isUTCDateStringFuture = (dateString: string) => {
-  const date = new Date(dateString);
-  const dateUtcMillis = date.valueOf();
-  const now = new Date();
-  const nowUtcMillis = Date.UTC(
-    now.getUTCFullYear(),
-    now.getUTCMonth(),
-    now.getUTCDate(),
-    now.getUTCHours(),
-    now.getUTCMinutes(),
-    now.getUTCSeconds(),
-    now.getUTCMilliseconds()
-  );
-  return nowUtcMillis < dateUtcMillis;
+/**
+ * Evaluates which entitlements are active, comparing every expiration date against a single Date.now(). Unlike
+ * entitlements.active, the result follows the clock instead of reflecting when the purchaser info was fetched.
+ * @param {PurchaserInfo} purchaserInfo The purchaser info to evaluate
+ * @param {number} nowMillis Optional time to evaluate at, in milliseconds since the epoch. Now by default
+ * @returns {{ [key: string]: PurchasesEntitlementInfo }} The entitlements that don't expire or expire after
+ * nowMillis, keyed by entitlement identifier
+ */
+export const getActiveEntitlements = (
+  purchaserInfo: PurchaserInfo,
+  nowMillis: number = Date.now()
+): { [key: string]: PurchasesEntitlementInfo } => {
+  const all = purchaserInfo.entitlements.all;
+  const active: { [key: string]: PurchasesEntitlementInfo } = {};
+  Object.keys(all).forEach(identifier => {
+    const entitlement = all[identifier];
+    let expirationDateMillis = entitlement.expirationDateMillis;
+    if (expirationDateMillis === undefined) {
+      expirationDateMillis = entitlement.expirationDate === null ? null : Date.parse(entitlement.expirationDate);
+    }
+    if (expirationDateMillis === null || expirationDateMillis > nowMillis) {
+      active[identifier] = entitlement;
+    }
+  });
+  return active;
+};
+
+const emptyHistogram = (bucketUpperBounds: number[]): HistogramData => ({
+  count: 0,
+  sum: 0,
+  min: 0,
+  max: 0,
+  bucketUpperBounds,
+  bucketCounts: bucketUpperBounds.map(() => 0).concat([0]),
+});
+
+const recordMeasurement = (method: string, measurement: keyof MethodPerformanceMetrics, value: number) => {
+  if (!performanceMetrics[method]) {
+    performanceMetrics[method] = {
+      totalMillis: emptyHistogram(MILLIS_BUCKET_UPPER_BOUNDS),
+      nativeMillis: emptyHistogram(MILLIS_BUCKET_UPPER_BOUNDS),
+      conversionMillis: emptyHistogram(MILLIS_BUCKET_UPPER_BOUNDS),
+      resolveMillis: emptyHistogram(MILLIS_BUCKET_UPPER_BOUNDS),
+      payloadBytes: emptyHistogram(BYTES_BUCKET_UPPER_BOUNDS),
+    };
+  }
+  // the queue depth and main thread time are only measured for some methods, their histograms are added with the
+  // first measurement
+  if (!performanceMetrics[method][measurement]) {
+    performanceMetrics[method][measurement] = emptyHistogram(
+      measurement === "queueDepth" ? QUEUE_DEPTH_BUCKET_UPPER_BOUNDS : MILLIS_BUCKET_UPPER_BOUNDS
+    );
+  }
+  const histogram = performanceMetrics[method][measurement];
+  histogram.min = histogram.count === 0 ? value : Math.min(histogram.min, value);
+  histogram.max = histogram.count === 0 ? value : Math.max(histogram.max, value);
+  histogram.count += 1;
+  histogram.sum += value;
+  const bucket = histogram.bucketUpperBounds.findIndex(upperBound => value <= upperBound);
+  histogram.bucketCounts[bucket === -1 ? histogram.bucketUpperBounds.length : bucket] += 1;
+};
+
+const copyPerformanceMetrics = (): PerformanceMetrics => JSON.parse(JSON.stringify(performanceMetrics));
+
+// Times the native call from JS when performance metrics are enabled, the native side sends the rest
+const measure = <T>(method: string, promise: Promise<T>): Promise<T> => {
+  if (!performanceMetricsEnabled) {
+    return promise;
+  }
+  const callTime = Date.now();
+  const record = () => recordMeasurement(method, "totalMillis", Date.now() - callTime);
+  promise.then(record, record);
+  return promise;
+};
+
+// Compact payloads are { compactKeys, compactValue }. In compactValue maps are [0, keyIndex, value, ...] and lists
+// [1, value, ...], with every key replaced by its index in compactKeys
+const COMPACT_MAP = 0;
+const decodeCompactValue = (value: any, keys: string[]): any => {
+  if (!Array.isArray(value)) {
+    return value;
+  }
+  if (value[0] === COMPACT_MAP) {
+    const map: { [key: string]: any } = {};
+    for (let i = 1; i < value.length; i += 2) {
+      map[keys[value[i]]] = decodeCompactValue(value[i + 1], keys);
+    }
+    return map;
+  }
+  const list = new Array(value.length - 1);
+  for (let j = 1; j < value.length; j++) {
+    list[j - 1] = decodeCompactValue(value[j], keys);
+  }
+  return list;
+};
+
+const decodePayload = (payload: any) =>
+  payload && payload.compactKeys ? decodeCompactValue(payload.compactValue, payload.compactKeys) : payload;
+
+// Bursts of updates, like the ones during a restore, only reach coalesced listeners with the latest purchaser info
+const createPurchaserInfoUpdateDispatcher = (
+  listener: PurchaserInfoUpdateListener,
+  options?: PurchaserInfoUpdateListenerOptions
+): PurchaserInfoUpdateDispatcher => {
+  const debounceMillis = options && options.debounceMillis;
+  if (!debounceMillis && !(options && options.coalesceToAnimationFrame)) {
+    return { dispatch: listener, cancel: () => undefined };
+  }
+  let latestPurchaserInfo: PurchaserInfo;
+  let cancelPending: (() => void) | null = null;
+  const flush = () => {
+    cancelPending = null;
+    listener(latestPurchaserInfo);
+  };
+  const cancel = () => {
+    if (cancelPending) {
+      cancelPending();
+      cancelPending = null;
+    }
+  };
+  return {
+    dispatch: purchaserInfo => {
+      latestPurchaserInfo = purchaserInfo;
+      if (debounceMillis) {
+        cancel();
+        const timeout = setTimeout(flush, debounceMillis);
+        cancelPending = () => clearTimeout(timeout);
+      } else if (!cancelPending) {
+        const frame = requestAnimationFrame(flush);
+        cancelPending = () => cancelAnimationFrame(frame);
+      }
+    },
+    cancel,
+  };
+};
+
+const requestKey = (method: string, args: any[]) => method + ":" + JSON.stringify(args);
+
+const trackInFlight = <T>(key: string, promise: Promise<T>): Promise<T> => {
+  inFlightRequests[key] = promise;
+  const clear = () => {
+    if (inFlightRequests[key] === promise) {
+      delete inFlightRequests[key];
+    }
+  };
+  promise.then(clear, clear);
+  return promise;
 };
 
-eventEmitter.addListener(
-  "Purchases-PurchaserInfoUpdated",
-  (purchaserInfo: PurchaserInfo) => {
-    purchaserInfoUpdateListeners.forEach(listener => listener(purchaserInfo));
+// The purchaser info and offerings in flight were requested for the app user being replaced, they aren't shared with
+// the requests made for the next one
+const forgetAppUserRequests = () => {
+  Object.keys(inFlightRequests).forEach(key => {
+    if (key.startsWith("getPurchaserInfo:") || key.startsWith("getOfferings:")) {
+      delete inFlightRequests[key];
+    }
+  });
+};
+
+const changeAppUser = <T>(change: () => Promise<T>): Promise<T> => {
+  forgetAppUserRequests();
+  const changed = change();
+  changed.then(forgetAppUserRequests, forgetAppUserRequests);
+  return changed;
+};
+
+// Concurrent identical calls share the request already in flight instead of crossing the bridge again
+const singleFlight = <T>(method: string, args: any[], request: () => Promise<T>): Promise<T> => {
+  const inFlight = inFlightRequests[requestKey(method, args)];
+  if (inFlight) {
+    coalescedRequestCounts[method] += 1;
+    return inFlight;
   }
-);
+  return trackInFlight(requestKey(method, args), request());
+};
 
-eventEmitter.addListener(
-  "Purchases-ShouldPurchasePromoProduct",
-  ({ callbackID }: { callbackID: number }) => {
-    shouldPurchasePromoProductListeners.forEach(listener =>
-      listener(() => RNPurchases.makeDeferredPurchase(callbackID))
+// Same as the number of handles kept natively by getPurchaserInfoLazy
+const MAX_LAZY_PURCHASER_INFOS = 16;
+
+// Turns the fields left out by getPurchaserInfoLazy into getters that fetch them from native when first read
+const withLazyFields = (lazyPurchaserInfo: { [key: string]: any }): PurchaserInfo => {
+  const handle: number = lazyPurchaserInfo.lazyFieldsHandle;
+  const fields: string[] = lazyPurchaserInfo.lazyFields;
+  delete lazyPurchaserInfo.lazyFieldsHandle;
+  delete lazyPurchaserInfo.lazyFields;
+  fields.forEach(field => {
+    const path = field.split(".");
+    const key = path.pop() as string;
+    const owner = path.reduce((object, pathKey) => object && object[pathKey], lazyPurchaserInfo);
+    if (!owner) {
+      return;
+    }
+    Object.defineProperty(owner, key, {
+      configurable: true,
+      enumerable: true,
+      get: () => {
+        const result = RNPurchases.getPurchaserInfoField(handle, field);
+        if (result.evicted) {
+          throw new Error(
+            `${field} of this lazy purchaser info was released after ${MAX_LAZY_PURCHASER_INFOS} newer ones were fetched, ` +
+              "read it before calling getPurchaserInfo({lazy: true}) again or get a new purchaser info"
+          );
+        }
+        const value = result.value;
+        Object.defineProperty(owner, key, { configurable: true, enumerable: true, value });
+        return value;
+      },
+    });
+  });
+  return lazyPurchaserInfo as PurchaserInfo;
+};
+
+const productIdentifiersInOfferings = (offerings: PurchasesOfferings) => {
+  const productIdentifiers: string[] = [];
+  Object.keys(offerings.all).forEach(offeringIdentifier => {
+    offerings.all[offeringIdentifier].availablePackages.forEach(aPackage => {
+      if (!productIdentifiers.includes(aPackage.product.identifier)) {
+        productIdentifiers.push(aPackage.product.identifier);
+      }
+    });
+  });
+  return productIdentifiers;
+};
+
+const prewarm = (options: PrewarmOptions) => {
+  const productIdentifiers = options.productIdentifiers || [];
+  if (productIdentifiers.length > 0) {
+    trackInFlight(
+      requestKey("getProductInfo", [productIdentifiers, PURCHASE_TYPE.SUBS]),
+      measure("getProductInfo", RNPurchases.getProductInfo(productIdentifiers, PURCHASE_TYPE.SUBS))
+    );
+  }
+  if (options.offerings || options.eligibility) {
+    const offerings: Promise<PurchasesOfferings> = trackInFlight(
+      requestKey("getOfferings", []),
+      measure("getOfferings", RNPurchases.getOfferings().then(decodePayload))
     );
+    if (options.eligibility) {
+      trackInFlight(
+        "checkTrialOrIntroductoryPriceEligibility",
+        offerings.then(fetchedOfferings => {
+          const eligibilityProductIdentifiers = productIdentifiersInOfferings(fetchedOfferings);
+          productIdentifiers.forEach(productIdentifier => {
+            if (!eligibilityProductIdentifiers.includes(productIdentifier)) {
+              eligibilityProductIdentifiers.push(productIdentifier);
+            }
+          });
+          return measure(
+            "checkTrialOrIntroductoryPriceEligibility",
+            RNPurchases.checkTrialOrIntroductoryPriceEligibility(eligibilityProductIdentifiers)
+          );
+        })
+      );
+    }
   }
-);
+};
+
+const flushAttributesBatch = () => {
+  const batch = pendingAttributesBatch;
+  pendingAttributesBatch = null;
+  RNPurchases.setAttributesBatch(batch);
+};
+
+// Native events are only subscribed to while something listens to them, so loading the module doesn't register
+// anything with the bridge on screens that never use purchases. Native is told which events are observed so it
+// doesn't convert the others
+const nativeEventSubscriptions: { [eventName: string]: ListenerSubscription | undefined } = {};
+
+const setNativeEventSubscribed = (eventName: string, handler: (body: any) => void, subscribed: boolean) => {
+  const subscription = nativeEventSubscriptions[eventName];
+  if (subscribed && !subscription) {
+    nativeEventSubscriptions[eventName] = eventEmitter.addListener(eventName, handler);
+  } else if (!subscribed && subscription) {
+    subscription.remove();
+    nativeEventSubscriptions[eventName] = undefined;
+  } else {
+    return;
+  }
+  RNPurchases.setEventObserved(eventName, subscribed);
+};
+
+const onPurchaserInfoUpdated = (payload: any) => {
+  const purchaserInfo: PurchaserInfo = decodePayload(payload);
+  purchaserInfoUpdateListeners.forEach(dispatcher => dispatcher.dispatch(purchaserInfo));
+};
+
+// Same as the number of deferment blocks kept natively on iOS, the oldest ones are dropped
+const MAX_DEFERRED_PURCHASES = 32;
+let pendingDeferredPurchases: number[] = [];
+
+const removePendingDeferredPurchase = (callbackID: number) => {
+  const pending = pendingDeferredPurchases.includes(callbackID);
+  pendingDeferredPurchases = pendingDeferredPurchases.filter(pendingCallbackID => pendingCallbackID !== callbackID);
+  return pending;
+};
+
+const makeDeferredPurchase = (callbackID: number): MakePurchasePromise => {
+  if (!removePendingDeferredPurchase(callbackID)) {
+    return Promise.reject(new Error("The deferred purchase was already made, released or dropped"));
+  }
+  return RNPurchases.makeDeferredPurchase(callbackID);
+};
+
+const onShouldPurchasePromoProduct = ({ callbackID }: { callbackID: number }) => {
+  removePendingDeferredPurchase(callbackID);
+  pendingDeferredPurchases.push(callbackID);
+  if (pendingDeferredPurchases.length > MAX_DEFERRED_PURCHASES) {
+    pendingDeferredPurchases.shift();
+  }
+  shouldPurchasePromoProductListeners.forEach(listener =>
+    listener(() => makeDeferredPurchase(callbackID), callbackID)
+  );
+};
+
+const onOfferingsUpdated = (payload: any) => {
+  const offerings: PurchasesOfferings = decodePayload(payload);
+  offeringsUpdateListeners.forEach(listener => listener(offerings));
+};
+
+const onIdentifyFailed = ({ appUserID, error }: { appUserID: string; error: PurchasesError }) => {
+  identifyFailedListeners.forEach(listener => listener(appUserID, error));
+};
+
+const onMetricsSample = (sample: NativeMetricsSample) => {
+  recordMeasurement(sample.method, "nativeMillis", sample.sdkCompletion - sample.nativeEntry);
+  recordMeasurement(sample.method, "conversionMillis", sample.conversionMillis);
+  recordMeasurement(sample.method, "resolveMillis", sample.resolve - sample.sdkCompletion);
+  recordMeasurement(sample.method, "payloadBytes", sample.payloadBytes);
+  if (sample.queueDepth !== undefined) {
+    recordMeasurement(sample.method, "queueDepth", sample.queueDepth);
+  }
+  if (sample.mainThreadMillis !== undefined) {
+    recordMeasurement(sample.method, "mainThreadMillis", sample.mainThreadMillis);
+  }
+  if (performanceMetricsListeners.length > 0) {
+    const metrics = copyPerformanceMetrics();
+    performanceMetricsListeners.forEach(listener => listener(metrics));
+  }
+};
+
+const onIntroEligibility = ({
+  requestID,
+  eligibilities,
+}: {
+  requestID: number;
+  eligibilities: { [productId: string]: IntroEligibility };
+}) => {
+  const listener = introEligibilityListeners.get(requestID);
+  if (listener) {
+    listener(eligibilities);
+  }
+};
+
+const onRestoreProgress = ({
+  requestID,
+  stage,
+  processedProductCount,
+  purchasedProductCount,
+}: {
+  requestID: number;
+  stage: RESTORE_PROGRESS_STAGE;
+  processedProductCount: number;
+  purchasedProductCount: number;
+}) => {
+  const listener = restoreProgressListeners.get(requestID);
+  if (listener) {
+    listener({ stage, processedProductCount, purchasedProductCount });
+  }
+};
 
 export default class Purchases {
   /**
@@ -621,6 +1404,34 @@ export default class Purchases {
    */
   public static INTRO_ELIGIBILITY_STATUS = INTRO_ELIGIBILITY_STATUS;
 
+  /**
+   * Cache policies that can be used when getting offerings.
+   * @readonly
+   * @enum {string}
+   */
+  public static OFFERINGS_CACHE_POLICY = OFFERINGS_CACHE_POLICY;
+
+  /**
+   * Encodings that can be used to send offerings and purchaser info over the bridge.
+   * @readonly
+   * @enum {string}
+   */
+  public static PAYLOAD_ENCODING = PAYLOAD_ENCODING;
+
+  /**
+   * Modes that can be used to send purchaser infos over the bridge.
+   * @readonly
+   * @enum {string}
+   */
+  public static PURCHASER_INFO_MODE = PURCHASER_INFO_MODE;
+
+  /**
+   * Stages reported by restoreTransactionsWithProgress.
+   * @readonly
+   * @enum {string}
+   */
+  public static RESTORE_PROGRESS_STAGE = RESTORE_PROGRESS_STAGE;
+
   /**
    * Sets up Purchases with your API key and an app user id.
    * @param {String} apiKey RevenueCat API Key. Needs to be a String
@@ -629,23 +1440,31 @@ export default class Purchases {
    * @param {String?} userDefaultsSuiteName An optional string. iOS-only, will be ignored for Android. 
    * Set this if you would like the RevenueCat SDK to store its preferences in a different NSUserDefaults suite, otherwise it will use standardUserDefaults.
    * Default is null, which will make the SDK use standardUserDefaults.
+   * @param {SetupOptions?} options An optional object. Set prewarm to start fetching offerings, products and intro
+   * eligibility right after setup.
    * @returns {Promise<void>} Returns when setup completes
    */
   public static setup(
     apiKey: string,
     appUserID?: string | null,
     observerMode: boolean = false,
-    userDefaultsSuiteName?: string
+    userDefaultsSuiteName?: string,
+    options?: SetupOptions
   ) {
     if (appUserID !== null && typeof appUserID !== "undefined" && typeof appUserID !== "string") {
       throw new Error("appUserID needs to be a string");
     }
-    return RNPurchases.setupPurchases(
+    const setupPromise = RNPurchases.setupPurchases(
       apiKey,
       appUserID,
       observerMode,
       userDefaultsSuiteName
     );
+    // Native calls run in order, so these start right after the SDK is configured
+    if (options && options.prewarm) {
+      prewarm(options.prewarm);
+    }
+    return setupPromise;
   }
 
   /**
@@ -665,16 +1484,34 @@ export default class Purchases {
   }
 
   /**
-   * Sets a function to be called on updated purchaser info
+   * Sets a function to be called on updated purchaser info. Adding a listener that was already added replaces its
+   * options.
    * @param {PurchaserInfoUpdateListener} purchaserInfoUpdateListener PurchaserInfo update listener
+   * @param {PurchaserInfoUpdateListenerOptions} options Optional options, to only call the listener with the latest
+   * purchaser info once per animation frame or after a debounce
+   * @returns {ListenerSubscription} A subscription to remove the listener with
    */
   public static addPurchaserInfoUpdateListener(
-    purchaserInfoUpdateListener: PurchaserInfoUpdateListener
-  ) {
+    purchaserInfoUpdateListener: PurchaserInfoUpdateListener,
+    options?: PurchaserInfoUpdateListenerOptions
+  ): ListenerSubscription {
     if (typeof purchaserInfoUpdateListener !== "function") {
       throw new Error("addPurchaserInfoUpdateListener needs a function");
     }
-    purchaserInfoUpdateListeners.push(purchaserInfoUpdateListener);
+    const previousDispatcher = purchaserInfoUpdateListeners.get(purchaserInfoUpdateListener);
+    if (previousDispatcher) {
+      previousDispatcher.cancel();
+    }
+    const dispatcher = createPurchaserInfoUpdateDispatcher(purchaserInfoUpdateListener, options);
+    purchaserInfoUpdateListeners.set(purchaserInfoUpdateListener, dispatcher);
+    setNativeEventSubscribed("Purchases-PurchaserInfoUpdated", onPurchaserInfoUpdated, true);
+    return {
+      remove: () => {
+        if (purchaserInfoUpdateListeners.get(purchaserInfoUpdateListener) === dispatcher) {
+          Purchases.removePurchaserInfoUpdateListener(purchaserInfoUpdateListener);
+        }
+      },
+    };
   }
 
   /**
@@ -685,10 +1522,75 @@ export default class Purchases {
   public static removePurchaserInfoUpdateListener(
     listenerToRemove: PurchaserInfoUpdateListener
   ) {
-    if (purchaserInfoUpdateListeners.includes(listenerToRemove)) {
-      purchaserInfoUpdateListeners = purchaserInfoUpdateListeners.filter(
+    const dispatcher = purchaserInfoUpdateListeners.get(listenerToRemove);
+    if (!dispatcher) {
+      return false;
+    }
+    dispatcher.cancel();
+    purchaserInfoUpdateListeners.delete(listenerToRemove);
+    setNativeEventSubscribed(
+      "Purchases-PurchaserInfoUpdated",
+      onPurchaserInfoUpdated,
+      purchaserInfoUpdateListeners.size > 0
+    );
+    return true;
+  }
+
+  /**
+   * Sets a function to be called when offerings refreshed in the background are different from the stored ones
+   * @param {OfferingsUpdateListener} offeringsUpdateListener Offerings update listener
+   */
+  public static addOfferingsUpdateListener(
+    offeringsUpdateListener: OfferingsUpdateListener
+  ) {
+    if (typeof offeringsUpdateListener !== "function") {
+      throw new Error("addOfferingsUpdateListener needs a function");
+    }
+    offeringsUpdateListeners.push(offeringsUpdateListener);
+    setNativeEventSubscribed("Purchases-OfferingsUpdated", onOfferingsUpdated, true);
+  }
+
+  /**
+   * Removes a given OfferingsUpdateListener
+   * @param {OfferingsUpdateListener} listenerToRemove OfferingsUpdateListener reference of the listener to remove
+   * @returns {boolean} True if listener was removed, false otherwise
+   */
+  public static removeOfferingsUpdateListener(
+    listenerToRemove: OfferingsUpdateListener
+  ) {
+    if (offeringsUpdateListeners.includes(listenerToRemove)) {
+      offeringsUpdateListeners = offeringsUpdateListeners.filter(
         listener => listenerToRemove !== listener
       );
+      setNativeEventSubscribed("Purchases-OfferingsUpdated", onOfferingsUpdated, offeringsUpdateListeners.length > 0);
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * Sets a function to be called when identify, resolved with a recently identified user's purchaser info, fails to
+   * switch the SDK to that user. Calls made after identify resolved and before it failed were made for the previous
+   * user.
+   * @param {IdentifyFailedListener} identifyFailedListener Identify failed listener
+   */
+  public static addIdentifyFailedListener(identifyFailedListener: IdentifyFailedListener) {
+    if (typeof identifyFailedListener !== "function") {
+      throw new Error("addIdentifyFailedListener needs a function");
+    }
+    identifyFailedListeners.push(identifyFailedListener);
+    setNativeEventSubscribed("Purchases-IdentifyFailed", onIdentifyFailed, true);
+  }
+
+  /**
+   * Removes a given IdentifyFailedListener
+   * @param {IdentifyFailedListener} listenerToRemove IdentifyFailedListener reference of the listener to remove
+   * @returns {boolean} True if listener was removed, false otherwise
+   */
+  public static removeIdentifyFailedListener(listenerToRemove: IdentifyFailedListener) {
+    if (identifyFailedListeners.includes(listenerToRemove)) {
+      identifyFailedListeners = identifyFailedListeners.filter(listener => listenerToRemove !== listener);
+      setNativeEventSubscribed("Purchases-IdentifyFailed", onIdentifyFailed, identifyFailedListeners.length > 0);
       return true;
     }
     return false;
@@ -701,7 +1603,8 @@ export default class Purchases {
    * the deferredPurchase function. If the app is not in a state to make a purchase: cache the deferredPurchase, then
    * call the deferredPurchase when the app is ready to make the promotional purchase.
    * If the purchase should never be made, you don't need to ever call the deferredPurchase and the app will not
-   * proceed with promotional purchases.
+   * proceed with promotional purchases. Call releaseDeferredPurchase with the callbackID to free it right away,
+   * otherwise it expires after an hour.
    */
   public static addShouldPurchasePromoProductListener(
     shouldPurchasePromoProductListener: ShouldPurchasePromoProductListener
@@ -710,6 +1613,7 @@ export default class Purchases {
       throw new Error("addShouldPurchasePromoProductListener needs a function");
     }
     shouldPurchasePromoProductListeners.push(shouldPurchasePromoProductListener);
+    setNativeEventSubscribed("Purchases-ShouldPurchasePromoProduct", onShouldPurchasePromoProduct, true);
   }
 
   /**
@@ -724,6 +1628,11 @@ export default class Purchases {
       shouldPurchasePromoProductListeners = shouldPurchasePromoProductListeners.filter(
         listener => listenerToRemove !== listener
       );
+      setNativeEventSubscribed(
+        "Purchases-ShouldPurchasePromoProduct",
+        onShouldPurchasePromoProduct,
+        shouldPurchasePromoProductListeners.length > 0
+      );
       return true;
     }
     return false;
@@ -747,10 +1656,25 @@ export default class Purchases {
 
   /**
    * Gets the map of entitlements -> offerings -> products
+   * @param {GetOfferingsOptions} options Optional options. Set cachePolicy to OFFERINGS_CACHE_POLICY.STALE_WHILE_REVALIDATE
+   * to get the offerings stored from the last fetch right away, and have them refreshed in the background.
    * @returns {Promise<PurchasesOfferings>} Promise of entitlements structure
    */
-  public static getOfferings(): Promise<PurchasesOfferings> {
-    return RNPurchases.getOfferings();
+  public static getOfferings(options?: GetOfferingsOptions): Promise<PurchasesOfferings> {
+    if (options && options.cachePolicy === OFFERINGS_CACHE_POLICY.STALE_WHILE_REVALIDATE) {
+      return RNPurchases.getOfferingsStaleWhileRevalidate().then(decodePayload);
+    }
+    return singleFlight("getOfferings", [], () => measure("getOfferings", RNPurchases.getOfferings().then(decodePayload)));
+  }
+
+  /**
+   * Gets the last offerings fetched by getOfferings synchronously, without waiting on the bridge.
+   * Not available when debugging remotely, use getOfferings in that case.
+   * They're cleared by identify, createAlias and reset until the offerings of the new app user are fetched.
+   * @returns {PurchasesOfferings | null} The last fetched offerings, or null if they haven't been fetched yet
+   */
+  public static getCachedOfferingsSync(): PurchasesOfferings | null {
+    return decodePayload(RNPurchases.getCachedOfferingsSync());
   }
 
   /**
@@ -764,7 +1688,29 @@ export default class Purchases {
     productIdentifiers: string[],
     type: PURCHASE_TYPE = PURCHASE_TYPE.SUBS
   ): Promise<PurchasesProduct[]> {
-    return RNPurchases.getProductInfo(productIdentifiers, type);
+    return singleFlight("getProductInfo", [productIdentifiers, type], () =>
+      measure("getProductInfo", RNPurchases.getProductInfo(productIdentifiers, type))
+    );
+  }
+
+  /**
+   * Fetch the product info of a large number of products in a single call. The identifiers are split in chunks
+   * sized to the store limits and every type is queried in parallel, then the results are merged and deduplicated
+   * natively.
+   * @param {String[]} productIdentifiers Array of product identifiers
+   * @param {GetProductsBatchOptions} options Optional options, with the types of products to fetch
+   * @returns {Promise<PurchasesProduct[]>} A promise containing an array of products, in the order of the
+   * identifiers. The promise will be rejected if any of the lookups fails. Rejections return an error code, and a
+   * userInfo object with more information.
+   */
+  public static getProductsBatch(
+    productIdentifiers: string[],
+    options?: GetProductsBatchOptions
+  ): Promise<PurchasesProduct[]> {
+    const types = (options && options.types) || [PURCHASE_TYPE.SUBS, PURCHASE_TYPE.INAPP];
+    return singleFlight("getProductInfo", ["batch", productIdentifiers, types], () =>
+      measure("getProductInfoBatch", RNPurchases.getProductInfoBatch(productIdentifiers, types))
+    );
   }
 
   /**
@@ -820,11 +1766,9 @@ export default class Purchases {
     upgradeInfo?: UpgradeInfo | null,
     type: PURCHASE_TYPE = PURCHASE_TYPE.SUBS
   ): MakePurchasePromise {
-    return RNPurchases.purchaseProduct(
-      productIdentifier,
-      upgradeInfo,
-      type,
-      null
+    return measure(
+      "purchaseProduct",
+      RNPurchases.purchaseProduct(productIdentifier, upgradeInfo, type, null)
     ).catch((error: any) => {
       error.userCancelled = error.code === "1";
       throw error;
@@ -847,11 +1791,9 @@ export default class Purchases {
     if (typeof discount === "undefined" || discount == null) {
       throw new Error("A discount is required");
     }
-    return RNPurchases.purchaseProduct(
-      product.identifier,
-      null,
-      null,
-      discount.timestamp.toString()
+    return measure(
+      "purchaseProduct",
+      RNPurchases.purchaseProduct(product.identifier, null, null, discount.timestamp.toString())
     ).catch((error: any) => {
       error.userCancelled = error.code === "1";
       throw error;
@@ -872,11 +1814,9 @@ export default class Purchases {
     aPackage: PurchasesPackage,
     upgradeInfo?: UpgradeInfo | null
   ): MakePurchasePromise {
-    return RNPurchases.purchasePackage(
-      aPackage.identifier,
-      aPackage.offeringIdentifier,
-      upgradeInfo,
-      null
+    return measure(
+      "purchasePackage",
+      RNPurchases.purchasePackage(aPackage.identifier, aPackage.offeringIdentifier, upgradeInfo, null)
     ).catch((error: any) => {
       error.userCancelled = error.code === "1";
       throw error;
@@ -899,23 +1839,104 @@ export default class Purchases {
     if (typeof discount === "undefined" || discount == null) {
       throw new Error("A discount is required");
     }
-    return RNPurchases.purchasePackage(
-      aPackage.identifier,
-      aPackage.offeringIdentifier,
-      null,
-      discount.timestamp.toString()
+    return measure(
+      "purchasePackage",
+      RNPurchases.purchasePackage(aPackage.identifier, aPackage.offeringIdentifier, null, discount.timestamp.toString())
+    ).catch((error: any) => {
+      error.userCancelled = error.code === "1";
+      throw error;
+    });
+  }
+
+  /**
+   * Looks up the product of a package, and signs a discount for it on iOS, ahead of the purchase, for example when
+   * the paywall is shown. Purchasing the returned PreparedPurchase with purchasePreparedPurchase then goes straight
+   * to the store. Prepared purchases are dropped after 10 minutes and when the app user changes.
+   *
+   * @param {PurchasesPackage} aPackage The Package you wish to purchase. You can get the Packages by calling getOfferings
+   * @param {PurchasesDiscount} discount iOS only. Optional discount to apply to the package, ignored on Android.
+   * @returns {Promise<PreparedPurchase>} A promise of a prepared purchase. Rejections return an error code, and a
+   * userInfo object with more information.
+   */
+  public static preparePurchase(
+    aPackage: PurchasesPackage,
+    discount?: PurchasesDiscount | null
+  ): Promise<PreparedPurchase> {
+    return measure(
+      "preparePurchase",
+      RNPurchases.preparePurchase(
+        aPackage.identifier,
+        aPackage.offeringIdentifier,
+        discount ? discount.identifier : null
+      )
+    );
+  }
+
+  /**
+   * Purchases a package prepared with preparePurchase, applying its discount if it has one.
+   *
+   * @param {PreparedPurchase} preparedPurchase The prepared purchase. It can't be purchased again after this.
+   * @param {UpgradeInfo} upgradeInfo Android only. Optional UpgradeInfo you wish to upgrade from containing the oldSKU
+   * and the optional prorationMode.
+   * @returns {Promise<{ productIdentifier: string, purchaserInfo: PurchaserInfo }>} A promise of an object containing
+   * a purchaser info object and a product identifier. Rejections return an error code,
+   * a boolean indicating if the user cancelled the purchase, and an object with more information.
+   */
+  public static purchasePreparedPurchase(
+    preparedPurchase: PreparedPurchase,
+    upgradeInfo?: UpgradeInfo | null
+  ): MakePurchasePromise {
+    return measure(
+      "purchasePreparedPurchase",
+      RNPurchases.purchasePreparedPurchase(preparedPurchase.handle, upgradeInfo)
     ).catch((error: any) => {
       error.userCancelled = error.code === "1";
       throw error;
     });
   }
 
+  /**
+   * Releases a prepared purchase that won't be purchased. It can't be purchased after this.
+   *
+   * @param {PreparedPurchase} preparedPurchase The prepared purchase returned by preparePurchase
+   */
+  public static releasePreparedPurchase(preparedPurchase: PreparedPurchase) {
+    RNPurchases.releasePreparedPurchase(preparedPurchase.handle);
+  }
+
   /**
    * Restores a user's previous purchases and links their appUserIDs to any user's also using those purchases.
    * @returns {Promise<PurchaserInfo>} A promise of a purchaser info object. Rejections return an error code, and a userInfo object with more information.
    */
   public static restoreTransactions(): Promise<PurchaserInfo> {
-    return RNPurchases.restoreTransactions();
+    return measure("restoreTransactions", RNPurchases.restoreTransactions().then(decodePayload));
+  }
+
+  /**
+   * Same as restoreTransactions, but the listener is called as the restore goes through its stages, so a long
+   * restore can show its progress instead of holding the UI until it resolves.
+   * @param {RestoreProgressListener} listener Called with the RestoreProgress of every stage
+   * @returns {Promise<PurchaserInfo>} A promise of a purchaser info object. Rejections return an error code, and a userInfo object with more information.
+   */
+  public static restoreTransactionsWithProgress(listener: RestoreProgressListener): Promise<PurchaserInfo> {
+    if (typeof listener !== "function") {
+      throw new Error("restoreTransactionsWithProgress needs a function");
+    }
+    lastRestoreRequestID += 1;
+    const requestID = lastRestoreRequestID;
+    restoreProgressListeners.set(requestID, listener);
+    setNativeEventSubscribed("Purchases-RestoreProgress", onRestoreProgress, true);
+    const purchaserInfo: Promise<PurchaserInfo> = measure(
+      "restoreTransactionsWithProgress",
+      RNPurchases.restoreTransactionsWithProgress(requestID).then(decodePayload)
+    );
+    // the events of a request are all sent before it resolves
+    const removeListener = () => {
+      restoreProgressListeners.delete(requestID);
+      setNativeEventSubscribed("Purchases-RestoreProgress", onRestoreProgress, restoreProgressListeners.size > 0);
+    };
+    purchaserInfo.then(removeListener, removeListener);
+    return purchaserInfo;
   }
 
   /**
@@ -926,6 +1947,15 @@ export default class Purchases {
     return RNPurchases.getAppUserID();
   }
 
+  /**
+   * Get the appUserID synchronously, without waiting on the bridge.
+   * Not available when debugging remotely, use getAppUserID in that case.
+   * @returns {string} The app user id
+   */
+  public static getAppUserIDSync(): string {
+    return RNPurchases.getAppUserIDSync();
+  }
+
   /**
    * This function will alias two appUserIDs together.
    * @param {String} newAppUserID The new appUserID that should be linked to the currently identified appUserID. Needs to be a string.
@@ -936,11 +1966,14 @@ export default class Purchases {
     if (typeof newAppUserID !== "string") {
       throw new Error("newAppUserID needs to be a string");
     }
-    return RNPurchases.createAlias(newAppUserID);
+    return changeAppUser(() => RNPurchases.createAlias(newAppUserID)).then(decodePayload);
   }
 
   /**
-   * This function will identify the current user with an appUserID. Typically this would be used after a logout to identify a new user without calling configure
+   * This function will identify the current user with an appUserID. Typically this would be used after a logout to identify a new user without calling configure.
+   * Switching back to a recently identified user resolves with their last purchaser info, see setUserSnapshotCacheLimit.
+   * The SDK then switches to the user in the background, see addIdentifyFailedListener. Until it has, purchases, restores
+   * and subscriber attributes still go to the previous user: wait for getAppUserID to return the new one before making them.
    * @param {String} newAppUserID The appUserID that should be linked to the currently user
    * @returns {Promise<PurchaserInfo>} A promise of a purchaser info object. Rejections return an error code, and a userInfo object with more information.
    */
@@ -949,7 +1982,7 @@ export default class Purchases {
     if (typeof newAppUserID !== "string") {
       throw new Error("newAppUserID needs to be a string");
     }
-    return RNPurchases.identify(newAppUserID);
+    return changeAppUser(() => RNPurchases.identify(newAppUserID)).then(decodePayload);
   }
 
   /**
@@ -957,7 +1990,7 @@ export default class Purchases {
    * @returns {Promise<PurchaserInfo>} A promise of a purchaser info object. Rejections return an error code, and a userInfo object with more information.
    */
   public static reset(): Promise<PurchaserInfo> {
-    return RNPurchases.reset();
+    return changeAppUser(() => RNPurchases.reset()).then(decodePayload);
   }
 
   /**
@@ -970,10 +2003,140 @@ export default class Purchases {
 
   /**
    * Gets current purchaser info
+   * @param {GetPurchaserInfoOptions} options Optional options. Set lazy to true to only fetch the larger fields the first
+   * time they're read.
    * @returns {Promise<PurchaserInfo>} A promise of a purchaser info object. Rejections return an error code, and a userInfo object with more information.
    */
-  public static getPurchaserInfo(): Promise<PurchaserInfo> {
-    return RNPurchases.getPurchaserInfo();
+  public static getPurchaserInfo(options?: GetPurchaserInfoOptions): Promise<PurchaserInfo> {
+    if (options && options.lazy) {
+      return singleFlight("getPurchaserInfo", ["lazy"], () =>
+        measure("getPurchaserInfoLazy", RNPurchases.getPurchaserInfoLazy()).then(withLazyFields)
+      );
+    }
+    return singleFlight("getPurchaserInfo", [], () => measure("getPurchaserInfo", RNPurchases.getPurchaserInfo().then(decodePayload)));
+  }
+
+  /**
+   * Gets how many calls to getPurchaserInfo, getOfferings and getProducts were given the result of an identical
+   * call that was already in flight, instead of making a new request.
+   * @returns {CoalescedRequestCounts} The number of coalesced calls by method
+   */
+  public static getCoalescedRequestCounts(): CoalescedRequestCounts {
+    return {
+      getPurchaserInfo: coalescedRequestCounts.getPurchaserInfo,
+      getOfferings: coalescedRequestCounts.getOfferings,
+      getProductInfo: coalescedRequestCounts.getProductInfo,
+    };
+  }
+
+  /**
+   * Enables or disables performance metrics. When enabled, getOfferings, getProducts, getPurchaserInfo, the purchase
+   * methods, restoreTransactions and checkTrialOrIntroductoryPriceEligibility are timed in JS and natively, and the
+   * size of their results is measured. setupPurchases is timed natively. Disabled by default, don't leave it enabled in production.
+   * @param {boolean} enabled Whether performance metrics should be recorded
+   */
+  public static setPerformanceMetricsEnabled(enabled: boolean) {
+    performanceMetricsEnabled = enabled;
+    setNativeEventSubscribed("Purchases-Metrics", onMetricsSample, enabled);
+    RNPurchases.setPerformanceMetricsEnabled(enabled);
+  }
+
+  /**
+   * Gets the performance metrics recorded since they were enabled. The time spent on the bridge is roughly
+   * totalMillis minus nativeMillis and resolveMillis.
+   * @returns {PerformanceMetrics} Histograms of the measurements by native method name
+   */
+  public static getPerformanceMetrics(): PerformanceMetrics {
+    return copyPerformanceMetrics();
+  }
+
+  /**
+   * Sets a function to be called with the updated performance metrics every time a native call is measured
+   * @param {PerformanceMetricsListener} performanceMetricsListener Performance metrics listener
+   */
+  public static addPerformanceMetricsListener(
+    performanceMetricsListener: PerformanceMetricsListener
+  ) {
+    if (typeof performanceMetricsListener !== "function") {
+      throw new Error("addPerformanceMetricsListener needs a function");
+    }
+    performanceMetricsListeners.push(performanceMetricsListener);
+  }
+
+  /**
+   * Removes a given PerformanceMetricsListener
+   * @param {PerformanceMetricsListener} listenerToRemove PerformanceMetricsListener reference of the listener to remove
+   * @returns {boolean} True if listener was removed, false otherwise
+   */
+  public static removePerformanceMetricsListener(
+    listenerToRemove: PerformanceMetricsListener
+  ) {
+    if (performanceMetricsListeners.includes(listenerToRemove)) {
+      performanceMetricsListeners = performanceMetricsListeners.filter(
+        listener => listenerToRemove !== listener
+      );
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * Sets how offerings and purchaser info are sent over the bridge. COMPACT avoids repeating every key in large
+   * offerings and transaction histories, and is decoded back into the same objects.
+   * @param {PAYLOAD_ENCODING} encoding The encoding to use, MAP by default
+   */
+  public static setPayloadEncoding(encoding: PAYLOAD_ENCODING) {
+    RNPurchases.setPayloadEncoding(encoding);
+  }
+
+  /**
+   * Sets which fields of purchaser infos getPurchaserInfo, restoreTransactions and purchaser info listeners get.
+   * SUMMARY keeps bridge messages small for users with long transaction histories, getPurchaserInfo with lazy set to
+   * true still has every field.
+   * @param {PURCHASER_INFO_MODE} mode The mode to use, FULL by default
+   */
+  public static setPurchaserInfoMode(mode: PURCHASER_INFO_MODE) {
+    RNPurchases.setPurchaserInfoMode(mode);
+  }
+
+  /**
+   * Gets a page of the non subscription transactions of the last purchaser info the native SDK received, fetching
+   * the purchaser info first if there isn't one yet for the current app user.
+   * @param {GetTransactionsOptions} options Optional options, with the cursor to start after and the page size
+   * @returns {Promise<PurchasesTransactionsPage>} A promise of a page of transactions. Rejections return an error
+   * code, and a userInfo object with more information, also when the cursor isn't in the purchaser info anymore.
+   */
+  public static getTransactions(options?: GetTransactionsOptions): Promise<PurchasesTransactionsPage> {
+    const limit = options && options.limit !== undefined ? options.limit : DEFAULT_TRANSACTIONS_PAGE_SIZE;
+    if (!(limit >= 1)) {
+      return Promise.reject(new Error("limit needs to be at least 1"));
+    }
+    return measure(
+      "getTransactions",
+      RNPurchases.getTransactions((options && options.after) || null, Math.floor(limit))
+    );
+  }
+
+  /**
+   * Gets the last purchaser info received from the native SDK synchronously, without waiting on the bridge.
+   * Not available when debugging remotely, use getPurchaserInfo in that case.
+   * It's cleared by identify, createAlias and reset until the purchaser info of the new app user is received.
+   * @returns {PurchaserInfo | null} The last received purchaser info, or null if none has been received yet
+   */
+  public static getCachedPurchaserInfoSync(): PurchaserInfo | null {
+    return decodePayload(RNPurchases.getCachedPurchaserInfoSync());
+  }
+
+  /**
+   * iOS only. Releases a deferred purchase received in a ShouldPurchasePromoProductListener that won't be made.
+   * The deferredPurchase function can't be called after this.
+   * @param {number} callbackID The callbackID the listener was called with
+   */
+  public static releaseDeferredPurchase(callbackID: number) {
+    removePendingDeferredPurchase(callbackID);
+    if (Platform.OS === "ios") {
+      RNPurchases.releaseDeferredPurchase(callbackID);
+    }
   }
 
   /**
@@ -1007,6 +2170,14 @@ export default class Purchases {
     return RNPurchases.isAnonymous();
   }
 
+  /**
+   * Same as isAnonymous, but synchronous. Not available when debugging remotely, use isAnonymous in that case.
+   * @returns { boolean } If the `appUserID` has been generated by RevenueCat or not.
+   */
+  public static isAnonymousSync(): boolean {
+    return RNPurchases.isAnonymousSync();
+  }
+
   /**
    *  iOS only. Computes whether or not a user is eligible for the introductory pricing period of a given product.
    *  You should use this method to determine whether or not you show the user the normal product price or the
@@ -1024,9 +2195,62 @@ export default class Purchases {
   public static checkTrialOrIntroductoryPriceEligibility(
     productIdentifiers: string[]
   ): Promise<{ [productId: string]: IntroEligibility }> {
-    return RNPurchases.checkTrialOrIntroductoryPriceEligibility(
-      productIdentifiers
+    const prewarmedEligibility = inFlightRequests.checkTrialOrIntroductoryPriceEligibility;
+    if (prewarmedEligibility) {
+      const checkEligibility = () => measure(
+        "checkTrialOrIntroductoryPriceEligibility",
+        RNPurchases.checkTrialOrIntroductoryPriceEligibility(productIdentifiers)
+      );
+      return prewarmedEligibility.then(eligibilities => {
+        if (!productIdentifiers.every(productIdentifier => productIdentifier in eligibilities)) {
+          return checkEligibility();
+        }
+        const requestedEligibilities: { [productId: string]: IntroEligibility } = {};
+        productIdentifiers.forEach(productIdentifier => {
+          requestedEligibilities[productIdentifier] = eligibilities[productIdentifier];
+        });
+        return requestedEligibilities;
+      }, checkEligibility);
+    }
+    return measure(
+      "checkTrialOrIntroductoryPriceEligibility",
+      RNPurchases.checkTrialOrIntroductoryPriceEligibility(productIdentifiers)
+    );
+  }
+
+  /**
+   *  iOS only. Same as checkTrialOrIntroductoryPriceEligibility, but the listener is called with the eligibilities as
+   *  they become known: first the ones cached during this session for the current receipt, then the rest once the
+   *  store has checked them, in a single request. Android calls the listener once, with
+   *  INTRO_ELIGIBILITY_STATUS_UNKNOWN for every product.
+   *
+   *  @param productIdentifiers Array of product identifiers for which you want to compute eligibility
+   *  @param listener Called with the IntroEligibility of some of the products, by product identifier
+   *  @returns { Promise<[productId: string]: IntroEligibility> } A map of IntroEligility per productId, once all of
+   *  them are known
+   */
+  public static checkTrialOrIntroductoryPriceEligibilityStreaming(
+    productIdentifiers: string[],
+    listener: IntroEligibilityListener
+  ): Promise<{ [productId: string]: IntroEligibility }> {
+    if (typeof listener !== "function") {
+      throw new Error("checkTrialOrIntroductoryPriceEligibilityStreaming needs a function");
+    }
+    lastIntroEligibilityRequestID += 1;
+    const requestID = lastIntroEligibilityRequestID;
+    introEligibilityListeners.set(requestID, listener);
+    setNativeEventSubscribed("Purchases-IntroEligibility", onIntroEligibility, true);
+    const eligibilities: Promise<{ [productId: string]: IntroEligibility }> = measure(
+      "checkTrialOrIntroductoryPriceEligibilityStreaming",
+      RNPurchases.checkTrialOrIntroductoryPriceEligibilityStreaming(productIdentifiers, requestID)
     );
+    // the events of a request are all sent before it resolves
+    const removeListener = () => {
+      introEligibilityListeners.delete(requestID);
+      setNativeEventSubscribed("Purchases-IntroEligibility", onIntroEligibility, introEligibilityListeners.size > 0);
+    };
+    eligibilities.then(removeListener, removeListener);
+    return eligibilities;
   }
 
   /**
@@ -1067,6 +2291,53 @@ export default class Purchases {
     RNPurchases.invalidatePurchaserInfoCache();
   }
 
+  /**
+   * Sets how much memory the purchaser info and offerings of recently identified app users can take natively. When
+   * identify switches back to one of them, it resolves with their last purchaser info right away and revalidates in
+   * the background, listeners get the purchaser info if it changed. 1 MB by default, estimated as JSON.
+   * @param {number} maxBytes Maximum size of the snapshots in bytes, the least recently identified users are dropped
+   * first. 0 disables the snapshots
+   */
+  public static setUserSnapshotCacheLimit(maxBytes: number) {
+    RNPurchases.setUserSnapshotCacheLimit(maxBytes);
+  }
+
+  /**
+   * Sets how long the products fetched by getProducts and getProductsBatch are cached natively, to be served
+   * without going back to the store. 5 minutes by default.
+   * @param {number} ttlSeconds Time to live of the cached products in seconds, 0 disables the cache
+   */
+  public static setProductCacheTTL(ttlSeconds: number) {
+    RNPurchases.setProductCacheTTL(ttlSeconds);
+  }
+
+  /**
+   * Removes all the products from the native product cache, so the next getProducts and getProductsBatch calls
+   * fetch them from the store.
+   */
+  public static invalidateProductCache() {
+    RNPurchases.invalidateProductCache();
+  }
+
+  /**
+   * Gets how many product identifiers looked up by getProducts and getProductsBatch were served from the native
+   * product cache, and how many had to be fetched from the store.
+   * @returns {Promise<ProductCacheStats>} A promise of the cache hits and misses since the app started
+   */
+  public static getProductCacheStats(): Promise<ProductCacheStats> {
+    return RNPurchases.getProductCacheStats();
+  }
+
+  /**
+   * Gets how many subscriber attribute, attribution data and syncPurchases calls are waiting to be sent. Calls made
+   * before setup or while the device is offline are kept on disk and sent together once connectivity returns.
+   * They're also sent before the app user changes, so the SDK keeps them for the user they were made for.
+   * @returns {Promise<number>} A promise of the number of queued operations
+   */
+  public static getQueuedOperationCount(): Promise<number> {
+    return RNPurchases.getQueuedOperationCount();
+  }
+
   /**
    * Subscriber attributes are useful for storing additional, structured information on a user.
    * Since attributes are writable using a public key they should not be used for
@@ -1081,6 +2352,42 @@ export default class Purchases {
     RNPurchases.setAttributes(attributes);
   }
 
+  /**
+   * Sets several subscriber attributes with a single call to the native SDK. Calls made during the same tick are
+   * merged, with later values for the same attribute replacing earlier ones, and sent together.
+   *
+   * @param batch Subscriber attributes to set. Attributes that are not present are left untouched.
+   */
+  public static setAttributesBatch(batch: SubscriberAttributesBatch) {
+    const isFirstInTick = pendingAttributesBatch === null;
+    const pending: { [key: string]: any } = pendingAttributesBatch || {};
+    Object.keys(batch).forEach(key => {
+      const value = (batch as { [key: string]: any })[key];
+      if (typeof value === "undefined") {
+        return;
+      }
+      if (key === "attributes") {
+        // nothing to merge, attributes are removed with a null value for their key instead
+        if (value === null) {
+          return;
+        }
+        const attributes = pending.attributes || {};
+        Object.keys(value).forEach(name => {
+          attributes[name] = value[name];
+        });
+        pending.attributes = attributes;
+      } else if (key === "collectDeviceIdentifiers") {
+        pending.collectDeviceIdentifiers = pending.collectDeviceIdentifiers || value;
+      } else {
+        pending[key] = value;
+      }
+    });
+    pendingAttributesBatch = pending;
+    if (isFirstInTick) {
+      Promise.resolve().then(flushAttributesBatch);
+    }
+  }
+
   /**
    * Subscriber attribute associated with the email address for the user
    *